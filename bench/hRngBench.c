@@ -0,0 +1,412 @@
+// Throughput/latency benchmark for hRng.
+//
+// Builds hRng.c straight into the executable so the benchmark sees the same RNG_CONFIG
+// layout and internal normalization as the DLL without a separate header.
+//
+// Usage: hRngBench [--format csv|json] [--out FILE] [--sizes 16,4K,1M] [--threads 1,2,4]
+//                  [--time-ms N] [--max-calls N] [--complexity N] [--filter TEXT]
+//
+// Every case is run for each size and thread count: threads start together and call the
+// API until the time budget is spent (at least once each). Reported bytes/sec is total
+// raw bytes over wall time; p50/p99/max are per-call latencies across all threads.
+#include "../src/hRng.c"
+
+#include <math.h>
+
+// ============================================================
+// Cases
+// ============================================================
+typedef enum {
+    BENCH_MAXRNG = 0,
+    BENCH_MAXRNG_ULTRA,
+    BENCH_MAXRNG_THREADSAFE,
+    BENCH_MAXRNG_DEV
+} BENCH_API;
+
+typedef enum {
+    BENCH_SRC_ALL = 0,     // every collector the preset allows
+    BENCH_SRC_MINIMAL,     // cpu + perf + rdrand
+    BENCH_SRC_RDRAND       // rdrand only
+} BENCH_SOURCES;
+
+typedef struct {
+    BENCH_API api;
+    RNG_CONFIG cfg;        // maxrng_dev only, already normalized
+    BENCH_SOURCES sources;
+    char name[96];
+} BENCH_CASE;
+
+static const char *api_name(const BENCH_API api) {
+    switch (api) {
+        case BENCH_MAXRNG:            return "maxrng";
+        case BENCH_MAXRNG_ULTRA:      return "maxrng_ultra";
+        case BENCH_MAXRNG_THREADSAFE: return "maxrng_threadsafe";
+        default:                      return "maxrng_dev";
+    }
+}
+
+static const char *sec_name(const RNG_SECURITY_MODE m) {
+    switch (m) {
+        case RNG_MODE_FAST:   return "fast";
+        case RNG_MODE_SECURE: return "secure";
+        default:              return "balanced";
+    }
+}
+
+static const char *exp_name(const RNG_EXP_MODE e) {
+    static const char *names[] = { "counter", "hkdf", "hmac", "xof", "aesctr", "rdseed" };
+    return (e >= 0 && e <= RNG_EXP_RDSEED) ? names[e] : "unknown";
+}
+
+static const char *mix_name(const RNG_MIX_MODE m) {
+    return m == RNG_MIX_ROUND_BASED ? "round" : "continuous";
+}
+
+static const char *src_name(const BENCH_SOURCES s) {
+    switch (s) {
+        case BENCH_SRC_MINIMAL: return "minimal";
+        case BENCH_SRC_RDRAND:  return "rdrand";
+        default:                return "all";
+    }
+}
+
+static const char *thread_name(const RNG_THREAD_MODE t) {
+    switch (t) {
+        case RNG_THREAD_CRITSEC:  return "critsec";
+        case RNG_THREAD_USERLOCK: return "userlock";
+        case RNG_THREAD_TLS:      return "tls";
+        default:                  return "none";
+    }
+}
+
+static void add_dev_case(BENCH_CASE *cases, int *n, const RNG_SECURITY_MODE sec, const RNG_EXP_MODE exp,
+                         const BENCH_SOURCES src, const RNG_THREAD_MODE threading, const int complexity)
+{
+    BENCH_CASE *bc = &cases[(*n)++];
+    memset(bc, 0, sizeof(*bc));
+    bc->api = BENCH_MAXRNG_DEV;
+    bc->sources = src;
+    maxrng_dev_default_config(&bc->cfg, sec);
+    bc->cfg.expansion = exp;
+    bc->cfg.threading = threading;
+    bc->cfg.complexity = complexity;
+    if (src != BENCH_SRC_ALL) {
+        bc->cfg.use_memory = bc->cfg.use_battery = 0;
+        bc->cfg.use_cpu = bc->cfg.use_perf = (src == BENCH_SRC_MINIMAL);
+    }
+    // Presets decide mixing and the slow collectors; report what actually runs
+    normalize_config(&bc->cfg);
+    snprintf(bc->name, sizeof(bc->name), "dev/%s/%s/%s/%s/%s", sec_name(sec), exp_name(exp),
+             mix_name(bc->cfg.mixing), src_name(src), thread_name(threading));
+}
+
+static int build_cases(BENCH_CASE *cases, const int complexity) {
+    int n = 0;
+    for (int api = BENCH_MAXRNG; api <= BENCH_MAXRNG_THREADSAFE; api++) {
+        memset(&cases[n], 0, sizeof(cases[n]));
+        cases[n].api = (BENCH_API)api;
+        snprintf(cases[n].name, sizeof(cases[n].name), "%s", api_name((BENCH_API)api));
+        n++;
+    }
+    for (int sec = RNG_MODE_FAST; sec <= RNG_MODE_SECURE; sec++) {
+        for (int exp = RNG_EXP_COUNTER; exp <= RNG_EXP_RDSEED; exp++) {
+            add_dev_case(cases, &n, (RNG_SECURITY_MODE)sec, (RNG_EXP_MODE)exp, BENCH_SRC_ALL,
+                         RNG_THREAD_NONE, complexity);
+        }
+    }
+    add_dev_case(cases, &n, RNG_MODE_FAST, RNG_EXP_COUNTER, BENCH_SRC_MINIMAL, RNG_THREAD_NONE, complexity);
+    add_dev_case(cases, &n, RNG_MODE_FAST, RNG_EXP_COUNTER, BENCH_SRC_RDRAND, RNG_THREAD_NONE, complexity);
+    add_dev_case(cases, &n, RNG_MODE_BALANCED, RNG_EXP_COUNTER, BENCH_SRC_ALL, RNG_THREAD_CRITSEC, complexity);
+    add_dev_case(cases, &n, RNG_MODE_BALANCED, RNG_EXP_COUNTER, BENCH_SRC_ALL, RNG_THREAD_TLS, complexity);
+    add_dev_case(cases, &n, RNG_MODE_SECURE, RNG_EXP_COUNTER, BENCH_SRC_ALL, RNG_THREAD_NONE, complexity);
+    cases[n - 1].cfg.parallel_collect = 1;
+    strncat(cases[n - 1].name, "/parallel", sizeof(cases[n - 1].name) - strlen(cases[n - 1].name) - 1);
+    return n;
+}
+
+#define BENCH_MAX_CASES 32
+
+// ============================================================
+// Workers
+// ============================================================
+typedef struct {
+    const BENCH_CASE *bc;
+    int size;
+    int complexity;
+    unsigned char *buf;
+    double *lat_us;
+    int max_calls;
+    int calls;
+    int failures;
+    LONGLONG deadline;            // QPC ticks, published before start_event is set
+    HANDLE start_event;
+} BENCH_WORKER;
+
+static LARGE_INTEGER g_qpcFreq;
+
+static int run_once(const BENCH_WORKER *w) {
+    switch (w->bc->api) {
+        case BENCH_MAXRNG:            return maxrng(w->buf, w->size);
+        case BENCH_MAXRNG_ULTRA:      return maxrng_ultra(w->buf, w->size, w->complexity);
+        case BENCH_MAXRNG_THREADSAFE: return maxrng_threadsafe(w->buf, w->size, w->complexity);
+        default:                      return maxrng_dev(w->buf, w->size, w->size, &w->bc->cfg) > 0;
+    }
+}
+
+static DWORD WINAPI bench_worker_proc(LPVOID param) {
+    BENCH_WORKER *w = (BENCH_WORKER*)param;
+    WaitForSingleObject(w->start_event, INFINITE);
+
+    LARGE_INTEGER t0, t1;
+    do {
+        QueryPerformanceCounter(&t0);
+        const int ok = run_once(w);
+        QueryPerformanceCounter(&t1);
+        w->lat_us[w->calls++] = (double)(t1.QuadPart - t0.QuadPart) * 1e6 / (double)g_qpcFreq.QuadPart;
+        if (!ok) w->failures++;
+    } while (w->calls < w->max_calls && t1.QuadPart < w->deadline);
+    return 0;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile over sorted samples
+static double percentile(const double *sorted, const int n, const double q) {
+    if (n <= 0) return 0.0;
+    int idx = (int)ceil(q * n) - 1;
+    if (idx < 0) idx = 0;
+    if (idx >= n) idx = n - 1;
+    return sorted[idx];
+}
+
+typedef struct {
+    int calls;
+    int failures;
+    double seconds;
+    double bytes_per_sec;
+    double p50_us, p99_us, max_us;
+} BENCH_RESULT;
+
+static int run_case(const BENCH_CASE *bc, const int size, const int threads, const int complexity,
+                    const DWORD time_ms, const int max_calls, BENCH_RESULT *res)
+{
+    BENCH_WORKER *workers = (BENCH_WORKER*)calloc((size_t)threads, sizeof(BENCH_WORKER));
+    HANDLE *handles = (HANDLE*)calloc((size_t)threads, sizeof(HANDLE));
+    HANDLE start = CreateEventW(NULL, TRUE, FALSE, NULL);
+    int ok = workers && handles && start;
+
+    for (int t = 0; ok && t < threads; t++) {
+        BENCH_WORKER *w = &workers[t];
+        w->bc = bc;
+        w->size = size;
+        w->complexity = complexity;
+        w->max_calls = max_calls;
+        w->start_event = start;
+        w->buf = (unsigned char*)malloc((size_t)size);
+        w->lat_us = (double*)malloc((size_t)max_calls * sizeof(double));
+        if (!w->buf || !w->lat_us) { ok = 0; break; }
+        handles[t] = CreateThread(NULL, 0, bench_worker_proc, w, 0, NULL);
+        if (!handles[t]) ok = 0;
+    }
+
+    LARGE_INTEGER t0, t1;
+    QueryPerformanceCounter(&t0);
+    const LONGLONG deadline = t0.QuadPart + (LONGLONG)time_ms * g_qpcFreq.QuadPart / 1000;
+    for (int t = 0; t < threads && workers; t++) workers[t].deadline = deadline;
+    if (start) SetEvent(start);
+
+    for (int t = 0; t < threads && handles; t++) {
+        if (handles[t]) {
+            WaitForSingleObject(handles[t], INFINITE);
+            CloseHandle(handles[t]);
+        }
+    }
+    QueryPerformanceCounter(&t1);
+
+    memset(res, 0, sizeof(*res));
+    double *all = NULL;
+    if (ok) {
+        int total = 0;
+        for (int t = 0; t < threads; t++) total += workers[t].calls;
+        all = (double*)malloc((size_t)total * sizeof(double));
+        ok = all != NULL;
+        for (int t = 0; ok && t < threads; t++) {
+            memcpy(all + res->calls, workers[t].lat_us, (size_t)workers[t].calls * sizeof(double));
+            res->calls += workers[t].calls;
+            res->failures += workers[t].failures;
+        }
+    }
+    if (ok) {
+        qsort(all, (size_t)res->calls, sizeof(double), cmp_double);
+        res->seconds = (double)(t1.QuadPart - t0.QuadPart) / (double)g_qpcFreq.QuadPart;
+        res->bytes_per_sec = res->seconds > 0.0
+            ? (double)(res->calls - res->failures) * (double)size / res->seconds : 0.0;
+        res->p50_us = percentile(all, res->calls, 0.50);
+        res->p99_us = percentile(all, res->calls, 0.99);
+        res->max_us = all[res->calls - 1];
+    }
+
+    free(all);
+    for (int t = 0; t < threads && workers; t++) {
+        free(workers[t].buf);
+        free(workers[t].lat_us);
+    }
+    free(workers);
+    free(handles);
+    if (start) CloseHandle(start);
+    return ok;
+}
+
+// ============================================================
+// Output
+// ============================================================
+typedef enum { BENCH_CSV = 0, BENCH_JSON = 1 } BENCH_FORMAT;
+
+static void emit_header(FILE *f, const BENCH_FORMAT fmt) {
+    if (fmt == BENCH_JSON) fprintf(f, "[\n");
+    else fprintf(f, "api,case,security,expansion,mixing,sources,threading,threads,size,"
+                    "calls,failures,seconds,bytes_per_sec,p50_us,p99_us,max_us\n");
+}
+
+static void emit_row(FILE *f, const BENCH_FORMAT fmt, const int first, const BENCH_CASE *bc,
+                     const int threads, const int size, const BENCH_RESULT *r)
+{
+    const int dev = bc->api == BENCH_MAXRNG_DEV;
+    const char *sec = dev ? sec_name(bc->cfg.sec_mode) : "";
+    const char *exp = dev ? exp_name(bc->cfg.expansion) : "";
+    const char *mix = dev ? mix_name(bc->cfg.mixing) : "";
+    const char *src = dev ? src_name(bc->sources) : "";
+    const char *thr = dev ? thread_name(bc->cfg.threading) : "";
+
+    if (fmt == BENCH_JSON) {
+        fprintf(f, "%s  {\"api\": \"%s\", \"case\": \"%s\", \"security\": \"%s\", \"expansion\": \"%s\", "
+                   "\"mixing\": \"%s\", \"sources\": \"%s\", \"threading\": \"%s\", \"threads\": %d, "
+                   "\"size\": %d, \"calls\": %d, \"failures\": %d, \"seconds\": %.6f, "
+                   "\"bytes_per_sec\": %.1f, \"p50_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f}",
+                first ? "" : ",\n", api_name(bc->api), bc->name, sec, exp, mix, src, thr, threads, size,
+                r->calls, r->failures, r->seconds, r->bytes_per_sec, r->p50_us, r->p99_us, r->max_us);
+    } else {
+        fprintf(f, "%s,%s,%s,%s,%s,%s,%s,%d,%d,%d,%d,%.6f,%.1f,%.2f,%.2f,%.2f\n",
+                api_name(bc->api), bc->name, sec, exp, mix, src, thr, threads, size,
+                r->calls, r->failures, r->seconds, r->bytes_per_sec, r->p50_us, r->p99_us, r->max_us);
+    }
+    fflush(f);
+}
+
+static void emit_footer(FILE *f, const BENCH_FORMAT fmt) {
+    if (fmt == BENCH_JSON) fprintf(f, "\n]\n");
+}
+
+// ============================================================
+// Arguments
+// ============================================================
+// Accepts plain numbers or K/M suffixes (binary units)
+static int parse_size(const char *s, int *out) {
+    char *end = NULL;
+    const long long v = strtoll(s, &end, 10);
+    long long mul = 1;
+    if (end && (*end == 'k' || *end == 'K')) { mul = 1024; end++; }
+    else if (end && (*end == 'm' || *end == 'M')) { mul = 1024 * 1024; end++; }
+    if (!end || end == s || (*end && *end != ',') || v <= 0 || v * mul > INT_MAX) return 0;
+    *out = (int)(v * mul);
+    return 1;
+}
+
+static int parse_list(const char *s, int *out, const int max) {
+    int n = 0;
+    while (*s && n < max) {
+        if (!parse_size(s, &out[n])) return 0;
+        n++;
+        const char *comma = strchr(s, ',');
+        if (!comma) break;
+        s = comma + 1;
+    }
+    return n;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: hRngBench [--format csv|json] [--out FILE] [--sizes LIST] [--threads LIST]\n"
+            "                 [--time-ms N] [--max-calls N] [--complexity N] [--filter TEXT]\n"
+            "defaults: csv, stdout, sizes 16,256,4K,64K,1M,16M, threads 1,2,4,\n"
+            "          time-ms 200, max-calls 100000, complexity 2\n");
+}
+
+int main(const int argc, char **argv) {
+    int sizes[16] = { 16, 256, 4096, 65536, 1048576, 16777216 };
+    int nsizes = 6;
+    int threads[16] = { 1, 2, 4 };
+    int nthreads = 3;
+    int time_ms = 200;
+    int max_calls = 100000;
+    int complexity = 2;
+    const char *filter = NULL;
+    const char *out_path = NULL;
+    BENCH_FORMAT fmt = BENCH_CSV;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        int ok = v != NULL;
+        if (ok && strcmp(a, "--format") == 0) {
+            if (strcmp(v, "json") == 0) fmt = BENCH_JSON;
+            else if (strcmp(v, "csv") == 0) fmt = BENCH_CSV;
+            else ok = 0;
+        } else if (ok && strcmp(a, "--out") == 0) out_path = v;
+        else if (ok && strcmp(a, "--sizes") == 0) ok = (nsizes = parse_list(v, sizes, 16)) > 0;
+        else if (ok && strcmp(a, "--threads") == 0) ok = (nthreads = parse_list(v, threads, 16)) > 0;
+        else if (ok && strcmp(a, "--time-ms") == 0) ok = parse_size(v, &time_ms);
+        else if (ok && strcmp(a, "--max-calls") == 0) ok = parse_size(v, &max_calls);
+        else if (ok && strcmp(a, "--complexity") == 0) ok = parse_size(v, &complexity);
+        else if (ok && strcmp(a, "--filter") == 0) filter = v;
+        else ok = 0;
+        if (!ok) {
+            usage();
+            return 2;
+        }
+        i++;
+    }
+
+    FILE *f = stdout;
+    if (out_path) {
+        f = fopen(out_path, "w");
+        if (!f) {
+            fprintf(stderr, "hRngBench: cannot open %s\n", out_path);
+            return 1;
+        }
+    }
+
+    QueryPerformanceFrequency(&g_qpcFreq);
+    maxrng_init();
+
+    BENCH_CASE cases[BENCH_MAX_CASES];
+    const int ncases = build_cases(cases, complexity);
+    int first = 1, failed = 0;
+
+    emit_header(f, fmt);
+    for (int c = 0; c < ncases; c++) {
+        if (filter && !strstr(cases[c].name, filter)) continue;
+        if (cases[c].cfg.expansion == RNG_EXP_RDSEED && !rdrand_supported()) continue;
+        for (int t = 0; t < nthreads; t++) {
+            for (int s = 0; s < nsizes; s++) {
+                BENCH_RESULT r;
+                fprintf(stderr, "%s threads=%d size=%d\n", cases[c].name, threads[t], sizes[s]);
+                if (!run_case(&cases[c], sizes[s], threads[t], complexity, (DWORD)time_ms, max_calls, &r)) {
+                    fprintf(stderr, "hRngBench: out of memory for %s size=%d\n", cases[c].name, sizes[s]);
+                    failed = 1;
+                    continue;
+                }
+                emit_row(f, fmt, first, &cases[c], threads[t], sizes[s], &r);
+                first = 0;
+            }
+        }
+    }
+    emit_footer(f, fmt);
+
+    maxrng_shutdown();
+    if (f != stdout) fclose(f);
+    return failed;
+}
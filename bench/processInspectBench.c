@@ -0,0 +1,495 @@
+// Per-sample cost benchmark for processInspect.
+//
+// Builds processInspect.c straight into the executable, like hRngBench, so the monitor cases
+// can read the scheduler thread's CPU time directly.
+//
+// Usage: processInspectBench [--format csv|json] [--out FILE] [--pids 1,10,100,1000]
+//                            [--metrics HEX] [--time-ms N] [--max-calls N]
+//                            [--interval-ms N] [--monitor-ms N] [--filter TEXT]
+//
+// Call cases (snapshot, batch, session, scan) run on the main thread after one warm-up round
+// until the time budget is spent, and report per-call latency plus wall and CPU time per
+// sampled process. Monitor cases run one monitor per PID (at most MAX_MONITORS) and report
+// the scheduler thread's CPU time per delivered sample; binary monitors also report how late
+// samples were against their deadlines. Every case runs with JSON and binary output where
+// both exist. Machines with fewer accessible processes than requested reuse PIDs; the
+// `distinct` column shows how many differ.
+#include "../src/processInspect.c"
+
+#include <limits.h>
+#include <math.h>
+
+// ============================================================
+// Cases
+// ============================================================
+typedef enum {
+    BENCH_SNAPSHOT = 0,    // get_metrics_json / get_metrics_record, one call per PID
+    BENCH_BATCH,           // get_metrics_batch / get_metrics_batch_records, one call for all PIDs
+    BENCH_SESSION,         // start_metrics_collection + end_metrics_collection(_record) per PID
+    BENCH_SCAN,            // scan_all_processes, top N by the first requested metric
+    BENCH_MONITOR,         // one callback monitor per PID
+    BENCH_MONITOR_RING     // one ring monitor per PID, drained by the main thread
+} BENCH_KIND;
+
+typedef enum { BENCH_OUT_JSON = 0, BENCH_OUT_BINARY = 1 } BENCH_OUTPUT;
+
+typedef struct {
+    BENCH_KIND kind;
+    BENCH_OUTPUT output;
+    char name[32];
+} BENCH_CASE;
+
+static const char *kind_name(const BENCH_KIND k) {
+    switch (k) {
+        case BENCH_SNAPSHOT:     return "snapshot";
+        case BENCH_BATCH:        return "batch";
+        case BENCH_SESSION:      return "session";
+        case BENCH_SCAN:         return "scan";
+        case BENCH_MONITOR:      return "monitor";
+        default:                 return "monitor_ring";
+    }
+}
+
+static const char *output_name(const BENCH_OUTPUT o) {
+    return o == BENCH_OUT_JSON ? "json" : "binary";
+}
+
+static int build_cases(BENCH_CASE *cases) {
+    int n = 0;
+    for (int k = BENCH_SNAPSHOT; k <= BENCH_MONITOR_RING; k++) {
+        for (int o = BENCH_OUT_JSON; o <= BENCH_OUT_BINARY; o++) {
+            // Scans and rings only produce records
+            if (o == BENCH_OUT_JSON && (k == BENCH_SCAN || k == BENCH_MONITOR_RING)) continue;
+            cases[n].kind = (BENCH_KIND)k;
+            cases[n].output = (BENCH_OUTPUT)o;
+            snprintf(cases[n].name, sizeof(cases[n].name), "%s/%s", kind_name((BENCH_KIND)k),
+                     output_name((BENCH_OUTPUT)o));
+            n++;
+        }
+    }
+    return n;
+}
+
+#define BENCH_MAX_CASES 16
+#define BENCH_MAX_PIDS  4096
+
+// ============================================================
+// Measurement
+// ============================================================
+typedef struct {
+    int calls;
+    int samples;                  // processes sampled (call cases) or samples delivered (monitors)
+    int failures;
+    double seconds;
+    double cpu_seconds;           // calling thread (call cases) or scheduler thread (monitors)
+    double p50_us, p99_us, max_us;  // call latency, or sample lateness for binary monitors
+} BENCH_RESULT;
+
+static LARGE_INTEGER g_qpcFreq;
+
+static double elapsed_us(const LARGE_INTEGER t0, const LARGE_INTEGER t1) {
+    return (double)(t1.QuadPart - t0.QuadPart) * 1e6 / (double)g_qpcFreq.QuadPart;
+}
+
+// ReSharper disable once CppParameterMayBeConst
+static double thread_cpu_seconds(HANDLE thread) {
+    FILETIME creation, exitTime, kernel, user;
+    if (!GetThreadTimes(thread, &creation, &exitTime, &kernel, &user)) return 0.0;
+    return (double)(fileTimeToInt(kernel) + fileTimeToInt(user)) / 1e7;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile over sorted samples
+static double percentile(const double *sorted, const int n, const double q) {
+    if (n <= 0) return 0.0;
+    int idx = (int)ceil(q * n) - 1;
+    if (idx < 0) idx = 0;
+    if (idx >= n) idx = n - 1;
+    return sorted[idx];
+}
+
+static void fill_percentiles(BENCH_RESULT *res, double *values, const int n) {
+    if (n <= 0) return;
+    qsort(values, (size_t)n, sizeof(double), cmp_double);
+    res->p50_us = percentile(values, n, 0.50);
+    res->p99_us = percentile(values, n, 0.99);
+    res->max_us = values[n - 1];
+}
+
+// First metric column of the mask that a scan can rank by, or -1
+static int scan_sort_key(const DWORD metrics) {
+    unsigned char columns[REC_COL_COUNT];
+    const DWORD n = metric_columns(metrics & ~METRIC_NET, 0, columns);
+    return n > 0 ? columns[0] : -1;
+}
+
+typedef struct {
+    const DWORD *pids;
+    int n;
+    DWORD metrics;
+    BENCH_OUTPUT output;
+    char *json;
+    size_t jsonLen;
+    METRICS_RECORD *records;
+} BENCH_CALL;
+
+// One unit of work of a call case; returns the number of processes sampled
+static int run_call(const BENCH_KIND kind, const BENCH_CALL *c, const int i, int *failures) {
+    const int json = c->output == BENCH_OUT_JSON;
+    switch (kind) {
+        case BENCH_SNAPSHOT: {
+            const int ok = json ? get_metrics_json(c->pids[i], c->metrics, c->json, c->jsonLen)
+                                : get_metrics_record(c->pids[i], c->metrics, &c->records[0]);
+            if (!ok) (*failures)++;
+            return 1;
+        }
+        case BENCH_SESSION: {
+            const int ok = start_metrics_collection(c->pids[i], c->metrics) &&
+                           (json ? end_metrics_collection(c->pids[i], c->metrics, c->json, c->jsonLen)
+                                 : end_metrics_collection_record(c->pids[i], c->metrics, &c->records[0]));
+            if (!ok) (*failures)++;
+            return 1;
+        }
+        case BENCH_BATCH: {
+            const int n = json ? get_metrics_batch(c->pids, c->n, c->metrics, c->json, c->jsonLen)
+                               : get_metrics_batch_records(c->pids, c->n, c->metrics, c->records);
+            if (n < 0) (*failures)++;
+            return c->n;
+        }
+        default: {
+            const int n = scan_all_processes(c->metrics, (DWORD)scan_sort_key(c->metrics), c->n, c->records);
+            if (n < 0) (*failures)++;
+            return n > 0 ? n : 0;
+        }
+    }
+}
+
+static int run_call_case(const BENCH_CASE *bc, const DWORD *pids, const int n, const DWORD metrics,
+                         const DWORD time_ms, const int max_calls, BENCH_RESULT *res) {
+    BENCH_CALL c;
+    c.pids = pids;
+    c.n = n;
+    c.metrics = metrics;
+    c.output = bc->output;
+    c.jsonLen = 1024 * (size_t)n + 1;
+    c.json = (char*)malloc(c.jsonLen);
+    c.records = (METRICS_RECORD*)malloc(sizeof(METRICS_RECORD) * (size_t)n);
+    double *lat_us = (double*)malloc((size_t)max_calls * sizeof(double));
+    const int ok = c.json && c.records && lat_us;
+
+    memset(res, 0, sizeof(*res));
+    if (ok) {
+        // Per-PID cases cycle through the PIDs; batch and scan cases cover them in one call
+        const int perPid = bc->kind == BENCH_SNAPSHOT || bc->kind == BENCH_SESSION;
+        int warmFailures = 0;
+        for (int i = 0; i < (perPid ? n : 1); i++) run_call(bc->kind, &c, i, &warmFailures);
+
+        // ReSharper disable once CppLocalVariableMayBeConst
+        HANDLE self = GetCurrentThread();
+        const double cpu0 = thread_cpu_seconds(self);
+        LARGE_INTEGER start, t0, t1;
+        QueryPerformanceCounter(&start);
+        const LONGLONG deadline = start.QuadPart + (LONGLONG)time_ms * g_qpcFreq.QuadPart / 1000;
+        int i = 0;
+        do {
+            QueryPerformanceCounter(&t0);
+            res->samples += run_call(bc->kind, &c, i, &res->failures);
+            QueryPerformanceCounter(&t1);
+            lat_us[res->calls++] = elapsed_us(t0, t1);
+            if (perPid && ++i == n) i = 0;
+        } while (res->calls < max_calls && t1.QuadPart < deadline);
+        res->cpu_seconds = thread_cpu_seconds(self) - cpu0;
+        res->seconds = elapsed_us(start, t1) / 1e6;
+        fill_percentiles(res, lat_us, res->calls);
+    }
+
+    free(c.json);
+    free(c.records);
+    free(lat_us);
+    return ok;
+}
+
+// Monitor callbacks run on the scheduler thread only
+typedef struct {
+    LONG samples;
+    double *late_us;
+    int nlate;
+    int maxLate;
+} BENCH_SINK;
+
+static void bench_json_callback(const char *json, void *userData) {
+    (void)json;
+    ((BENCH_SINK*)userData)->samples++;
+}
+
+static void record_lateness(BENCH_SINK *sink, const METRICS_RECORD *record) {
+    sink->samples++;
+    if (sink->nlate < sink->maxLate) sink->late_us[sink->nlate++] = record->late_us;
+}
+
+static void bench_record_callback(const METRICS_RECORD *record, void *userData) {
+    record_lateness((BENCH_SINK*)userData, record);
+}
+
+static int run_monitor_case(const BENCH_CASE *bc, const DWORD *pids, const int n, const DWORD metrics,
+                            const DWORD interval_ms, const DWORD monitor_ms, const int max_calls,
+                            BENCH_RESULT *res) {
+    BENCH_SINK sink;
+    memset(&sink, 0, sizeof(sink));
+    sink.maxLate = max_calls;
+    sink.late_us = (double*)malloc((size_t)max_calls * sizeof(double));
+    int *ids = (int*)calloc((size_t)n, sizeof(int));
+    METRICS_RECORD drain[256];
+    int ok = sink.late_us && ids;
+
+    memset(res, 0, sizeof(*res));
+    for (int i = 0; ok && i < n; i++) {
+        if (bc->kind == BENCH_MONITOR_RING) {
+            ids[i] = monitor_create_ring(pids[i], metrics, interval_ms, -1, 4096);
+        } else if (bc->output == BENCH_OUT_JSON) {
+            ids[i] = monitor_create(pids[i], metrics, interval_ms, -1, bench_json_callback, NULL, &sink);
+        } else {
+            ids[i] = monitor_create(pids[i], metrics, interval_ms, -1, NULL, bench_record_callback, &sink);
+        }
+        if (!ids[i]) res->failures++;
+    }
+
+    if (ok) {
+        // Let every monitor take its first sample before measuring
+        Sleep(interval_ms * 2 + 10);
+        EnterCriticalSection(&g_schedLock);
+        // ReSharper disable once CppLocalVariableMayBeConst
+        HANDLE sched = g_schedThread;
+        LeaveCriticalSection(&g_schedLock);
+
+        for (int i = 0; i < n && bc->kind == BENCH_MONITOR_RING; i++) {
+            while (ids[i] && monitor_read(ids[i], drain, 256) > 0) {}
+        }
+        const LONG samples0 = sink.samples;
+        sink.nlate = 0;
+        const double cpu0 = thread_cpu_seconds(sched);
+        LARGE_INTEGER t0, t1, now;
+        QueryPerformanceCounter(&t0);
+        const LONGLONG deadline = t0.QuadPart + (LONGLONG)monitor_ms * g_qpcFreq.QuadPart / 1000;
+        do {
+            if (bc->kind == BENCH_MONITOR_RING) {
+                for (int i = 0; i < n; i++) {
+                    int got;
+                    while (ids[i] && (got = monitor_read(ids[i], drain, 256)) > 0) {
+                        for (int r = 0; r < got; r++) record_lateness(&sink, &drain[r]);
+                    }
+                }
+            }
+            Sleep(50);
+            QueryPerformanceCounter(&now);
+        } while (now.QuadPart < deadline);
+        res->cpu_seconds = thread_cpu_seconds(sched) - cpu0;
+        QueryPerformanceCounter(&t1);
+
+        res->seconds = elapsed_us(t0, t1) / 1e6;
+        res->samples = sink.samples - samples0;
+        res->calls = res->samples;
+        if (bc->output == BENCH_OUT_BINARY) fill_percentiles(res, sink.late_us, sink.nlate);
+    }
+
+    for (int i = 0; ids && i < n; i++) {
+        if (ids[i]) monitor_destroy(ids[i]);
+    }
+    free(ids);
+    free(sink.late_us);
+    return ok;
+}
+
+// Fills avail with up to max PIDs that can be sampled with `metrics`, this process first
+static int collect_pids(DWORD *avail, const int max, const DWORD metrics) {
+    int n = 0;
+    avail[n++] = GetCurrentProcessId();
+    // ReSharper disable once CppLocalVariableMayBeConst
+    HANDLE snap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (snap == INVALID_HANDLE_VALUE) return n;
+    PROCESSENTRY32 pe;
+    pe.dwSize = sizeof(pe);
+    for (BOOL more = Process32First(snap, &pe); more && n < max; more = Process32Next(snap, &pe)) {
+        METRICS_RECORD record;
+        if (pe.th32ProcessID == 0 || pe.th32ProcessID == avail[0]) continue;
+        if (get_metrics_record(pe.th32ProcessID, metrics, &record)) avail[n++] = pe.th32ProcessID;
+    }
+    CloseHandle(snap);
+    return n;
+}
+
+// ============================================================
+// Output
+// ============================================================
+typedef enum { BENCH_CSV = 0, BENCH_JSON = 1 } BENCH_FORMAT;
+
+static void emit_header(FILE *f, const BENCH_FORMAT fmt) {
+    if (fmt == BENCH_JSON) fprintf(f, "[\n");
+    else fprintf(f, "case,kind,output,pids,distinct,metrics,calls,samples,failures,seconds,"
+                    "p50_us,p99_us,max_us,us_per_sample,cpu_us_per_sample\n");
+}
+
+static void emit_row(FILE *f, const BENCH_FORMAT fmt, const int first, const BENCH_CASE *bc,
+                     const int pids, const int distinct, const DWORD metrics, const BENCH_RESULT *r) {
+    const double per = r->samples > 0 ? r->seconds * 1e6 / r->samples : 0.0;
+    const double cpuPer = r->samples > 0 ? r->cpu_seconds * 1e6 / r->samples : 0.0;
+    if (fmt == BENCH_JSON) {
+        fprintf(f, "%s  {\"case\": \"%s\", \"kind\": \"%s\", \"output\": \"%s\", \"pids\": %d, "
+                   "\"distinct\": %d, \"metrics\": %lu, \"calls\": %d, \"samples\": %d, \"failures\": %d, "
+                   "\"seconds\": %.6f, \"p50_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f, "
+                   "\"us_per_sample\": %.3f, \"cpu_us_per_sample\": %.3f}",
+                first ? "" : ",\n", bc->name, kind_name(bc->kind), output_name(bc->output), pids, distinct,
+                (unsigned long)metrics, r->calls, r->samples, r->failures, r->seconds, r->p50_us, r->p99_us,
+                r->max_us, per, cpuPer);
+    } else {
+        fprintf(f, "%s,%s,%s,%d,%d,%lu,%d,%d,%d,%.6f,%.2f,%.2f,%.2f,%.3f,%.3f\n",
+                bc->name, kind_name(bc->kind), output_name(bc->output), pids, distinct, (unsigned long)metrics,
+                r->calls, r->samples, r->failures, r->seconds, r->p50_us, r->p99_us, r->max_us, per, cpuPer);
+    }
+    fflush(f);
+}
+
+static void emit_footer(FILE *f, const BENCH_FORMAT fmt) {
+    if (fmt == BENCH_JSON) fprintf(f, "\n]\n");
+}
+
+// ============================================================
+// Arguments
+// ============================================================
+static int parse_int(const char *s, int *out) {
+    char *end = NULL;
+    const long v = strtol(s, &end, 10);
+    if (!end || end == s || (*end && *end != ',') || v <= 0 || v > INT_MAX) return 0;
+    *out = (int)v;
+    return 1;
+}
+
+static int parse_list(const char *s, int *out, const int max) {
+    int n = 0;
+    while (*s && n < max) {
+        if (!parse_int(s, &out[n])) return 0;
+        n++;
+        const char *comma = strchr(s, ',');
+        if (!comma) break;
+        s = comma + 1;
+    }
+    return n;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: processInspectBench [--format csv|json] [--out FILE] [--pids LIST] [--metrics HEX]\n"
+            "                           [--time-ms N] [--max-calls N] [--interval-ms N]\n"
+            "                           [--monitor-ms N] [--filter TEXT]\n"
+            "defaults: csv, stdout, pids 1,10,100,1000, metrics 7f (all but METRIC_NET),\n"
+            "          time-ms 500, max-calls 100000, interval-ms 10, monitor-ms 2000\n");
+}
+
+int main(const int argc, char **argv) {
+    int counts[16] = { 1, 10, 100, 1000 };
+    int ncounts = 4;
+    int time_ms = 500;
+    int max_calls = 100000;
+    int interval_ms = 10;
+    int monitor_ms = 2000;
+    DWORD metrics = 0x7F;
+    const char *filter = NULL;
+    const char *out_path = NULL;
+    BENCH_FORMAT fmt = BENCH_CSV;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        int ok = v != NULL;
+        if (ok && strcmp(a, "--format") == 0) {
+            if (strcmp(v, "json") == 0) fmt = BENCH_JSON;
+            else if (strcmp(v, "csv") == 0) fmt = BENCH_CSV;
+            else ok = 0;
+        } else if (ok && strcmp(a, "--out") == 0) out_path = v;
+        else if (ok && strcmp(a, "--pids") == 0) ok = (ncounts = parse_list(v, counts, 16)) > 0;
+        else if (ok && strcmp(a, "--metrics") == 0) {
+            char *end = NULL;
+            metrics = (DWORD)strtoul(v, &end, 16);
+            ok = end && end != v && !*end && metrics != 0;
+        }
+        else if (ok && strcmp(a, "--time-ms") == 0) ok = parse_int(v, &time_ms);
+        else if (ok && strcmp(a, "--max-calls") == 0) ok = parse_int(v, &max_calls);
+        else if (ok && strcmp(a, "--interval-ms") == 0) ok = parse_int(v, &interval_ms);
+        else if (ok && strcmp(a, "--monitor-ms") == 0) ok = parse_int(v, &monitor_ms);
+        else if (ok && strcmp(a, "--filter") == 0) filter = v;
+        else ok = 0;
+        if (!ok) {
+            usage();
+            return 2;
+        }
+        i++;
+    }
+
+    FILE *f = stdout;
+    if (out_path) {
+        f = fopen(out_path, "w");
+        if (!f) {
+            fprintf(stderr, "processInspectBench: cannot open %s\n", out_path);
+            return 1;
+        }
+    }
+
+    QueryPerformanceFrequency(&g_qpcFreq);
+
+    int maxCount = 1;
+    for (int c = 0; c < ncounts; c++) {
+        counts[c] = min(counts[c], BENCH_MAX_PIDS);
+        maxCount = max(maxCount, counts[c]);
+    }
+    DWORD *avail = (DWORD*)malloc(sizeof(DWORD) * (size_t)maxCount);
+    DWORD *pids = (DWORD*)malloc(sizeof(DWORD) * (size_t)maxCount);
+    if (!avail || !pids) {
+        fprintf(stderr, "processInspectBench: out of memory\n");
+        return 1;
+    }
+    const int navail = collect_pids(avail, maxCount, metrics);
+    fprintf(stderr, "%d accessible processes\n", navail);
+
+    BENCH_CASE cases[BENCH_MAX_CASES];
+    const int ncases = build_cases(cases);
+    int first = 1, failed = 0;
+
+    emit_header(f, fmt);
+    for (int c = 0; c < ncases; c++) {
+        if (filter && !strstr(cases[c].name, filter)) continue;
+        const int monitor = cases[c].kind == BENCH_MONITOR || cases[c].kind == BENCH_MONITOR_RING;
+        if (cases[c].kind == BENCH_SCAN && scan_sort_key(metrics) < 0) continue;
+        for (int p = 0; p < ncounts; p++) {
+            const int n = counts[p];
+            if (monitor && n > MAX_MONITORS) {
+                fprintf(stderr, "%s pids=%d skipped (at most %d monitors)\n", cases[c].name, n, MAX_MONITORS);
+                continue;
+            }
+            for (int i = 0; i < n; i++) pids[i] = avail[i % navail];
+
+            BENCH_RESULT r;
+            fprintf(stderr, "%s pids=%d\n", cases[c].name, n);
+            const int ok = monitor
+                ? run_monitor_case(&cases[c], pids, n, metrics, (DWORD)interval_ms, (DWORD)monitor_ms, max_calls, &r)
+                : run_call_case(&cases[c], pids, n, metrics, (DWORD)time_ms, max_calls, &r);
+            if (!ok) {
+                fprintf(stderr, "processInspectBench: out of memory for %s pids=%d\n", cases[c].name, n);
+                failed = 1;
+                continue;
+            }
+            emit_row(f, fmt, first, &cases[c], n, min(n, navail), metrics, &r);
+            first = 0;
+        }
+    }
+    emit_footer(f, fmt);
+
+    release_process_cache();
+    free(avail);
+    free(pids);
+    if (f != stdout) fclose(f);
+    return failed;
+}
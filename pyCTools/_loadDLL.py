@@ -1,7 +1,12 @@
 import ctypes
 import os
 import platform
-from typing import Callable, Optional
+import threading
+from typing import Callable, Dict, Optional
+
+# Libraries loaded through get_library, keyed by DLL prefix
+_libraries: Dict[str, object] = {}
+_libraries_lock = threading.Lock()
 
 
 def load_dll(
@@ -66,3 +71,56 @@ def load_dll(
 
     # Load and return the DLL using the specified loading function
     return dll_load_func(dll_path)
+
+
+def get_library(
+        dll_prefix_name: str,
+        dll_load_func: Callable = ctypes.WinDLL,
+        setup: Optional[Callable] = None
+):
+    """
+    Returns the process-wide handle of a DLL, loading and binding it on first use.
+
+    The first call loads the DLL through `load_dll` and runs `setup` on it, which is where
+    the wrapper modules declare their ctypes prototypes (`argtypes`/`restype`). Later calls
+    return the same object without touching the filesystem or re-binding anything, so
+    creating many wrapper instances costs no more than creating one.
+
+    Parameters
+    ----------
+    dll_prefix_name : str
+        The prefix of the DLL filename, as for `load_dll`. It is also the cache key.
+    dll_load_func : Callable, optional
+        The loader passed to `load_dll` on first use. Defaults to ctypes.WinDLL.
+    setup : Optional[Callable], optional
+        Called once with the loaded DLL before it is published to other callers.
+
+    Returns
+    -------
+    ctypes.CDLL or ctypes.WinDLL
+        The shared, fully bound DLL object.
+
+    Raises
+    ------
+    FileNotFoundError
+        If the DLL cannot be found. Nothing is cached, so a later call retries.
+    OSError
+        If the DLL fails to load.
+
+    Notes
+    -----
+    - Loading is serialized by a module lock; once cached, lookups take no lock.
+    - If `setup` raises, the library is not cached and the exception propagates.
+    """
+    library = _libraries.get(dll_prefix_name)
+    if library is not None:
+        return library
+
+    with _libraries_lock:
+        library = _libraries.get(dll_prefix_name)
+        if library is None:
+            library = load_dll(dll_prefix_name=dll_prefix_name, dll_load_func=dll_load_func)
+            if setup is not None:
+                setup(library)
+            _libraries[dll_prefix_name] = library
+    return library
@@ -1,8 +1,10 @@
+import array
 import ctypes
 import enum
-from typing import List, Optional, Union
+import threading
+from typing import Dict, List, Optional, Union
 
-from pyCTools._loadDLL import load_dll
+from pyCTools._loadDLL import get_library
 
 
 class HashAlgorithm(enum.IntEnum):
@@ -18,6 +20,8 @@ class ExpansionMode(enum.IntEnum):
     HKDF = 1  # HKDF-Expand using HMAC
     HMAC = 2  # HMAC(PRK, counter || prev) stream
     XOF = 3  # XOF-like fallback using HMAC stream
+    AESCTR = 4  # AES-256-CTR keystream keyed from the HKDF PRK
+    RDSEED = 5  # 64-bit RDSEED/RDRAND words straight from the CPU
 
 
 class ThreadingMode(enum.IntEnum):
@@ -25,6 +29,7 @@ class ThreadingMode(enum.IntEnum):
     NONE = 0  # lock-free
     CRITSEC = 1  # use internal critical section
     USERLOCK = 2  # user callbacks
+    TLS = 3  # per-thread DRBG, lock-free after seeding
 
 
 class SecurityMode(enum.IntEnum):
@@ -83,8 +88,237 @@ class RNGConfig(ctypes.Structure):
 
         # Optional HKDF info/context for Expand
         ("info", ctypes.c_void_p),  # const unsigned char*
-        ("info_len", ctypes.c_int)
+        ("info_len", ctypes.c_int),
+
+        # Adaptive source selection budget in microseconds (0 = off)
+        ("collector_budget_us", ctypes.c_uint),
+
+        # Run the slow collectors concurrently on the thread pool
+        ("parallel_collect", ctypes.c_int)
+    ]
+
+
+# Collector order used by maxrng_get_stats (RNG_SOURCE)
+COLLECTOR_NAMES = ("rdrand", "cpu", "memory", "perf", "disk", "audio", "battery", "network")
+
+
+class CollectorStats(ctypes.Structure):
+    """Per-collector counters (RNG_COLLECTOR_STATS); times are QPC ticks."""
+    _fields_ = [
+        ("calls", ctypes.c_ulonglong),
+        ("skipped", ctypes.c_ulonglong),
+        ("total_qpc", ctypes.c_ulonglong),
+        ("max_qpc", ctypes.c_ulonglong),
+        ("bytes", ctypes.c_ulonglong)
+    ]
+
+
+class DRBG:
+    """
+    Seeded HMAC-DRBG instance backed by the hRng library.
+
+    Entropy is gathered once when the generator is created and again only when
+    the reseed budget (bytes produced or elapsed time) is exhausted, so each
+    `generate` call costs microseconds instead of a full entropy collection.
+
+    Instances are created through `MaxRNG.create_drbg` and should be closed
+    (or used as a context manager) to wipe the native state.
+    """
+
+    def __init__(self, dll, handle):
+        self._dll = dll
+        self._handle = handle
+
+    def generate(self, size: int) -> bytes:
+        """
+        Generate random bytes from the DRBG.
+
+        Args:
+            size (int): Number of random bytes to generate.
+
+        Returns:
+            bytes: Random bytes generated.
+
+        Raises:
+            RuntimeError: If the generator is closed or generation fails.
+        """
+        if not self._handle:
+            raise RuntimeError("DRBG has been closed")
+        buf = (ctypes.c_ubyte * size)()
+        if not self._dll.maxrng_drbg_generate(self._handle, buf, size):
+            raise RuntimeError("Failed to generate DRBG random data")
+        return bytes(buf)
+
+    def reseed(self, additional: Optional[bytes] = None) -> None:
+        """
+        Force a reseed from the configured entropy sources.
+
+        Args:
+            additional: Optional additional input mixed into the new state.
+
+        Raises:
+            RuntimeError: If the generator is closed or reseeding fails.
+        """
+        if not self._handle:
+            raise RuntimeError("DRBG has been closed")
+        add_len = len(additional) if additional else 0
+        if not self._dll.maxrng_drbg_reseed(self._handle, additional if additional else None, add_len):
+            raise RuntimeError("Failed to reseed DRBG")
+
+    def close(self) -> None:
+        """Wipe and release the native generator state."""
+        if self._handle:
+            self._dll.maxrng_drbg_destroy(self._handle)
+            self._handle = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+
+def _setup_basic_functions(dll):
+    """Set up ctypes bindings for the basic RNG functions."""
+    # int test_rng_available(void)
+    dll.test_rng_available.argtypes = []
+    dll.test_rng_available.restype = ctypes.c_int
+
+    # int test_threading_available(void)
+    dll.test_threading_available.argtypes = []
+    dll.test_threading_available.restype = ctypes.c_int
+
+    # void maxrng_init(void)
+    dll.maxrng_init.argtypes = []
+    dll.maxrng_init.restype = None
+
+    # void maxrng_shutdown(void)
+    dll.maxrng_shutdown.argtypes = []
+    dll.maxrng_shutdown.restype = None
+
+    # int maxrng_pool_start(int pool_size, unsigned int refill_ms)
+    dll.maxrng_pool_start.argtypes = [ctypes.c_int, ctypes.c_uint]
+    dll.maxrng_pool_start.restype = ctypes.c_int
+
+    # int maxrng_pool_stop(void)
+    dll.maxrng_pool_stop.argtypes = []
+    dll.maxrng_pool_stop.restype = ctypes.c_int
+
+    # int maxrng_pool_fill_level(void)
+    dll.maxrng_pool_fill_level.argtypes = []
+    dll.maxrng_pool_fill_level.restype = ctypes.c_int
+
+    # int maxrng_audio_start(void)
+    dll.maxrng_audio_start.argtypes = []
+    dll.maxrng_audio_start.restype = ctypes.c_int
+
+    # int maxrng_audio_stop(void)
+    dll.maxrng_audio_stop.argtypes = []
+    dll.maxrng_audio_stop.restype = ctypes.c_int
+
+    # void maxrng_set_source_ttl(unsigned int ttl_ms)
+    dll.maxrng_set_source_ttl.argtypes = [ctypes.c_uint]
+    dll.maxrng_set_source_ttl.restype = None
+
+    # int maxrng_enable_stats(int enable)
+    dll.maxrng_enable_stats.argtypes = [ctypes.c_int]
+    dll.maxrng_enable_stats.restype = ctypes.c_int
+
+    # int maxrng_get_stats(RNG_COLLECTOR_STATS *out, int max_entries, unsigned long long *qpc_freq)
+    dll.maxrng_get_stats.argtypes = [ctypes.POINTER(CollectorStats), ctypes.c_int,
+                                     ctypes.POINTER(ctypes.c_ulonglong)]
+    dll.maxrng_get_stats.restype = ctypes.c_int
+
+    # void maxrng_reset_stats(void)
+    dll.maxrng_reset_stats.argtypes = []
+    dll.maxrng_reset_stats.restype = None
+
+    # int maxrng(unsigned char *buffer, int size)
+    dll.maxrng.argtypes = [ctypes.POINTER(ctypes.c_ubyte), ctypes.c_int]
+    dll.maxrng.restype = ctypes.c_int
+
+    # int maxrng_ultra(unsigned char *buffer, int size, int complexity)
+    dll.maxrng_ultra.argtypes = [ctypes.POINTER(ctypes.c_ubyte), ctypes.c_int, ctypes.c_int]
+    dll.maxrng_ultra.restype = ctypes.c_int
+
+    # int maxrng_threadsafe(unsigned char *buffer, int size, int complexity)
+    dll.maxrng_threadsafe.argtypes = [ctypes.POINTER(ctypes.c_ubyte), ctypes.c_int, ctypes.c_int]
+    dll.maxrng_threadsafe.restype = ctypes.c_int
+
+
+def _setup_advanced_functions(dll):
+    """Set up ctypes bindings for the advanced RNG functions."""
+    # void maxrng_dev_default_config(RNG_CONFIG *cfg, RNG_SECURITY_MODE mode)
+    dll.maxrng_dev_default_config.argtypes = [ctypes.POINTER(RNGConfig), ctypes.c_int]
+    dll.maxrng_dev_default_config.restype = None
+
+    # int maxrng_dev(unsigned char *out_buf, int out_buf_len, int raw_len, const RNG_CONFIG *cfg_in)
+    dll.maxrng_dev.argtypes = [
+        ctypes.POINTER(ctypes.c_ubyte),  # out_buf
+        ctypes.c_int,  # out_buf_len
+        ctypes.c_int,  # raw_len
+        ctypes.POINTER(RNGConfig)  # cfg_in
+    ]
+    dll.maxrng_dev.restype = ctypes.c_int
+
+    # int maxrng_dev_batch(unsigned char *out_buf, int out_buf_len, int record_len, int count,
+    #                      const RNG_CONFIG *cfg_in)
+    dll.maxrng_dev_batch.argtypes = [
+        ctypes.POINTER(ctypes.c_ubyte),  # out_buf
+        ctypes.c_int,  # out_buf_len
+        ctypes.c_int,  # record_len
+        ctypes.c_int,  # count
+        ctypes.POINTER(RNGConfig)  # cfg_in
     ]
+    dll.maxrng_dev_batch.restype = ctypes.c_int
+
+    # int maxrng_uniform_u64(uint64_t lo, uint64_t hi, uint64_t *out, int n)
+    dll.maxrng_uniform_u64.argtypes = [ctypes.c_uint64, ctypes.c_uint64,
+                                       ctypes.POINTER(ctypes.c_uint64), ctypes.c_int]
+    dll.maxrng_uniform_u64.restype = ctypes.c_int
+
+    # int maxrng_uniform_double(double *out, int n)
+    dll.maxrng_uniform_double.argtypes = [ctypes.POINTER(ctypes.c_double), ctypes.c_int]
+    dll.maxrng_uniform_double.restype = ctypes.c_int
+
+    # int maxrng_shuffle_indices(uint32_t *perm, int n)
+    dll.maxrng_shuffle_indices.argtypes = [ctypes.POINTER(ctypes.c_uint32), ctypes.c_int]
+    dll.maxrng_shuffle_indices.restype = ctypes.c_int
+
+    # int maxrng_encode(const unsigned char *in, int in_len, unsigned char *out, int out_len,
+    #                   RNG_OUTPUT_MODE mode)
+    dll.maxrng_encode.argtypes = [ctypes.c_char_p, ctypes.c_int,
+                                  ctypes.POINTER(ctypes.c_ubyte), ctypes.c_int, ctypes.c_int]
+    dll.maxrng_encode.restype = ctypes.c_int
+
+    # RNG_DRBG *maxrng_drbg_create(const RNG_CONFIG *cfg, unsigned long long reseed_bytes, unsigned int reseed_ms)
+    dll.maxrng_drbg_create.argtypes = [ctypes.POINTER(RNGConfig), ctypes.c_ulonglong, ctypes.c_uint]
+    dll.maxrng_drbg_create.restype = ctypes.c_void_p
+
+    # int maxrng_drbg_generate(RNG_DRBG *drbg, unsigned char *out, int len)
+    dll.maxrng_drbg_generate.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_ubyte), ctypes.c_int]
+    dll.maxrng_drbg_generate.restype = ctypes.c_int
+
+    # int maxrng_drbg_reseed(RNG_DRBG *drbg, const unsigned char *additional, int add_len)
+    dll.maxrng_drbg_reseed.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_int]
+    dll.maxrng_drbg_reseed.restype = ctypes.c_int
+
+    # void maxrng_drbg_destroy(RNG_DRBG *drbg)
+    dll.maxrng_drbg_destroy.argtypes = [ctypes.c_void_p]
+    dll.maxrng_drbg_destroy.restype = None
+
+
+# SecurityMode -> RNGConfig built by create_config, copied for every preset-based call
+_preset_configs: Dict[SecurityMode, RNGConfig] = {}
+
+
+def _bind_hrng(dll):
+    """Declare every hRng prototype once, when the shared DLL handle is first loaded."""
+    _setup_basic_functions(dll)
+    _setup_advanced_functions(dll)
 
 
 class MaxRNG:
@@ -115,57 +349,79 @@ class MaxRNG:
     """
 
     # Internal handlers
-    def __init__(self):
-        """Initialize the MaxRNG wrapper by loading the appropriate DLL."""
-        # Load the DLL using the load_dll helper with WinDLL loader
-        self.dll = load_dll(dll_prefix_name="hRng", dll_load_func=ctypes.WinDLL)
-
-        # Define basic function signatures
-        self._setup_basic_functions()
-
-        # Define advanced function signatures
-        self._setup_advanced_functions()
-
-    def _setup_basic_functions(self):
-        """Set up ctypes bindings for the basic RNG functions."""
-        # int test_rng_available(void)
-        self.dll.test_rng_available.argtypes = []
-        self.dll.test_rng_available.restype = ctypes.c_int
-
-        # int test_threading_available(void)
-        self.dll.test_threading_available.argtypes = []
-        self.dll.test_threading_available.restype = ctypes.c_int
-
-        # void maxrng_init(void)
-        self.dll.maxrng_init.argtypes = []
-        self.dll.maxrng_init.restype = None
-
-        # int maxrng(unsigned char *buffer, int size)
-        self.dll.maxrng.argtypes = [ctypes.POINTER(ctypes.c_ubyte), ctypes.c_int]
-        self.dll.maxrng.restype = ctypes.c_int
-
-        # int maxrng_ultra(unsigned char *buffer, int size, int complexity)
-        self.dll.maxrng_ultra.argtypes = [ctypes.POINTER(ctypes.c_ubyte), ctypes.c_int, ctypes.c_int]
-        self.dll.maxrng_ultra.restype = ctypes.c_int
-
-        # int maxrng_threadsafe(unsigned char *buffer, int size, int complexity)
-        self.dll.maxrng_threadsafe.argtypes = [ctypes.POINTER(ctypes.c_ubyte), ctypes.c_int, ctypes.c_int]
-        self.dll.maxrng_threadsafe.restype = ctypes.c_int
-
-    def _setup_advanced_functions(self):
-        """Set up ctypes bindings for the advanced RNG functions."""
-        # void maxrng_dev_default_config(RNG_CONFIG *cfg, RNG_SECURITY_MODE mode)
-        self.dll.maxrng_dev_default_config.argtypes = [ctypes.POINTER(RNGConfig), ctypes.c_int]
-        self.dll.maxrng_dev_default_config.restype = None
-
-        # int maxrng_dev(unsigned char *out_buf, int out_buf_len, int raw_len, const RNG_CONFIG *cfg_in)
-        self.dll.maxrng_dev.argtypes = [
-            ctypes.POINTER(ctypes.c_ubyte),  # out_buf
-            ctypes.c_int,  # out_buf_len
-            ctypes.c_int,  # raw_len
-            ctypes.POINTER(RNGConfig)  # cfg_in
-        ]
-        self.dll.maxrng_dev.restype = ctypes.c_int
+    def __init__(self, prefetch_size: int = 4096):
+        """
+        Initialize the MaxRNG wrapper by loading the appropriate DLL.
+
+        Args:
+            prefetch_size (int): Size of the internal buffer that small helpers
+                (`generate_uint32`, `generate_float`, `generate_range`, ...) draw from,
+                refilled with one `maxrng_dev_batch` call. 0 disables prefetching so
+                every helper call goes to the DLL.
+        """
+        # Shared DLL handle: loaded and bound on the first MaxRNG, reused by every later one
+        self.dll = get_library("hRng", ctypes.WinDLL, _bind_hrng)
+
+        # Prefetch buffer for small draws
+        self._prefetch_size = max(0, prefetch_size)
+        self._prefetch_buf = bytearray()
+        self._prefetch_pos = 0
+        self._prefetch_config = None
+        self._prefetch_lock = threading.Lock()
+
+    def _resolve_config(self, config: Optional[Union[RNGConfig, SecurityMode]]) -> RNGConfig:
+        """
+        Turn a SecurityMode preset (or None for BALANCED) into a private RNGConfig.
+
+        Presets are built once per process and handed out as copies, so the hot
+        generation paths skip `create_config` and its DLL call. Callers may modify
+        the returned copy freely.
+
+        Args:
+            config: RNGConfig structure (returned as is) or SecurityMode preset.
+
+        Returns:
+            RNGConfig: Configuration to pass to the DLL.
+        """
+        if isinstance(config, SecurityMode) or config is None:
+            security_mode = config if config is not None else SecurityMode.BALANCED
+            preset = _preset_configs.get(security_mode)
+            if preset is None:
+                preset = _preset_configs.setdefault(security_mode, self.create_config(security_mode=security_mode))
+            return RNGConfig.from_buffer_copy(preset)
+        return config
+
+    def _take(self, size: int) -> bytes:
+        """
+        Draw `size` bytes from the prefetch buffer, refilling it with a single
+        native batch call when it runs low.
+
+        Args:
+            size (int): Number of bytes to draw.
+
+        Returns:
+            bytes: Random bytes, each handed out only once.
+        """
+        if self._prefetch_size == 0:
+            return self.generate(size)
+
+        with self._prefetch_lock:
+            if len(self._prefetch_buf) - self._prefetch_pos < size:
+                if self._prefetch_config is None:
+                    self._prefetch_config = self.create_config(security_mode=SecurityMode.BALANCED)
+                refill = max(self._prefetch_size, size)
+                buf = (ctypes.c_ubyte * refill)()
+                written = self.dll.maxrng_dev_batch(buf, refill, refill, 1, ctypes.byref(self._prefetch_config))
+                if written <= 0:
+                    raise RuntimeError("Failed to refill random prefetch buffer")
+                self._prefetch_buf = bytearray(buf)
+                self._prefetch_pos = 0
+            start = self._prefetch_pos
+            self._prefetch_pos += size
+            out = bytes(self._prefetch_buf[start:self._prefetch_pos])
+            # Do not leave consumed bytes behind in the buffer
+            self._prefetch_buf[start:self._prefetch_pos] = bytes(size)
+            return out
 
     # Availability checks
     def is_available(self) -> bool:
@@ -196,6 +452,126 @@ class MaxRNG:
         """
         self.dll.maxrng_init()
 
+    def shutdown(self) -> None:
+        """
+        Release the BCrypt providers cached by the DLL.
+
+        Call this before unloading the library. It must not run while other threads
+        are generating; providers are reopened automatically on the next call.
+        """
+        self.dll.maxrng_shutdown()
+
+    # Background entropy pool
+    def start_entropy_pool(self, size: int = 4096, refill_ms: int = 1000) -> bool:
+        """
+        Start the background entropy pool.
+
+        A native worker thread keeps running the slow collectors (disk, audio, network)
+        into a double-buffered pool, so generation calls hash ready entropy instead of
+        waiting on those collectors.
+
+        Args:
+            size (int): Bytes per pool buffer.
+            refill_ms (int): Interval between refills in milliseconds.
+
+        Returns:
+            bool: True if the pool was started, False if it was already running.
+        """
+        return bool(self.dll.maxrng_pool_start(size, refill_ms))
+
+    def stop_entropy_pool(self) -> bool:
+        """
+        Stop the background entropy pool and wipe its buffers.
+
+        Returns:
+            bool: True if the pool was stopped, False if it was not running.
+        """
+        return bool(self.dll.maxrng_pool_stop())
+
+    def entropy_pool_fill_level(self) -> int:
+        """
+        Get the number of ready bytes in the entropy pool.
+
+        Returns:
+            int: Ready bytes (0 if the pool is stopped or has not filled yet).
+        """
+        return self.dll.maxrng_pool_fill_level()
+
+    def start_audio_capture(self) -> bool:
+        """
+        Keep the default audio capture device open and streaming into a native ring buffer.
+
+        While running, the audio collector hashes the newest samples instead of opening
+        the device and sleeping on every round.
+
+        Returns:
+            bool: True if capture started, False if already running or no device is available.
+        """
+        return bool(self.dll.maxrng_audio_start())
+
+    def stop_audio_capture(self) -> bool:
+        """
+        Close the persistent audio capture device.
+
+        Returns:
+            bool: True if capture was running.
+        """
+        return bool(self.dll.maxrng_audio_stop())
+
+    def set_source_cache_ttl(self, ttl_ms: int = 5000) -> None:
+        """
+        Set how long disk and network snapshots are reused between collection rounds.
+
+        Caching is off until this is called: by default every round queries the system.
+        Network snapshots are also refreshed whenever an interface or address changes.
+        Every round still hashes a fresh high-resolution timestamp.
+
+        Args:
+            ttl_ms (int): Reuse window in milliseconds (0 = query the system every round).
+        """
+        self.dll.maxrng_set_source_ttl(ttl_ms)
+
+    def enable_collector_stats(self, enable: bool = True) -> bool:
+        """
+        Turn per-collector timing and byte counters on or off (off by default).
+
+        Args:
+            enable (bool): Whether the counters should be recorded.
+
+        Returns:
+            bool: The previous state.
+        """
+        return bool(self.dll.maxrng_enable_stats(1 if enable else 0))
+
+    def get_collector_stats(self) -> Dict[str, Dict[str, float]]:
+        """
+        Read the per-collector counters.
+
+        Returns:
+            Dict[str, Dict[str, float]]: For each collector name ("rdrand", "cpu", ...), a dict
+            with "calls", "skipped", "bytes", "total_us", "max_us" and "avg_us".
+        """
+        entries = (CollectorStats * len(COLLECTOR_NAMES))()
+        freq = ctypes.c_ulonglong(0)
+        count = self.dll.maxrng_get_stats(entries, len(COLLECTOR_NAMES), ctypes.byref(freq))
+        to_us = 1e6 / freq.value if freq.value else 0.0
+
+        stats = {}
+        for name, entry in zip(COLLECTOR_NAMES[:count], entries):
+            stats[name] = {
+                "calls": entry.calls,
+                "skipped": entry.skipped,
+                "bytes": entry.bytes,
+                "total_us": entry.total_qpc * to_us,
+                "max_us": entry.max_qpc * to_us,
+                "avg_us": (entry.total_qpc * to_us / entry.calls) if entry.calls else 0.0,
+            }
+        return stats
+
+    def reset_collector_stats(self) -> None:
+        """Zero every per-collector counter."""
+        self.dll.maxrng_reset_stats()
+
     def create_config(self,
                       security_mode: SecurityMode = SecurityMode.BALANCED,
                       hash_algo: HashAlgorithm = HashAlgorithm.SHA256,
@@ -206,7 +582,9 @@ class MaxRNG:
                       threading: ThreadingMode = ThreadingMode.NONE,
                       seed: Optional[bytes] = None,
                       info: Optional[bytes] = None,
-                      sources: Optional[List[str]] = None) -> RNGConfig:
+                      sources: Optional[List[str]] = None,
+                      collector_budget_us: int = 0,
+                      parallel_collect: bool = False) -> RNGConfig:
         """
         Create a customized RNG configuration.
 
@@ -217,11 +595,15 @@ class MaxRNG:
             output_mode: Output format (RAW, HEX, BASE64)
             complexity: Complexity level (1-10), higher is more secure
             mixing: Entropy mixing strategy (ROUND_BASED, CONTINUOUS)
-            threading: Thread-safety approach (NONE, CRITSEC, USERLOCK)
+            threading: Thread-safety approach (NONE, CRITSEC, USERLOCK, TLS)
             seed: Optional seed material (bytes)
             info: Optional context info for HKDF (bytes)
             sources: List of entropy sources to enable ("cpu", "rdrand", "memory",
                     "perf", "disk", "audio", "battery", "network")
+            collector_budget_us: Adaptive source selection; a collector whose first round
+                    takes longer than this is skipped for the remaining rounds (0 = off)
+            parallel_collect: Run the disk, audio, battery and network collectors
+                    concurrently on the Windows thread pool
 
         Returns:
             RNGConfig: Configured RNG settings structure
@@ -237,6 +619,8 @@ class MaxRNG:
         config.complexity = complexity
         config.mixing = mixing
         config.threading = threading
+        config.collector_budget_us = collector_budget_us
+        config.parallel_collect = 1 if parallel_collect else 0
 
         # Set up seed if provided
         if seed:
@@ -374,9 +758,7 @@ class MaxRNG:
             RuntimeError: If random generation fails
         """
         # Handle the case where config is a SecurityMode enum
-        if isinstance(config, SecurityMode) or config is None:
-            security_mode = config if config is not None else SecurityMode.BALANCED
-            config = self.create_config(security_mode=security_mode)
+        config = self._resolve_config(config)
 
         # Override output mode if specified
         if output_mode is not None:
@@ -405,13 +787,238 @@ class MaxRNG:
             raise RuntimeError("Failed to generate custom random data")
 
         # Convert to the appropriate return type
-        result = bytes(out_buf[:bytes_written])
+        result = ctypes.string_at(out_buf, bytes_written)
         if config.output_mode == OutputMode.RAW:
             return result
         else:
             # For HEX and BASE64, return as string
             return result.decode('ascii')
 
+    def create_drbg(self,
+                    config: Optional[Union[RNGConfig, SecurityMode]] = None,
+                    reseed_bytes: int = 0,
+                    reseed_ms: int = 0) -> DRBG:
+        """
+        Create a seeded DRBG that only collects entropy when its reseed budget runs out.
+
+        Args:
+            config: RNGConfig structure or SecurityMode preset used for seeding.
+                    A config seed is used as the personalization string.
+            reseed_bytes: Reseed after this many output bytes (0 = default, 1 MiB).
+            reseed_ms: Reseed after this many milliseconds (0 = default, 60 s).
+
+        Returns:
+            DRBG: The generator instance.
+
+        Raises:
+            RuntimeError: If the generator cannot be seeded.
+        """
+        config = self._resolve_config(config)
+
+        handle = self.dll.maxrng_drbg_create(ctypes.byref(config), reseed_bytes, reseed_ms)
+        if not handle:
+            raise RuntimeError("Failed to create DRBG")
+        return DRBG(self.dll, handle)
+
+    def generate_into(self,
+                      buf,
+                      config: Optional[Union[RNGConfig, SecurityMode]] = None) -> int:
+        """
+        Fill a caller-supplied writable buffer in place, without intermediate copies.
+
+        Any C-contiguous writable object supporting the buffer protocol works
+        (bytearray, memoryview, array.array, numpy arrays, mmap). The DLL writes
+        straight into its memory. In HEX/BASE64 mode the buffer receives the
+        encoded text of as many raw bytes as fit.
+
+        Args:
+            buf: Writable, C-contiguous buffer to fill.
+            config: RNGConfig structure or SecurityMode preset.
+
+        Returns:
+            int: Number of bytes written into `buf`.
+
+        Raises:
+            TypeError: If the buffer is read-only.
+            ValueError: If the buffer is not C-contiguous.
+            RuntimeError: If random generation fails.
+        """
+        config = self._resolve_config(config)
+
+        with memoryview(buf) as view:
+            if view.readonly:
+                raise TypeError("Buffer must be writable")
+            if not view.c_contiguous:
+                raise ValueError("Buffer must be C-contiguous")
+
+            with view.cast('B') as raw_view:
+                total = raw_view.nbytes
+                # maxrng_dev takes int lengths: fill very large buffers in chunks
+                chunk = 1 << 30
+                if config.output_mode == OutputMode.HEX:
+                    unit_out, unit_raw = 2, 1
+                elif config.output_mode == OutputMode.BASE64:
+                    unit_out, unit_raw = 4, 3
+                else:
+                    unit_out, unit_raw = 1, 1
+                chunk -= chunk % unit_out
+
+                written = 0
+                while total - written >= unit_out:
+                    out_len = min(chunk, total - written)
+                    out_len -= out_len % unit_out
+                    raw_len = out_len // unit_out * unit_raw
+                    c_buf = (ctypes.c_ubyte * out_len).from_buffer(raw_view, written)
+                    n = self.dll.maxrng_dev(c_buf, out_len, raw_len, ctypes.byref(config))
+                    del c_buf
+                    if n <= 0:
+                        raise RuntimeError("Failed to generate random data into buffer")
+                    written += n
+                return written
+
+    def generate_batch(self,
+                       record_size: int,
+                       count: int,
+                       config: Optional[Union[RNGConfig, SecurityMode]] = None) -> List[Union[bytes, str]]:
+        """
+        Generate many fixed-size random records with a single native call.
+
+        Args:
+            record_size (int): Raw bytes per record (before encoding).
+            count (int): Number of records.
+            config: RNGConfig structure or SecurityMode preset.
+
+        Returns:
+            List[Union[bytes, str]]: `count` records, as bytes for OutputMode.RAW
+            or strings for HEX/BASE64.
+
+        Raises:
+            RuntimeError: If random generation fails.
+        """
+        config = self._resolve_config(config)
+
+        stride = record_size
+        if config.output_mode == OutputMode.HEX:
+            stride = record_size * 2
+        elif config.output_mode == OutputMode.BASE64:
+            stride = 4 * ((record_size + 2) // 3)
+
+        out_size = stride * count
+        out_buf = (ctypes.c_ubyte * out_size)()
+        bytes_written = self.dll.maxrng_dev_batch(out_buf, out_size, record_size, count, ctypes.byref(config))
+        if bytes_written <= 0:
+            raise RuntimeError("Failed to generate batch random data")
+
+        data = bytes(out_buf)
+        records = [data[i * stride:(i + 1) * stride] for i in range(count)]
+        if config.output_mode == OutputMode.RAW:
+            return records
+        return [r.decode('ascii') for r in records]
+
+    # Native sampling kernels
+    def uniform_u64(self, lo: int, hi: int, count: int) -> array.array:
+        """
+        Draw unbiased integers in the inclusive range [lo, hi] natively.
+
+        Values come from the calling thread's DRBG and are written straight into
+        the returned array, which supports the buffer protocol (numpy.frombuffer).
+        The native kernels always use the BALANCED preset.
+
+        Args:
+            lo (int): Lower bound (inclusive), 0 <= lo <= hi < 2**64.
+            hi (int): Upper bound (inclusive).
+            count (int): Number of values.
+
+        Returns:
+            array.array: Array of typecode 'Q' with `count` values.
+
+        Raises:
+            ValueError: If the bounds are invalid.
+            RuntimeError: If generation fails.
+        """
+        if not 0 <= lo <= hi < 2 ** 64:
+            raise ValueError("Bounds must satisfy 0 <= lo <= hi < 2**64")
+        out = array.array('Q', bytes(8 * count))
+        if count == 0:
+            return out
+        ptr, _ = out.buffer_info()
+        if not self.dll.maxrng_uniform_u64(lo, hi, ctypes.cast(ptr, ctypes.POINTER(ctypes.c_uint64)), count):
+            raise RuntimeError("Failed to generate uniform integers")
+        return out
+
+    def uniform_double(self, count: int) -> array.array:
+        """
+        Draw doubles uniformly distributed in [0.0, 1.0) natively (53 random bits each).
+
+        Args:
+            count (int): Number of values.
+
+        Returns:
+            array.array: Array of typecode 'd' with `count` values.
+
+        Raises:
+            RuntimeError: If generation fails.
+        """
+        out = array.array('d', bytes(8 * count))
+        if count == 0:
+            return out
+        ptr, _ = out.buffer_info()
+        if not self.dll.maxrng_uniform_double(ctypes.cast(ptr, ctypes.POINTER(ctypes.c_double)), count):
+            raise RuntimeError("Failed to generate uniform doubles")
+        return out
+
+    def permutation(self, n: int) -> array.array:
+        """
+        Generate a uniformly random permutation of range(n) natively (Fisher-Yates).
+
+        Args:
+            n (int): Permutation size (< 2**32).
+
+        Returns:
+            array.array: Array of typecode 'I' holding the permuted indices.
+
+        Raises:
+            RuntimeError: If generation fails.
+        """
+        perm = array.array('I', bytes(4 * n))
+        if n == 0:
+            return perm
+        ptr, _ = perm.buffer_info()
+        if not self.dll.maxrng_shuffle_indices(ctypes.cast(ptr, ctypes.POINTER(ctypes.c_uint32)), n):
+            raise RuntimeError("Failed to generate permutation")
+        return perm
+
+    def encode(self, data: bytes, output_mode: OutputMode = OutputMode.HEX) -> str:
+        """
+        Hex or base64 encode bytes with the library's SIMD encoders.
+
+        Useful for DRBG output or any other data produced outside maxrng_dev.
+
+        Args:
+            data (bytes): Bytes to encode.
+            output_mode (OutputMode): OutputMode.HEX or OutputMode.BASE64.
+
+        Returns:
+            str: Encoded string (lowercase hex, or padded standard base64).
+
+        Raises:
+            ValueError: If the output mode is not HEX or BASE64.
+            RuntimeError: If encoding fails.
+        """
+        if output_mode == OutputMode.HEX:
+            out_size = len(data) * 2
+        elif output_mode == OutputMode.BASE64:
+            out_size = 4 * ((len(data) + 2) // 3)
+        else:
+            raise ValueError("output_mode must be OutputMode.HEX or OutputMode.BASE64")
+        if not data:
+            return ""
+
+        out_buf = (ctypes.c_ubyte * out_size)()
+        if self.dll.maxrng_encode(bytes(data), len(data), out_buf, out_size, int(output_mode)) != out_size:
+            raise RuntimeError("Failed to encode data")
+        return bytes(out_buf).decode('ascii')
+
     # Convenience methods for common random use cases
     def generate_hex(self, size: int, security: SecurityMode = SecurityMode.BALANCED) -> str:
         """Generate random data as a hex string."""
@@ -435,12 +1042,12 @@ class MaxRNG:
 
     def generate_uint32(self) -> int:
         """Generate a random 32-bit unsigned integer."""
-        buf = self.generate(4)
+        buf = self._take(4)
         return int.from_bytes(buf, byteorder='little', signed=False)
 
     def generate_uint64(self) -> int:
         """Generate a random 64-bit unsigned integer."""
-        buf = self.generate(8)
+        buf = self._take(8)
         return int.from_bytes(buf, byteorder='little', signed=False)
 
     def generate_float(self) -> float:
@@ -453,6 +1060,10 @@ class MaxRNG:
         """
         Generate a random integer in the specified range [start, end).
 
+        Values are drawn from the prefetch buffer without modulo bias: ranges up to
+        2**64 values use Lemire's multiply-and-reject on 64-bit words, wider ranges
+        rejection sampling on whole bytes.
+
         Args:
             start: Lower bound (inclusive)
             end: Upper bound (exclusive)
@@ -464,27 +1075,21 @@ class MaxRNG:
             raise ValueError("End must be greater than start")
 
         range_size = end - start
-
-        # Determine how many bytes we need
-        if range_size <= 256:
-            bytes_needed = 1
-        elif range_size <= 65536:
-            bytes_needed = 2
-        elif range_size <= 16777216:
-            bytes_needed = 3
-        else:
-            bytes_needed = 4
-
-        # For large ranges, use 8 bytes
-        if range_size > 4294967296:
-            bytes_needed = 8
-
-        # Get random bytes and convert to integer
-        buf = self.generate(bytes_needed)
-        value = int.from_bytes(buf, byteorder='little', signed=False)
-
-        # Map to the desired range
-        return start + (value % range_size)
+        if range_size <= 2 ** 64:
+            # Reject the 64-bit products whose low half falls below 2**64 mod range_size
+            threshold = (2 ** 64 - range_size) % range_size
+            while True:
+                product = int.from_bytes(self._take(8), byteorder='little', signed=False) * range_size
+                if (product & 0xFFFFFFFFFFFFFFFF) >= threshold:
+                    return start + (product >> 64)
+
+        # Wider than 64 bits: rejection sampling on whole bytes
+        nbytes = (range_size.bit_length() + 7) // 8
+        limit = (256 ** nbytes // range_size) * range_size
+        while True:
+            value = int.from_bytes(self._take(nbytes), byteorder='little', signed=False)
+            if value < limit:
+                return start + (value % range_size)
 
     # Convenience methods for common operations
     def choose(self, items: List) -> object:
@@ -507,14 +1112,15 @@ class MaxRNG:
         """
         Shuffle a list in-place using high-quality randomness.
 
+        The permutation is drawn natively in a single call.
+
         Args:
             items: List to shuffle
 
         Returns:
             List: The shuffled list (same object, modified in-place)
         """
-        n = len(items)
-        for i in range(n - 1, 0, -1):
-            j = self.generate_range(0, i + 1)
-            items[i], items[j] = items[j], items[i]
+        if len(items) > 1:
+            perm = self.permutation(len(items))
+            items[:] = [items[i] for i in perm]
         return items
@@ -1,8 +1,607 @@
 import ctypes
+import itertools
 import json
-from ctypes import c_char_p, c_size_t, c_ulong, create_string_buffer, CFUNCTYPE, c_void_p, c_int
+import mmap
+import threading
+from ctypes import c_char_p, c_size_t, c_ulong, create_string_buffer, CFUNCTYPE, c_void_p, c_int, c_wchar_p
+from typing import List
 
-from pyCTools._loadDLL import load_dll
+from pyCTools._loadDLL import get_library
+
+
+class MetricsRecord(ctypes.Structure):
+    """
+    Binary metrics record filled by the `*_record` DLL functions, mirroring the packed
+    `METRICS_RECORD` C struct. Only the fields whose METRIC_* flag is set in `metrics`
+    carry meaningful values.
+
+    Arrays of records (as returned by `ProcessMetrics.get_batch_records`) support the
+    buffer protocol, so they can be viewed without copying, e.g. through
+    `numpy.frombuffer(records, dtype=...)`.
+
+    With `METRIC_SELF_PROFILE`, `phase_ns` holds the sampler's own time per phase (named by
+    `PROFILE_PHASES`) and `sampler_cpu_us` the CPU time the sampling thread has used so far.
+    """
+    VERSION = 5
+
+    PROFILE_PHASES = ("open", "memory", "handles", "threads", "cpu", "io", "net", "format", "callback")
+
+    STATUS_OK = 0
+    STATUS_UNAVAILABLE = 1
+
+    _pack_ = 1
+    _fields_ = [
+        ("version", ctypes.c_ushort),
+        ("size", ctypes.c_ushort),
+        ("pid", c_ulong),
+        ("metrics", c_ulong),
+        ("status", c_ulong),
+        ("working_set_kb", ctypes.c_ulonglong),
+        ("private_kb", ctypes.c_ulonglong),
+        ("pagefile_kb", ctypes.c_ulonglong),
+        ("handles", c_ulong),
+        ("threads", c_ulong),
+        ("cpu", ctypes.c_double),
+        ("io_read_kb", ctypes.c_ulonglong),
+        ("io_write_kb", ctypes.c_ulonglong),
+        # Version 2
+        ("timestamp_us", ctypes.c_ulonglong),
+        ("missed", c_ulong),
+        ("late_us", c_ulong),
+        # Version 3
+        ("tcp_connections", c_ulong),
+        ("udp_endpoints", c_ulong),
+        ("net_rx_bytes", ctypes.c_ulonglong),
+        ("net_tx_bytes", ctypes.c_ulonglong),
+        # Version 4
+        ("cpu_user", ctypes.c_double),
+        ("cpu_kernel", ctypes.c_double),
+        # Version 5
+        ("sampler_cpu_us", ctypes.c_ulonglong),
+        ("phase_ns", c_ulong * 9),
+    ]
+
+    def to_dict(self) -> dict:
+        """
+        Convert the record to the same dict layout produced by the JSON functions.
+
+        Returns:
+            dict: Metrics keyed like the JSON output; only requested metrics are included,
+            followed by the `timestamp_us`, `missed` and `late_us` timing fields.
+        """
+        if self.status != self.STATUS_OK:
+            return {"pid": self.pid, "error": "unavailable"}
+        m = self.metrics
+        out = {"pid": self.pid}
+        if m & ProcessMetrics.METRIC_WORKING_SET:
+            out["working_set_kb"] = self.working_set_kb
+        if m & ProcessMetrics.METRIC_PRIVATE_BYTES:
+            out["private_kb"] = self.private_kb
+        if m & ProcessMetrics.METRIC_PAGEFILE:
+            out["pagefile_kb"] = self.pagefile_kb
+        if m & ProcessMetrics.METRIC_HANDLES:
+            out["handles"] = self.handles
+        if m & ProcessMetrics.METRIC_THREADS:
+            out["threads"] = self.threads
+        if m & ProcessMetrics.METRIC_CPU_USAGE:
+            out["cpu"] = round(self.cpu, 2)
+        if m & ProcessMetrics.METRIC_IO:
+            out["io_read_kb"] = self.io_read_kb
+            out["io_write_kb"] = self.io_write_kb
+        if m & ProcessMetrics.METRIC_CPU_USAGE:
+            out["cpu_user"] = round(self.cpu_user, 2)
+            out["cpu_kernel"] = round(self.cpu_kernel, 2)
+        if m & ProcessMetrics.METRIC_NET:
+            out["tcp_connections"] = self.tcp_connections
+            out["udp_endpoints"] = self.udp_endpoints
+            out["net_rx_bytes"] = self.net_rx_bytes
+            out["net_tx_bytes"] = self.net_tx_bytes
+        if m & ProcessMetrics.METRIC_SELF_PROFILE:
+            out["profile"] = _profile_dict(self.sampler_cpu_us, self.phase_ns)
+        out["timestamp_us"] = self.timestamp_us
+        out["missed"] = self.missed
+        out["late_us"] = self.late_us
+        return out
+
+
+def _profile_dict(sampler_cpu_us: int, phase_ns) -> dict:
+    """Build the `profile` object of the JSON output from self-profiling fields."""
+    out = {"sampler_cpu_us": sampler_cpu_us}
+    for i, name in enumerate(MetricsRecord.PROFILE_PHASES):
+        out[name + "_ns"] = phase_ns[i]
+    return out
+
+
+class RecordingHeader(ctypes.Structure):
+    """
+    Header of a recording file written by `ProcessMetrics.create_recorder`, mirroring the
+    packed `RECORDING_HEADER` C struct.
+    """
+    MAGIC = b"PIREC"  # NUL-padded to 8 bytes in the file
+    VERSION = 1
+
+    _pack_ = 1
+    _fields_ = [
+        ("magic", ctypes.c_char * 8),
+        ("version", ctypes.c_ushort),
+        ("size", ctypes.c_ushort),
+        ("pid", c_ulong),
+        ("metrics", c_ulong),
+        ("interval_ms", c_ulong),
+        ("column_count", c_ulong),
+        ("columns", ctypes.c_ubyte * 16),
+        ("sample_count", ctypes.c_ulonglong),
+        ("data_bytes", ctypes.c_ulonglong),
+    ]
+
+
+class MetricsRecording:
+    """
+    Read-only view of a recording written by `ProcessMetrics.create_recorder`.
+
+    The file is memory-mapped and each column is decoded natively into a `ctypes` array of
+    64-bit integers on first access, without any per-sample Python work. The arrays support
+    the buffer protocol (e.g. `numpy.frombuffer(rec["cpu"], dtype=numpy.int64)`).
+
+    Column names match the JSON keys; `timestamp_us` and `missed` are always present, the
+    others only when their metric was recorded. `cpu`, `cpu_user` and `cpu_kernel` are stored
+    in hundredths of a percent.
+
+    Only complete blocks are visible while the recorder is still running; the final partial
+    block is written when the monitor finishes or is destroyed.
+    """
+    COLUMNS = ("timestamp_us", "missed", "working_set_kb", "private_kb", "pagefile_kb", "handles",
+               "threads", "cpu", "cpu_user", "cpu_kernel", "io_read_kb", "io_write_kb",
+               "tcp_connections", "udp_endpoints", "net_rx_bytes", "net_tx_bytes")
+
+    def __init__(self, dll, path: str):
+        """
+        Map a recording file. Use `ProcessMetrics.open_recording` rather than calling this directly.
+
+        Args:
+            dll: The loaded processInspect DLL, with `recording_decode_column` prototyped.
+            path (str): Path of the recording file.
+
+        Raises:
+            RuntimeError: If the file is not a recording of a supported version.
+        """
+        self._dll = dll
+        self._file = open(path, "rb")
+        try:
+            # Copy-on-write so ctypes can address the mapping; it is never written
+            self._map = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_COPY)
+        except ValueError:
+            self._file.close()
+            raise RuntimeError(f"{path} is not a metrics recording")
+        header_size = ctypes.sizeof(RecordingHeader)
+        header = RecordingHeader.from_buffer_copy(self._map[:header_size]) if len(self._map) >= header_size else None
+        if header is None or header.magic != RecordingHeader.MAGIC or \
+                header.version != RecordingHeader.VERSION or header.size != header_size:
+            self.close()
+            raise RuntimeError(f"{path} is not a supported metrics recording")
+        self._view = (ctypes.c_ubyte * len(self._map)).from_buffer(self._map)
+        self.pid = header.pid
+        self.metrics = header.metrics
+        self.interval_ms = header.interval_ms
+        self.sample_count = header.sample_count
+        self._column_ids = {self.COLUMNS[c]: c for c in header.columns[:header.column_count]}
+        self._cache = {}
+
+    @property
+    def columns(self) -> List[str]:
+        """List[str]: Names of the columns stored in this recording, in file order."""
+        return list(self._column_ids)
+
+    def column(self, name: str) -> ctypes.Array:
+        """
+        Get one column as an array with one value per sample.
+
+        Args:
+            name (str): Column name, one of `columns`.
+
+        Returns:
+            ctypes.Array: `c_longlong` array of `sample_count` values, oldest first.
+
+        Raises:
+            KeyError: If the column was not recorded.
+            RuntimeError: If the file is corrupt.
+        """
+        if name in self._cache:
+            return self._cache[name]
+        if name not in self._column_ids:
+            raise KeyError(name)
+        out = (ctypes.c_longlong * self.sample_count)()
+        count = self._dll.recording_decode_column(self._view, len(self._view), self._column_ids[name],
+                                                  out, self.sample_count)
+        if count != self.sample_count:
+            raise RuntimeError(f"Column {name} of the recording is corrupt")
+        self._cache[name] = out
+        return out
+
+    def __getitem__(self, name: str) -> ctypes.Array:
+        return self.column(name)
+
+    def __len__(self) -> int:
+        return self.sample_count
+
+    def close(self):
+        """Unmap the file. Arrays returned by `column` stay valid."""
+        self._view = None
+        if getattr(self, "_map", None) is not None:
+            self._map.close()
+            self._map = None
+        self._file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+class MetricStats(ctypes.Structure):
+    """Summary of one metric over an aggregation window (`METRIC_STATS`)."""
+    _pack_ = 1
+    _fields_ = [(name, ctypes.c_double) for name in ("min", "max", "mean", "p50", "p95", "p99")]
+
+
+class MetricsAggregate(ctypes.Structure):
+    """
+    One aggregation window delivered by `ProcessMetrics.create_aggregate_monitor`,
+    mirroring the packed `METRICS_AGGREGATE` C struct.
+
+    `stats` is indexed like `MetricsRecording.COLUMNS`; bit n of `columns` is set when
+    `stats[n]` is filled. Values use the units of the JSON keys (CPU in percent).
+    Percentiles come from a log-scale histogram and are within about 3% of the exact value.
+    With `METRIC_SELF_PROFILE`, `phase_ns` holds per-phase totals for the window and
+    `sampler_cpu_us` the scheduler thread's CPU time since the previous window.
+    """
+    VERSION = 2
+
+    _pack_ = 1
+    _fields_ = [
+        ("version", ctypes.c_ushort),
+        ("size", ctypes.c_ushort),
+        ("pid", c_ulong),
+        ("metrics", c_ulong),
+        ("columns", c_ulong),
+        ("samples", c_ulong),
+        ("missed", c_ulong),
+        ("start_us", ctypes.c_ulonglong),
+        ("end_us", ctypes.c_ulonglong),
+        ("stats", MetricStats * len(MetricsRecording.COLUMNS)),
+        # Version 2
+        ("sampler_cpu_us", ctypes.c_ulonglong),
+        ("phase_ns", ctypes.c_ulonglong * len(MetricsRecord.PROFILE_PHASES)),
+    ]
+
+    def to_dict(self) -> dict:
+        """
+        Convert the window to a dict.
+
+        Returns:
+            dict: `pid`, `samples`, `missed`, `start_us` and `end_us`, plus one
+            `{"min", "max", "mean", "p50", "p95", "p99"}` dict per aggregated metric, keyed
+            like the JSON output. Self-profiling windows add a `profile` dict of totals.
+        """
+        out = {"pid": self.pid, "samples": self.samples, "missed": self.missed,
+               "start_us": self.start_us, "end_us": self.end_us}
+        for i, name in enumerate(MetricsRecording.COLUMNS):
+            if self.columns & (1 << i):
+                st = self.stats[i]
+                out[name] = {field: getattr(st, field) for field, _ in MetricStats._fields_}
+        if self.metrics & ProcessMetrics.METRIC_SELF_PROFILE:
+            out["profile"] = _profile_dict(self.sampler_cpu_us, self.phase_ns)
+        return out
+
+
+class MetricsAlert(ctypes.Structure):
+    """
+    Threshold rule transition delivered by `ProcessMetrics.add_threshold`, mirroring the
+    packed `METRICS_ALERT` C struct.
+    """
+    VERSION = 1
+
+    _pack_ = 1
+    _fields_ = [
+        ("version", ctypes.c_ushort),
+        ("size", ctypes.c_ushort),
+        ("monitor", c_int),
+        ("rule", c_int),
+        ("pid", c_ulong),
+        ("column", c_ulong),
+        ("active", c_int),
+        ("value", ctypes.c_double),
+        ("threshold", ctypes.c_double),
+        ("timestamp_us", ctypes.c_ulonglong),
+    ]
+
+    def to_dict(self) -> dict:
+        """
+        Convert the alert to a dict.
+
+        Returns:
+            dict: `monitor`, `rule`, `pid`, `metric` (the JSON key), `active`, `value`,
+            `threshold` and `timestamp_us`.
+        """
+        return {"monitor": self.monitor, "rule": self.rule, "pid": self.pid,
+                "metric": MetricsRecording.COLUMNS[self.column], "active": bool(self.active),
+                "value": self.value, "threshold": self.threshold, "timestamp_us": self.timestamp_us}
+
+
+class ThreadRecord(ctypes.Structure):
+    """
+    One thread of a per-thread breakdown (`ProcessMetrics.get_thread_metrics`,
+    `ProcessMetrics.read_monitor_threads`), mirroring the packed `THREAD_RECORD` C struct.
+
+    `cpu` uses the same scale as `MetricsRecord.cpu` (percent of all logical processors).
+    `state` and `wait_reason` are the kernel's KTHREAD_STATE and KWAIT_REASON values.
+    """
+    VERSION = 1
+
+    STATES = ("initialized", "ready", "running", "standby", "terminated", "waiting",
+              "transition", "deferred_ready", "gate_wait", "waiting_for_swap")
+
+    _pack_ = 1
+    _fields_ = [
+        ("version", ctypes.c_ushort),
+        ("size", ctypes.c_ushort),
+        ("pid", c_ulong),
+        ("tid", c_ulong),
+        ("state", c_ulong),
+        ("wait_reason", c_ulong),
+        ("priority", ctypes.c_long),
+        ("context_switches", c_ulong),
+        ("cpu", ctypes.c_double),
+        ("cpu_user", ctypes.c_double),
+        ("cpu_kernel", ctypes.c_double),
+        ("cpu_time_us", ctypes.c_ulonglong),
+        ("timestamp_us", ctypes.c_ulonglong),
+    ]
+
+    def to_dict(self) -> dict:
+        """
+        Convert the thread to a dict.
+
+        Returns:
+            dict: `tid`, `cpu`, `cpu_user`, `cpu_kernel`, `state` (a name from `STATES`),
+            `wait_reason`, `priority`, `context_switches`, `cpu_time_us` and `timestamp_us`.
+        """
+        state = self.STATES[self.state] if self.state < len(self.STATES) else str(self.state)
+        return {"tid": self.tid, "cpu": round(self.cpu, 2), "cpu_user": round(self.cpu_user, 2),
+                "cpu_kernel": round(self.cpu_kernel, 2), "state": state, "wait_reason": self.wait_reason,
+                "priority": self.priority, "context_switches": self.context_switches,
+                "cpu_time_us": self.cpu_time_us, "timestamp_us": self.timestamp_us}
+
+
+# Per-thread scratch buffer for the JSON calls, reused instead of allocated on every call
+_scratch = threading.local()
+
+
+def _scratch_buffer(size: int) -> ctypes.Array:
+    """Return this thread's reusable string buffer, grown to at least `size` bytes."""
+    buf = getattr(_scratch, "buf", None)
+    if buf is None or len(buf) < size:
+        buf = _scratch.buf = create_string_buffer(size)
+    return buf
+
+
+# C function types for the monitoring callbacks
+_CALLBACK_TYPE = CFUNCTYPE(None, c_char_p, c_void_p)
+_RECORD_CALLBACK_TYPE = CFUNCTYPE(None, ctypes.POINTER(MetricsRecord), c_void_p)
+_AGGREGATE_CALLBACK_TYPE = CFUNCTYPE(None, ctypes.POINTER(MetricsAggregate), c_void_p)
+_ALERT_CALLBACK_TYPE = CFUNCTYPE(None, ctypes.POINTER(MetricsAlert), c_void_p)
+
+
+def _bind_process_inspect(dll):
+    """Declare every processInspect prototype once, when the shared DLL handle is first loaded."""
+    dll.start_metrics_collection.argtypes = [c_ulong, c_ulong]
+    dll.start_metrics_collection.restype = ctypes.c_int
+
+    dll.end_metrics_collection.argtypes = [c_ulong, c_ulong, c_char_p, c_size_t]
+    dll.end_metrics_collection.restype = ctypes.c_int
+
+    dll.get_metrics_json.argtypes = [c_ulong, c_ulong, c_char_p, c_size_t]
+    dll.get_metrics_json.restype = ctypes.c_int
+
+    dll.get_metrics_batch.argtypes = [ctypes.POINTER(c_ulong), c_int, c_ulong, c_char_p, c_size_t]
+    dll.get_metrics_batch.restype = ctypes.c_int
+
+    # Binary record variants
+    dll.get_metrics_record.argtypes = [c_ulong, c_ulong, ctypes.POINTER(MetricsRecord)]
+    dll.get_metrics_record.restype = ctypes.c_int
+
+    dll.end_metrics_collection_record.argtypes = [c_ulong, c_ulong, ctypes.POINTER(MetricsRecord)]
+    dll.end_metrics_collection_record.restype = ctypes.c_int
+
+    dll.get_metrics_batch_records.argtypes = [ctypes.POINTER(c_ulong), c_int, c_ulong,
+                                              ctypes.POINTER(MetricsRecord)]
+    dll.get_metrics_batch_records.restype = ctypes.c_int
+
+    dll.scan_all_processes.argtypes = [c_ulong, c_ulong, c_int, ctypes.POINTER(MetricsRecord)]
+    dll.scan_all_processes.restype = ctypes.c_int
+
+    dll.get_thread_metrics.argtypes = [c_ulong, ctypes.POINTER(ThreadRecord), c_int]
+    dll.get_thread_metrics.restype = ctypes.c_int
+
+    # Set types for monitoring functions
+    dll.start_metrics_monitoring.argtypes = [c_ulong, c_ulong, c_ulong, c_int,
+                                             _CALLBACK_TYPE, c_void_p]
+    dll.start_metrics_monitoring.restype = ctypes.c_int
+
+    dll.start_metrics_monitoring_records.argtypes = [c_ulong, c_ulong, c_ulong, c_int,
+                                                     _RECORD_CALLBACK_TYPE, c_void_p]
+    dll.start_metrics_monitoring_records.restype = ctypes.c_int
+
+    dll.stop_metrics_monitoring.argtypes = []
+    dll.stop_metrics_monitoring.restype = ctypes.c_int
+
+    dll.is_metrics_monitoring_active.argtypes = []
+    dll.is_metrics_monitoring_active.restype = ctypes.c_int
+
+    dll.monitor_create.argtypes = [c_ulong, c_ulong, c_ulong, c_int,
+                                   _CALLBACK_TYPE, _RECORD_CALLBACK_TYPE, c_void_p]
+    dll.monitor_create.restype = ctypes.c_int
+
+    dll.monitor_destroy.argtypes = [c_int]
+    dll.monitor_destroy.restype = ctypes.c_int
+
+    dll.monitor_is_active.argtypes = [c_int]
+    dll.monitor_is_active.restype = ctypes.c_int
+
+    # Ring-buffer delivery: the sampler never calls into Python
+    dll.monitor_create_ring.argtypes = [c_ulong, c_ulong, c_ulong, c_int, c_ulong]
+    dll.monitor_create_ring.restype = ctypes.c_int
+
+    dll.monitor_read.argtypes = [c_int, ctypes.POINTER(MetricsRecord), c_int]
+    dll.monitor_read.restype = ctypes.c_int
+
+    dll.monitor_read_threads.argtypes = [c_int, ctypes.POINTER(ThreadRecord), c_int]
+    dll.monitor_read_threads.restype = ctypes.c_int
+
+    dll.monitor_get_event.argtypes = [c_int]
+    dll.monitor_get_event.restype = c_void_p
+
+    dll.monitor_dropped.argtypes = [c_int]
+    dll.monitor_dropped.restype = ctypes.c_longlong
+
+    # Compact recordings on disk
+    dll.monitor_create_recorder.argtypes = [c_ulong, c_ulong, c_ulong, c_int, c_wchar_p]
+    dll.monitor_create_recorder.restype = ctypes.c_int
+
+    dll.recording_decode_column.argtypes = [c_void_p, ctypes.c_ulonglong, c_ulong,
+                                            ctypes.POINTER(ctypes.c_longlong), ctypes.c_longlong]
+    dll.recording_decode_column.restype = ctypes.c_longlong
+
+    dll.monitor_create_aggregate.argtypes = [c_ulong, c_ulong, c_ulong, c_int, c_ulong,
+                                             _AGGREGATE_CALLBACK_TYPE, c_void_p]
+    dll.monitor_create_aggregate.restype = ctypes.c_int
+
+    # Threshold rules evaluated in the sampler
+    dll.monitor_add_threshold.argtypes = [c_int, c_ulong, c_int, ctypes.c_double, c_ulong,
+                                          _ALERT_CALLBACK_TYPE, c_void_p]
+    dll.monitor_add_threshold.restype = ctypes.c_int
+
+    dll.monitor_threshold_state.argtypes = [c_int, c_int]
+    dll.monitor_threshold_state.restype = ctypes.c_int
+
+    dll.monitor_get_alert_event.argtypes = [c_int]
+    dll.monitor_get_alert_event.restype = c_void_p
+
+    dll.release_process_cache.argtypes = []
+    dll.release_process_cache.restype = ctypes.c_int
+
+
+# kernel32!WaitForSingleObject for the monitor events, bound on the first wait
+_wait_for_single_object = None
+_wait_lock = threading.Lock()
+
+
+def _get_wait_function():
+    """Return the shared, prototyped `WaitForSingleObject`, loading kernel32 once."""
+    global _wait_for_single_object
+    if _wait_for_single_object is None:
+        with _wait_lock:
+            if _wait_for_single_object is None:
+                func = ctypes.WinDLL("kernel32").WaitForSingleObject
+                func.argtypes = [c_void_p, c_ulong]
+                func.restype = c_ulong
+                _wait_for_single_object = func
+    return _wait_for_single_object
+
+
+# Monitors belong to the DLL, not to the ProcessMetrics that created them, and may outlive it.
+# Their Python callbacks therefore live in this module-level registry: the DLL is handed one
+# permanent thunk per callback type plus the registry key as user data, so a sample in flight
+# can never reach a freed thunk. Callbacks of monitors that stopped are pruned whenever a new
+# one is registered. _LEGACY_MONITOR stands for the `start_monitoring` session.
+_LEGACY_MONITOR = 0
+_callbacks = {}  # key -> Python callable
+_monitor_keys = {}  # monitor id -> keys registered for it
+_callbacks_lock = threading.Lock()
+_next_key = itertools.count(1)
+
+
+@_CALLBACK_TYPE
+def _json_thunk(json_str, user_data):
+    callback = _callbacks.get(user_data)
+    if callback:
+        callback(json.loads(ctypes.string_at(json_str).decode('utf-8')))
+
+
+@_RECORD_CALLBACK_TYPE
+def _record_thunk(record_ptr, user_data):
+    callback = _callbacks.get(user_data)
+    if callback:
+        # The C record is only valid during the call
+        record = MetricsRecord()
+        ctypes.pointer(record)[0] = record_ptr[0]
+        callback(record)
+
+
+@_AGGREGATE_CALLBACK_TYPE
+def _aggregate_thunk(aggregate_ptr, user_data):
+    callback = _callbacks.get(user_data)
+    if callback:
+        aggregate = MetricsAggregate()
+        ctypes.pointer(aggregate)[0] = aggregate_ptr[0]
+        callback(aggregate)
+
+
+@_ALERT_CALLBACK_TYPE
+def _alert_thunk(alert_ptr, user_data):
+    callback = _callbacks.get(user_data)
+    if callback:
+        alert = MetricsAlert()
+        ctypes.pointer(alert)[0] = alert_ptr[0]
+        callback(alert)
+
+
+def _register_callback(callback):
+    """Store `callback` in the registry and return its key (the DLL user data), or None for no callback."""
+    if not callback:
+        return None
+    key = next(_next_key)
+    with _callbacks_lock:
+        _callbacks[key] = callback
+    return key
+
+
+def _settle_callback(key, monitor_id: int, created: bool) -> None:
+    """Tie a registered key to the monitor it was created for, or drop it if creation failed."""
+    if key is None:
+        return
+    with _callbacks_lock:
+        if created:
+            _monitor_keys.setdefault(monitor_id, []).append(key)
+        else:
+            _callbacks.pop(key, None)
+
+
+def _release_monitor(monitor_id: int, keys=None) -> None:
+    """Drop the callbacks of a monitor (only `keys`, if given)."""
+    with _callbacks_lock:
+        owned = _monitor_keys.get(monitor_id, [])
+        for key in list(owned if keys is None else keys):
+            _callbacks.pop(key, None)
+            if key in owned:
+                owned.remove(key)
+        if not owned:
+            _monitor_keys.pop(monitor_id, None)
+
+
+def _prune_monitors(dll) -> None:
+    """Release the callbacks of monitors that are no longer active (finished or destroyed)."""
+    with _callbacks_lock:
+        snapshot = [(monitor_id, list(keys)) for monitor_id, keys in _monitor_keys.items()]
+    for monitor_id, keys in snapshot:
+        if monitor_id == _LEGACY_MONITOR:
+            active = dll.is_metrics_monitoring_active()
+        else:
+            active = dll.monitor_is_active(monitor_id)
+        if not active:
+            # Only the keys seen inactive: a new session may have registered meanwhile
+            _release_monitor(monitor_id, keys)
 
 
 class ProcessMetrics:
@@ -27,6 +626,8 @@ class ProcessMetrics:
         METRIC_CPU_USAGE (int): Flag for CPU usage percentage.
         METRIC_IO (int): Flag for I/O statistics.
         METRIC_NET (int): Flag for network statistics.
+        METRIC_SELF_PROFILE (int): Adds the sampler's own cost to each sample or window.
+        METRIC_THREAD_CPU (int): Monitors keep a per-thread CPU breakdown.
 
     Raises:
         RuntimeError: If the DLL is not found or if metric collection fails.
@@ -40,42 +641,19 @@ class ProcessMetrics:
     METRIC_CPU_USAGE = 0x20
     METRIC_IO = 0x40
     METRIC_NET = 0x80
+    METRIC_SELF_PROFILE = 0x100
+    METRIC_THREAD_CPU = 0x200
 
     def __init__(self):
         """
         Initialize ProcessMetrics instance by loading the appropriate DLL
         for the current platform architecture.
         """
-        # Load the DLL using ctypes
-        self._dll = load_dll(dll_prefix_name="processInspect", dll_load_func=ctypes.CDLL)
-
-        # Define argument and return types of DLL functions for type safety
-        self._dll.start_metrics_collection.argtypes = [c_ulong, c_ulong]
-        self._dll.start_metrics_collection.restype = ctypes.c_int
+        # Shared DLL handle: loaded and bound on the first ProcessMetrics, reused by every later one
+        self._dll = get_library("processInspect", ctypes.CDLL, _bind_process_inspect)
 
-        self._dll.end_metrics_collection.argtypes = [c_ulong, c_ulong, c_char_p, c_size_t]
-        self._dll.end_metrics_collection.restype = ctypes.c_int
-
-        self._dll.get_metrics_json.argtypes = [c_ulong, c_ulong, c_char_p, c_size_t]
-        self._dll.get_metrics_json.restype = ctypes.c_int
-
-        # Define C function type for the monitoring callback
-        self._CALLBACK_TYPE = CFUNCTYPE(None, c_char_p, c_void_p)
-
-        # Set types for monitoring functions
-        self._dll.start_metrics_monitoring.argtypes = [c_ulong, c_ulong, c_ulong, c_int,
-                                                       self._CALLBACK_TYPE, c_void_p]
-        self._dll.start_metrics_monitoring.restype = ctypes.c_int
-
-        self._dll.stop_metrics_monitoring.argtypes = []
-        self._dll.stop_metrics_monitoring.restype = ctypes.c_int
-
-        self._dll.is_metrics_monitoring_active.argtypes = []
-        self._dll.is_metrics_monitoring_active.restype = ctypes.c_int
-
-        # Store callback reference to prevent garbage collection
-        self._callback_ref = None
-        self._user_callback = None
+        # Monitor callbacks are kept in the module-level registry, so that a monitor keeps
+        # working after this instance is garbage-collected
 
     @staticmethod
     def _json_call(func, pid: int, metrics: int, _buffer_size: int = 4096) -> dict:
@@ -87,7 +665,8 @@ class ProcessMetrics:
             func (callable): DLL function to call, which fills a buffer with JSON.
             pid (int): Process ID to query.
             metrics (int): Bitmask of metrics flags to request.
-            _buffer_size (int): Size of the buffer to hold JSON data (default 4096 bytes).
+            _buffer_size (int): Minimum size of the buffer to hold JSON data (default 4096 bytes).
+                The buffer is a per-thread scratch buffer reused across calls.
 
         Returns:
             dict: Parsed JSON metrics.
@@ -95,11 +674,11 @@ class ProcessMetrics:
         Raises:
             RuntimeError: If the DLL function call returns failure.
         """
-        buf = create_string_buffer(_buffer_size)  # buffer size fixed to 4 KB
-        success = func(pid, metrics, buf, ctypes.sizeof(buf))
+        buf = _scratch_buffer(_buffer_size)
+        success = func(pid, metrics, buf, len(buf))
         if not success:
             raise RuntimeError(f"Metric collection failed for PID {pid}")
-        return json.loads(buf.value.decode('utf-8'))
+        return json.loads(buf.value)
 
     def start_session(self, pid: int, metrics: int) -> bool:
         """
@@ -140,22 +719,180 @@ class ProcessMetrics:
         """
         return self._json_call(self._dll.get_metrics_json, pid, metrics)
 
+    def get_batch_snapshot(self, pids: List[int], metrics: int) -> List[dict]:
+        """
+        Retrieve instant snapshots for many processes in a single DLL call.
+
+        The native side walks the system process list once for all PIDs instead of
+        once per PID, so this is much cheaper than calling `get_snapshot` in a loop.
+
+        Args:
+            pids (List[int]): Process IDs to query.
+            metrics (int): Bitmask of metrics to retrieve.
+
+        Returns:
+            List[dict]: One dict per PID, in the same order. PIDs that could not be
+            sampled are returned as {"pid": N, "error": "unavailable"}.
+
+        Raises:
+            RuntimeError: If the DLL call fails.
+        """
+        if not pids:
+            return []
+        pid_array = (c_ulong * len(pids))(*pids)
+        buf = _scratch_buffer(512 * len(pids))
+        while True:
+            buf[0] = b'\0'  # the scratch buffer may hold a previous call's output
+            result = self._dll.get_metrics_batch(pid_array, len(pids), metrics, buf, len(buf))
+            if result >= 0:
+                break
+            buf = _scratch_buffer(2 * len(buf))  # buffer too small, retry with a larger one
+        if result == 0 and not buf.value:
+            raise RuntimeError("Batch metric collection failed")
+        return json.loads(buf.value)
+
+    def get_snapshot_record(self, pid: int, metrics: int) -> MetricsRecord:
+        """
+        Retrieve an instant snapshot as a binary record, skipping JSON formatting and parsing.
+
+        Args:
+            pid (int): Process ID to query.
+            metrics (int): Bitmask of metrics to retrieve.
+
+        Returns:
+            MetricsRecord: Current metrics snapshot.
+
+        Raises:
+            RuntimeError: If metric collection fails.
+        """
+        record = MetricsRecord()
+        if not self._dll.get_metrics_record(pid, metrics, ctypes.byref(record)):
+            raise RuntimeError(f"Metric collection failed for PID {pid}")
+        return record
+
+    def end_session_record(self, pid: int, metrics: int) -> MetricsRecord:
+        """
+        End a previously started metrics collection session and retrieve a binary record.
+
+        Args:
+            pid (int): Process ID of the session.
+            metrics (int): Bitmask of metrics to retrieve.
+
+        Returns:
+            MetricsRecord: Metrics collected during the session.
+
+        Raises:
+            RuntimeError: If metric collection fails.
+        """
+        record = MetricsRecord()
+        if not self._dll.end_metrics_collection_record(pid, metrics, ctypes.byref(record)):
+            raise RuntimeError(f"Metric collection failed for PID {pid}")
+        return record
+
+    def get_batch_records(self, pids: List[int], metrics: int) -> ctypes.Array:
+        """
+        Retrieve instant snapshots for many processes as an array of binary records.
+
+        Args:
+            pids (List[int]): Process IDs to query.
+            metrics (int): Bitmask of metrics to retrieve.
+
+        Returns:
+            ctypes.Array: `MetricsRecord` array in the same order as `pids`. Entries whose
+            `status` is `MetricsRecord.STATUS_UNAVAILABLE` could not be sampled.
+        """
+        records = (MetricsRecord * len(pids))()
+        if pids:
+            pid_array = (c_ulong * len(pids))(*pids)
+            self._dll.get_metrics_batch_records(pid_array, len(pids), metrics, records)
+        return records
+
     # noinspection PyUnusedLocal
-    def _callback_wrapper(self, json_str, user_data):
+    def scan_processes(self, metrics: int, sort_by: str = "cpu", top_n: int = 10) -> List[MetricsRecord]:
         """
-        Internal callback wrapper that converts C JSON string to Python dict
-        and calls the user's callback function.
+        Sample every process on the system with a single native call and return the top N.
+
+        The DLL reads all processes from one `NtQuerySystemInformation` pass instead of
+        opening each one. CPU usage is relative to the previous scan, so call this
+        periodically; on the first scan (and for processes started since the last one) it
+        is the average since the process started. `METRIC_NET` is not available here.
 
         Args:
-            json_str (c_char_p): JSON metrics data from C.
-            user_data (c_void_p): User data pointer (unused in this implementation).
+            metrics (int): Bitmask of metrics to collect (use class flags).
+            sort_by (str): Key to rank by, largest first, e.g. "cpu", "working_set_kb",
+                           "private_kb", "handles", "threads" or "io_read_kb". Its metric
+                           must be part of `metrics`.
+            top_n (int): Maximum number of processes to return.
+
+        Returns:
+            List[MetricsRecord]: Up to `top_n` records, ordered by `sort_by`.
+
+        Raises:
+            ValueError: If `sort_by` is not a metric key.
+            RuntimeError: If the scan fails or `sort_by` is not among the requested metrics.
         """
-        if self._user_callback:
-            metrics_dict = json.loads(ctypes.string_at(json_str).decode('utf-8'))
-            self._user_callback(metrics_dict)
+        if sort_by not in MetricsRecording.COLUMNS[2:]:
+            raise ValueError(f"Unknown sort key {sort_by!r}")
+        buf = (MetricsRecord * top_n)()
+        count = self._dll.scan_all_processes(metrics, MetricsRecording.COLUMNS.index(sort_by), top_n, buf)
+        if count < 0:
+            raise RuntimeError(f"Process scan failed (is {sort_by!r} part of the requested metrics?)")
+        return buf[:count]
+
+    def get_thread_metrics(self, pid: int, top_n: int = 16) -> List[ThreadRecord]:
+        """
+        Break a process's CPU usage down by thread, busiest first.
+
+        Thread times come from one `NtQuerySystemInformation` pass without opening any
+        thread. CPU usage is relative to the previous call for the same process, so call
+        this periodically. On the first call, and for threads started since the last one,
+        it is the average since the thread started.
+
+        Args:
+            pid (int): Process ID to query.
+            top_n (int): Maximum number of threads to return.
+
+        Returns:
+            List[ThreadRecord]: Up to `top_n` threads, ordered by `cpu`.
+
+        Raises:
+            RuntimeError: If the process cannot be opened or the query fails.
+        """
+        # Every call moves the baseline, so read all threads at once and trim here
+        capacity = max(top_n, 1024)
+        buf = (ThreadRecord * capacity)()
+        count = self._dll.get_thread_metrics(pid, buf, capacity)
+        if count < 0:
+            raise RuntimeError(f"Thread breakdown failed for PID {pid}")
+        return buf[:min(count, capacity, top_n)]
+
+    def read_monitor_threads(self, monitor_id: int, top_n: int = 16) -> List[ThreadRecord]:
+        """
+        Return the per-thread breakdown of a monitor's latest sample, busiest first.
+
+        The monitor must have been created with `METRIC_THREAD_CPU` in its metrics. Each tick
+        refreshes the breakdown of every such monitor from one `NtQuerySystemInformation`
+        pass. JSON monitors also receive the busiest 8 threads under `thread_cpu`.
+
+        Args:
+            monitor_id (int): Id returned by one of the `create_*monitor` methods.
+            top_n (int): Maximum number of threads to return.
+
+        Returns:
+            List[ThreadRecord]: Up to `top_n` threads, ordered by `cpu` (empty before the
+            first sample or after the process exits).
+
+        Raises:
+            RuntimeError: If the id is unknown or the monitor lacks `METRIC_THREAD_CPU`.
+        """
+        buf = (ThreadRecord * top_n)()
+        count = self._dll.monitor_read_threads(monitor_id, buf, top_n)
+        if count < 0:
+            raise RuntimeError(f"Monitor {monitor_id} does not exist or lacks METRIC_THREAD_CPU")
+        return buf[:min(count, top_n)]
 
     def start_monitoring(self, pid: int, metrics: int, interval_ms: int,
-                         duration_ms: int = -1, callback=None) -> bool:
+                         duration_ms: int = -1, callback=None, records: bool = False) -> bool:
         """
         Start continuous monitoring of a process at specified intervals.
 
@@ -167,23 +904,25 @@ class ProcessMetrics:
                                indefinite monitoring until explicitly stopped.
             callback (callable): Function to call with each metrics update.
                                 The callback receives a dict of the parsed metrics.
+            records (bool): If True, the callback receives a `MetricsRecord` instead of a dict,
+                            avoiding JSON formatting and parsing on every sample.
 
         Returns:
             bool: True if monitoring started successfully, False otherwise.
         """
         if self.is_monitoring_active():
             return False
+        _prune_monitors(self._dll)
 
-        self._user_callback = callback
-
-        # Create C-compatible callback function
-        if callback:
-            self._callback_ref = self._CALLBACK_TYPE(self._callback_wrapper)
+        key = _register_callback(callback)
+        if records:
+            started = bool(self._dll.start_metrics_monitoring_records(
+                pid, metrics, interval_ms, duration_ms, _record_thunk if callback else None, key))
         else:
-            self._callback_ref = None
-
-        return bool(self._dll.start_metrics_monitoring(
-            pid, metrics, interval_ms, duration_ms, self._callback_ref, None))
+            started = bool(self._dll.start_metrics_monitoring(
+                pid, metrics, interval_ms, duration_ms, _json_thunk if callback else None, key))
+        _settle_callback(key, _LEGACY_MONITOR, started)
+        return started
 
     def stop_monitoring(self) -> bool:
         """
@@ -194,8 +933,7 @@ class ProcessMetrics:
         """
         result = bool(self._dll.stop_metrics_monitoring())
         if result:
-            self._user_callback = None
-            self._callback_ref = None
+            _release_monitor(_LEGACY_MONITOR)
         return result
 
     def is_monitoring_active(self) -> bool:
@@ -206,3 +944,297 @@ class ProcessMetrics:
             bool: True if monitoring is active, False otherwise.
         """
         return bool(self._dll.is_metrics_monitoring_active())
+
+    def create_monitor(self, pid: int, metrics: int, interval_ms: int, callback,
+                       duration_ms: int = -1, records: bool = False) -> int:
+        """
+        Create an independent monitor served by the DLL's shared scheduler thread.
+
+        Any number of monitors (with different PIDs, intervals and metric masks) can run
+        at once; all monitors due at the same time are sampled in a single pass.
+
+        Args:
+            pid (int): Process ID to monitor.
+            metrics (int): Bitmask of metrics to collect (use class flags).
+            interval_ms (int): Interval between metric collections in milliseconds.
+            callback (callable): Called with a dict (or a `MetricsRecord` if `records` is True)
+                                 for every sample, on the scheduler thread. May be None for a
+                                 monitor that only evaluates threshold rules (see `add_threshold`).
+            duration_ms (int): Total duration in milliseconds, or -1 to run until destroyed.
+            records (bool): Deliver `MetricsRecord` objects instead of dicts.
+
+        The monitor lives in the DLL: it keeps running, and its callback stays referenced,
+        even if this `ProcessMetrics` instance is garbage-collected.
+
+        Returns:
+            int: Monitor id (> 0), or 0 if the monitor could not be created.
+        """
+        _prune_monitors(self._dll)
+        key = _register_callback(callback)
+        json_fn = _json_thunk if callback and not records else None
+        record_fn = _record_thunk if callback and records else None
+        monitor_id = self._dll.monitor_create(pid, metrics, interval_ms, duration_ms, json_fn, record_fn, key)
+        _settle_callback(key, monitor_id, bool(monitor_id))
+        return monitor_id
+
+    def create_aggregate_monitor(self, pid: int, metrics: int, interval_ms: int, window_ms: int,
+                                 callback, duration_ms: int = -1) -> int:
+        """
+        Create a monitor that samples every `interval_ms` but calls back only once per
+        `window_ms`, with min/max/mean/p50/p95/p99 of each requested metric computed natively
+        over the window.
+
+        The final partial window is delivered when the duration ends or the process exits;
+        destroying the monitor discards it.
+
+        Args:
+            pid (int): Process ID to monitor.
+            metrics (int): Bitmask of metrics to collect (use class flags).
+            interval_ms (int): Interval between metric collections in milliseconds.
+            window_ms (int): Aggregation window in milliseconds (at least `interval_ms`).
+            callback (callable): Called with a `MetricsAggregate` per window, on the scheduler thread.
+            duration_ms (int): Total duration in milliseconds, or -1 to run until destroyed.
+
+        Returns:
+            int: Monitor id (> 0), or 0 if the monitor could not be created.
+        """
+        _prune_monitors(self._dll)
+        key = _register_callback(callback)
+        monitor_id = self._dll.monitor_create_aggregate(pid, metrics, interval_ms, duration_ms, window_ms,
+                                                        _aggregate_thunk, key)
+        _settle_callback(key, monitor_id, bool(monitor_id))
+        return monitor_id
+
+    def destroy_monitor(self, monitor_id: int) -> bool:
+        """
+        Stop and free a monitor created with `create_monitor`.
+
+        Waits for an in-flight callback of this monitor to return before it completes.
+
+        Args:
+            monitor_id (int): Id returned by `create_monitor`.
+
+        Returns:
+            bool: True if the monitor existed, False otherwise.
+        """
+        result = bool(self._dll.monitor_destroy(monitor_id))
+        _release_monitor(monitor_id)
+        return result
+
+    def is_monitor_active(self, monitor_id: int) -> bool:
+        """
+        Check if a monitor is still sampling (not past its duration, its process has not exited,
+        and it was not destroyed).
+
+        Args:
+            monitor_id (int): Id returned by `create_monitor`.
+
+        Returns:
+            bool: True if the monitor is active, False otherwise.
+        """
+        return bool(self._dll.monitor_is_active(monitor_id))
+
+    def create_ring_monitor(self, pid: int, metrics: int, interval_ms: int,
+                            capacity: int = 1024, duration_ms: int = -1) -> int:
+        """
+        Create a monitor that queues binary samples in a lock-free ring buffer instead of
+        calling back into Python, so the sampling cadence never waits on the GIL.
+
+        Drain it with `read_monitor`, optionally blocking in `wait_monitor` first.
+
+        Args:
+            pid (int): Process ID to monitor.
+            metrics (int): Bitmask of metrics to collect (use class flags).
+            interval_ms (int): Interval between metric collections in milliseconds.
+            capacity (int): Ring size in samples, rounded up to a power of two. Samples arriving
+                            while the ring is full are dropped (see `get_monitor_dropped`).
+            duration_ms (int): Total duration in milliseconds, or -1 to run until destroyed.
+
+        Returns:
+            int: Monitor id (> 0), or 0 if the monitor could not be created.
+        """
+        return self._dll.monitor_create_ring(pid, metrics, interval_ms, duration_ms, capacity)
+
+    def read_monitor(self, monitor_id: int, max_records: int = 256) -> List[MetricsRecord]:
+        """
+        Drain up to `max_records` queued samples from a ring monitor, oldest first.
+
+        Args:
+            monitor_id (int): Id returned by `create_ring_monitor`.
+            max_records (int): Maximum number of samples to return.
+
+        Returns:
+            List[MetricsRecord]: The samples read (empty if none are queued).
+
+        Raises:
+            RuntimeError: If the id is unknown or the monitor has no ring.
+        """
+        buf = (MetricsRecord * max_records)()
+        count = self._dll.monitor_read(monitor_id, buf, max_records)
+        if count < 0:
+            raise RuntimeError(f"Monitor {monitor_id} does not exist or has no ring buffer")
+        return buf[:count]
+
+    def wait_monitor(self, monitor_id: int, timeout_ms: int = -1) -> bool:
+        """
+        Block until a ring monitor has new samples (or finishes), or the timeout expires.
+
+        Drain with `read_monitor` until it returns an empty list before waiting again.
+
+        Args:
+            monitor_id (int): Id returned by `create_ring_monitor`.
+            timeout_ms (int): Timeout in milliseconds, or -1 to wait indefinitely.
+
+        Returns:
+            bool: True if the monitor was signalled, False on timeout or unknown id.
+        """
+        return self._wait_event(self._dll.monitor_get_event(monitor_id), timeout_ms)
+
+    @staticmethod
+    def _wait_event(event, timeout_ms: int) -> bool:
+        """
+        Internal helper waiting on an event handle owned by a monitor; False for a NULL handle
+        """
+        if not event:
+            return False
+        timeout = 0xFFFFFFFF if timeout_ms < 0 else timeout_ms
+        return _get_wait_function()(event, timeout) == 0
+
+    def get_monitor_dropped(self, monitor_id: int) -> int:
+        """
+        Get the number of samples a ring monitor dropped because its ring was full.
+
+        Args:
+            monitor_id (int): Id returned by `create_ring_monitor`.
+
+        Returns:
+            int: Dropped sample count, or -1 for an unknown id.
+        """
+        return int(self._dll.monitor_dropped(monitor_id))
+
+    def create_recorder(self, pid: int, metrics: int, interval_ms: int, path: str,
+                        duration_ms: int = -1) -> int:
+        """
+        Create a monitor that writes every sample to a compact columnar file instead of
+        calling back into Python. Each metric is stored as varint-encoded deltas, which
+        typically takes a few bytes per sample.
+
+        The file is complete once the monitor finishes or is destroyed with `destroy_monitor`.
+        Read it with `open_recording`.
+
+        Args:
+            pid (int): Process ID to monitor.
+            metrics (int): Bitmask of metrics to collect (use class flags).
+            interval_ms (int): Interval between metric collections in milliseconds.
+            path (str): Output file, replaced if it exists.
+            duration_ms (int): Total duration in milliseconds, or -1 to run until destroyed.
+
+        Returns:
+            int: Monitor id (> 0), or 0 if the monitor or the file could not be created.
+        """
+        return self._dll.monitor_create_recorder(pid, metrics, interval_ms, duration_ms, path)
+
+    def open_recording(self, path: str) -> MetricsRecording:
+        """
+        Map a recording written by `create_recorder`.
+
+        Args:
+            path (str): Path of the recording file.
+
+        Returns:
+            MetricsRecording: Column view of the recording; close it (or use it as a context
+            manager) to unmap the file.
+
+        Raises:
+            RuntimeError: If the file is not a supported recording.
+        """
+        return MetricsRecording(self._dll, path)
+
+    def add_threshold(self, monitor_id: int, metric: str, op: str, value: float,
+                      samples: int = 1, callback=None) -> int:
+        """
+        Attach a threshold rule to a monitor, evaluated natively on every sample.
+
+        The rule changes state only after `samples` consecutive samples agree, and Python is
+        only involved on those transitions: `callback` is called with a `MetricsAlert`, and
+        `wait_alert` wakes up. A monitor created with no callback at all (e.g.
+        `create_monitor(pid, metrics, interval_ms, None)`) then costs nothing per sample.
+
+        Args:
+            monitor_id (int): Id of any monitor.
+            metric (str): Metric key, e.g. "private_kb", "handles" or "cpu". Its metric must
+                          be part of the monitor's mask.
+            op (str): ">" (holds while above `value`) or "<" (holds while below).
+            value (float): Threshold, in the units of the metric key (CPU in percent).
+            samples (int): Consecutive samples required for a transition in either direction.
+            callback (callable, optional): Called with a `MetricsAlert` per transition, on the
+                                           scheduler thread.
+
+        Returns:
+            int: Rule index, for `get_threshold_state`.
+
+        Raises:
+            ValueError: If `metric` or `op` is invalid.
+            RuntimeError: If the monitor does not exist, does not collect `metric`, or already
+                          has 16 rules.
+        """
+        if metric not in MetricsRecording.COLUMNS[2:]:
+            raise ValueError(f"Unknown metric {metric!r}")
+        if op not in (">", "<"):
+            raise ValueError(f"Unknown operator {op!r}")
+
+        key = _register_callback(callback)
+        rule = self._dll.monitor_add_threshold(monitor_id, MetricsRecording.COLUMNS.index(metric),
+                                               0 if op == ">" else 1, value, samples,
+                                               _alert_thunk if callback else None, key)
+        _settle_callback(key, monitor_id, rule >= 0)
+        if rule < 0:
+            raise RuntimeError(f"Could not add a {metric!r} rule to monitor {monitor_id}")
+        return rule
+
+    def get_threshold_state(self, monitor_id: int, rule: int) -> bool:
+        """
+        Check whether a threshold rule currently holds.
+
+        Args:
+            monitor_id (int): Id of the monitor.
+            rule (int): Index returned by `add_threshold`.
+
+        Returns:
+            bool: True while the rule holds.
+
+        Raises:
+            RuntimeError: If the monitor or rule does not exist.
+        """
+        state = self._dll.monitor_threshold_state(monitor_id, rule)
+        if state < 0:
+            raise RuntimeError(f"Monitor {monitor_id} has no rule {rule}")
+        return bool(state)
+
+    def wait_alert(self, monitor_id: int, timeout_ms: int = -1) -> bool:
+        """
+        Block until one of the monitor's threshold rules changes state, or the timeout expires.
+
+        Check the rules with `get_threshold_state` after each wake.
+
+        Args:
+            monitor_id (int): Id of a monitor with at least one rule.
+            timeout_ms (int): Timeout in milliseconds, or -1 to wait indefinitely.
+
+        Returns:
+            bool: True if a rule changed state, False on timeout or if the monitor has no rules.
+        """
+        return self._wait_event(self._dll.monitor_get_alert_event(monitor_id), timeout_ms)
+
+    def release_handle_cache(self) -> int:
+        """
+        Close the process handles cached by the DLL.
+
+        Handles are cached per PID so repeated snapshots and monitoring do not reopen the
+        process on every sample; exited processes are evicted automatically. Handles still
+        in use by an active session or monitor stay open until it ends.
+
+        Returns:
+            int: Number of cache entries released.
+        """
+        return int(self._dll.release_process_cache())
@@ -2,6 +2,7 @@
 #include <windows.h>
 #include <intrin.h>
 #include <stdint.h>
+#include <limits.h>
 #include <bcrypt.h>
 #include <psapi.h>
 #include <iphlpapi.h>
@@ -14,6 +15,10 @@
 #pragma comment(lib, "iphlpapi.lib")
 #pragma comment(lib, "psapi.lib")
 
+#ifndef BCRYPT_HASH_REUSABLE_FLAG
+#define BCRYPT_HASH_REUSABLE_FLAG 0x00000020
+#endif
+
 // ============================================================
 // Globals for thread safety
 // ============================================================
@@ -33,13 +38,16 @@ typedef enum {
     RNG_EXP_COUNTER = 0,   // Counter-chained rehashing (default)
     RNG_EXP_HKDF    = 1,   // HKDF-Expand using HMAC
     RNG_EXP_HMAC    = 2,   // HMAC(PRK, counter || prev) stream
-    RNG_EXP_XOF     = 3    // XOF-like fallback using HMAC stream (no SHAKE)
+    RNG_EXP_XOF     = 3,   // XOF-like fallback using HMAC stream (no SHAKE)
+    RNG_EXP_AESCTR  = 4,   // AES-256-CTR keystream keyed from the HKDF PRK
+    RNG_EXP_RDSEED  = 5    // 64-bit RDSEED/RDRAND words straight from the CPU
 } RNG_EXP_MODE;
 
 typedef enum {
     RNG_THREAD_NONE     = 0, // lock-free
     RNG_THREAD_CRITSEC  = 1, // use internal critical section
-    RNG_THREAD_USERLOCK = 2  // user callbacks
+    RNG_THREAD_USERLOCK = 2, // user callbacks
+    RNG_THREAD_TLS      = 3  // per-thread DRBG, lock-free after seeding
 } RNG_THREAD_MODE;
 
 typedef enum {
@@ -94,6 +102,13 @@ typedef struct {
     // Optional HKDF info/context for Expand
     const unsigned char *info;
     int info_len;
+
+    // Adaptive source selection: a collector whose first round takes longer than this
+    // many microseconds is skipped for the remaining rounds of the call (0 = off)
+    unsigned int collector_budget_us;
+
+    // Run the slow collectors (disk, audio, battery, network) concurrently on the thread pool
+    int parallel_collect;
 } RNG_CONFIG;
 
 // ============================================================
@@ -113,58 +128,397 @@ static int rdrand32_retry(uint32_t *val) {
     return 0;
 }
 
+static int rdseed_supported(void) {
+    int cpuInfo[4];
+    __cpuid(cpuInfo, 0);
+    if (cpuInfo[0] < 7) return 0;
+    __cpuidex(cpuInfo, 7, 0);
+    return (cpuInfo[1] & (1 << 18)) != 0;
+}
+
+static int rdrand64_retry(uint64_t *val) {
+#if defined(_M_X64)
+    for (int i = 0; i < 10; i++) {
+        if (_rdrand64_step((unsigned __int64*)val))
+            return 1;
+    }
+    return 0;
+#else
+    uint32_t lo = 0, hi = 0;
+    if (!rdrand32_retry(&lo) || !rdrand32_retry(&hi)) return 0;
+    *val = ((uint64_t)hi << 32) | lo;
+    return 1;
+#endif
+}
+
+// RDSEED underflows under load, so only a few attempts before the caller falls back
+static int rdseed64_try(uint64_t *val) {
+#if defined(_M_X64)
+    for (int i = 0; i < 4; i++) {
+        if (_rdseed64_step((unsigned __int64*)val))
+            return 1;
+    }
+    return 0;
+#else
+    unsigned int lo = 0, hi = 0;
+    for (int i = 0; i < 4; i++) {
+        if (_rdseed32_step(&lo)) break;
+        if (i == 3) return 0;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (_rdseed32_step(&hi)) break;
+        if (i == 3) return 0;
+    }
+    *val = ((uint64_t)hi << 32) | lo;
+    return 1;
+#endif
+}
+
 // ============================================================
 // Entropy collectors
 // ============================================================
+// Collectors write through a sink so the bytes each one contributes can be counted.
+// A sink without a hash buffers its input (parallel collection hashes it later, in order).
+typedef struct {
+    BCRYPT_HASH_HANDLE hHash;
+    unsigned long long bytes;
+    unsigned char *buf;
+    size_t len, cap;
+} RNG_SINK;
+
+static void sink_feed(RNG_SINK *sink, const void *data, const ULONG len) {
+    if (sink->hHash) {
+        if (BCRYPT_SUCCESS(BCryptHashData(sink->hHash, (PUCHAR)data, len, 0))) sink->bytes += len;
+        return;
+    }
+    if (sink->len + len > sink->cap) {
+        size_t cap = sink->cap ? sink->cap * 2 : 256;
+        while (cap < sink->len + len) cap *= 2;
+        unsigned char *grown = (unsigned char*)malloc(cap);
+        if (!grown) return;
+        if (sink->buf) {
+            memcpy(grown, sink->buf, sink->len);
+            SecureZeroMemory(sink->buf, sink->cap);
+            free(sink->buf);
+        }
+        sink->buf = grown;
+        sink->cap = cap;
+    }
+    memcpy(sink->buf + sink->len, data, len);
+    sink->len += len;
+    sink->bytes += len;
+}
+
+static void sink_release(RNG_SINK *sink) {
+    if (sink->buf) {
+        SecureZeroMemory(sink->buf, sink->cap);
+        free(sink->buf);
+    }
+    sink->buf = NULL;
+    sink->len = sink->cap = 0;
+}
+
+// Snapshot cache for sources whose values barely change between calls (disk, network).
+// A snapshot is reused until the TTL expires or a change notification marks it dirty;
+// every use still hashes a fresh QPC/RDTSC pair after it. Off by default: callers opt in
+// through maxrng_set_source_ttl.
+#define RNG_SOURCE_TTL_DEFAULT 0
+
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    ULONGLONG fetched_tick;
+    volatile LONG dirty;
+    SRWLOCK lock;
+} RNG_SOURCE_CACHE;
+
+static volatile LONG g_sourceTtlMs = RNG_SOURCE_TTL_DEFAULT; // 0 = query every round
+
+static void cached_source_feed(RNG_SOURCE_CACHE *cache, void (*snapshot)(RNG_SINK *sink), RNG_SINK *sink) {
+    const DWORD ttl = (DWORD)InterlockedCompareExchange(&g_sourceTtlMs, 0, 0);
+    if (ttl == 0) {
+        snapshot(sink);
+    } else {
+        const ULONGLONG now = GetTickCount64();
+        int fed = 0;
+
+        AcquireSRWLockShared(&cache->lock);
+        if (cache->data && !cache->dirty && now - cache->fetched_tick < ttl) {
+            sink_feed(sink, cache->data, (ULONG)cache->len);
+            fed = 1;
+        }
+        ReleaseSRWLockShared(&cache->lock);
+
+        if (!fed) {
+            // Clear first so a notification arriving mid-refresh is not lost
+            InterlockedExchange(&cache->dirty, 0);
+            RNG_SINK fresh = { NULL, 0, NULL, 0, 0 };
+            snapshot(&fresh);
+
+            AcquireSRWLockExclusive(&cache->lock);
+            if (cache->data) {
+                SecureZeroMemory(cache->data, cache->len);
+                free(cache->data);
+            }
+            cache->data = fresh.buf; // ownership moves to the cache
+            cache->len = fresh.len;
+            cache->fetched_tick = now;
+            if (cache->data) sink_feed(sink, cache->data, (ULONG)cache->len);
+            ReleaseSRWLockExclusive(&cache->lock);
+        }
+    }
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    const uint64_t tsc = __rdtsc();
+    sink_feed(sink, (PUCHAR)&counter, sizeof(counter));
+    sink_feed(sink, &tsc, sizeof(tsc));
+}
+
+static void source_cache_release(RNG_SOURCE_CACHE *cache) {
+    AcquireSRWLockExclusive(&cache->lock);
+    if (cache->data) {
+        SecureZeroMemory(cache->data, cache->len);
+        free(cache->data);
+    }
+    cache->data = NULL;
+    cache->len = 0;
+    cache->fetched_tick = 0;
+    ReleaseSRWLockExclusive(&cache->lock);
+}
+
+static RNG_SOURCE_CACHE g_diskCache;
+static RNG_SOURCE_CACHE g_netCache;
+
+// RDRAND sample (one 64-bit word)
+static void collect_rdrand_entropy(RNG_SINK *sink)
+{
+    uint64_t rndVal = 0;
+    if (rdrand_supported() && rdrand64_retry(&rndVal)) {
+        sink_feed(sink, &rndVal, sizeof(rndVal));
+    }
+}
+
 // Collect CPU info entropy: CPUID and RDTSC
-static void collect_cpu_entropy(const BCRYPT_HASH_HANDLE hHash)
+static void collect_cpu_entropy(RNG_SINK *sink)
 {
     int cpuInfo[4];
     __cpuid(cpuInfo, 0);
-    BCryptHashData(hHash, (PUCHAR)cpuInfo, sizeof(cpuInfo), 0);
+    sink_feed(sink, (PUCHAR)cpuInfo, sizeof(cpuInfo));
 
     __cpuid(cpuInfo, 1);
-    BCryptHashData(hHash, (PUCHAR)cpuInfo, sizeof(cpuInfo), 0);
+    sink_feed(sink, (PUCHAR)cpuInfo, sizeof(cpuInfo));
 
     uint64_t tsc = __rdtsc();
-    BCryptHashData(hHash, (PUCHAR)&tsc, sizeof(tsc), 0);
+    sink_feed(sink, (PUCHAR)&tsc, sizeof(tsc));
 }
 
 // Process memory info entropy
-static void collect_process_memory_entropy(const BCRYPT_HASH_HANDLE hHash)
+static void collect_process_memory_entropy(RNG_SINK *sink)
 {
     PROCESS_MEMORY_COUNTERS pmc = { 0 };
     if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
     {
-        BCryptHashData(hHash, (PUCHAR)&pmc, sizeof(pmc), 0);
+        sink_feed(sink, (PUCHAR)&pmc, sizeof(pmc));
     }
 }
 
 // Performance counter entropy
-static void collect_perf_counter_entropy(const BCRYPT_HASH_HANDLE hHash)
+static void collect_perf_counter_entropy(RNG_SINK *sink)
 {
     LARGE_INTEGER counter;
     if (QueryPerformanceCounter(&counter))
     {
-        BCryptHashData(hHash, (PUCHAR)&counter, sizeof(counter), 0);
+        sink_feed(sink, (PUCHAR)&counter, sizeof(counter));
     }
 }
 
 // Disk free space entropy
-static void collect_disk_entropy(const BCRYPT_HASH_HANDLE hHash)
+static void disk_snapshot(RNG_SINK *sink)
 {
     ULARGE_INTEGER freeBytesAvailable, totalNumberOfBytes, totalNumberOfFreeBytes;
     if (GetDiskFreeSpaceExA("C:\\", &freeBytesAvailable, &totalNumberOfBytes, &totalNumberOfFreeBytes))
     {
-        BCryptHashData(hHash, (PUCHAR)&freeBytesAvailable, sizeof(freeBytesAvailable), 0);
-        BCryptHashData(hHash, (PUCHAR)&totalNumberOfBytes, sizeof(totalNumberOfBytes), 0);
-        BCryptHashData(hHash, (PUCHAR)&totalNumberOfFreeBytes, sizeof(totalNumberOfFreeBytes), 0);
+        sink_feed(sink, (PUCHAR)&freeBytesAvailable, sizeof(freeBytesAvailable));
+        sink_feed(sink, (PUCHAR)&totalNumberOfBytes, sizeof(totalNumberOfBytes));
+        sink_feed(sink, (PUCHAR)&totalNumberOfFreeBytes, sizeof(totalNumberOfFreeBytes));
+    }
+}
+
+static void collect_disk_entropy(RNG_SINK *sink)
+{
+    cached_source_feed(&g_diskCache, disk_snapshot, sink);
+}
+
+// Persistent audio capture (opt-in): the device stays open and a capture thread requeues
+// completed buffers into a ring, so the collector only copies the newest samples.
+// waveIn functions may not be called from a waveIn callback, hence CALLBACK_EVENT + thread.
+#define RNG_AUDIO_BUFFERS  4
+#define RNG_AUDIO_BUF_SIZE 256   // 32 ms per buffer at 8 kHz, 8-bit mono
+#define RNG_AUDIO_RING     4096
+#define RNG_AUDIO_SNAPSHOT 256
+
+typedef struct {
+    volatile LONG running;
+    HWAVEIN hWaveIn;
+    HANDLE thread;
+    HANDLE dataEvent;            // signalled by the driver when a buffer completes
+    HANDLE stopEvent;
+    WAVEHDR hdr[RNG_AUDIO_BUFFERS];
+    BYTE data[RNG_AUDIO_BUFFERS][RNG_AUDIO_BUF_SIZE];
+    unsigned char ring[RNG_AUDIO_RING];
+    int write_pos;
+    unsigned long long total;    // bytes ever written to the ring
+    SRWLOCK lock;                // guards ring, write_pos, total
+    SRWLOCK controlLock;         // serializes start/stop
+} RNG_AUDIO_CAPTURE;
+
+static RNG_AUDIO_CAPTURE g_audio;
+
+// ReSharper disable once CppParameterMayBeConst
+static DWORD WINAPI audio_capture_proc(LPVOID param) {
+    (void)param;
+    HANDLE events[2] = { g_audio.stopEvent, g_audio.dataEvent };
+
+    while (WaitForMultipleObjects(2, events, FALSE, INFINITE) != WAIT_OBJECT_0) {
+        for (int i = 0; i < RNG_AUDIO_BUFFERS; i++) {
+            WAVEHDR *hdr = &g_audio.hdr[i];
+            if (!(hdr->dwFlags & WHDR_DONE)) continue;
+
+            AcquireSRWLockExclusive(&g_audio.lock);
+            for (DWORD b = 0; b < hdr->dwBytesRecorded; b++) {
+                g_audio.ring[g_audio.write_pos] = (unsigned char)hdr->lpData[b];
+                g_audio.write_pos = (g_audio.write_pos + 1) % RNG_AUDIO_RING;
+            }
+            g_audio.total += hdr->dwBytesRecorded;
+            ReleaseSRWLockExclusive(&g_audio.lock);
+
+            hdr->dwFlags &= ~WHDR_DONE;
+            waveInAddBuffer(g_audio.hWaveIn, hdr, sizeof(*hdr));
+        }
+    }
+    return 0;
+}
+
+static void audio_capture_close_device(void) {
+    if (g_audio.hWaveIn) {
+        waveInReset(g_audio.hWaveIn); // returns every queued buffer
+        for (int i = 0; i < RNG_AUDIO_BUFFERS; i++) {
+            if (g_audio.hdr[i].dwFlags & WHDR_PREPARED)
+                waveInUnprepareHeader(g_audio.hWaveIn, &g_audio.hdr[i], sizeof(WAVEHDR));
+        }
+        waveInClose(g_audio.hWaveIn);
+        g_audio.hWaveIn = NULL;
+    }
+    if (g_audio.dataEvent) CloseHandle(g_audio.dataEvent);
+    if (g_audio.stopEvent) CloseHandle(g_audio.stopEvent);
+    g_audio.dataEvent = g_audio.stopEvent = NULL;
+    SecureZeroMemory(g_audio.data, sizeof(g_audio.data));
+}
+
+static int audio_capture_start(void) {
+    AcquireSRWLockExclusive(&g_audio.controlLock);
+    if (g_audio.running) {
+        ReleaseSRWLockExclusive(&g_audio.controlLock);
+        return 0;
+    }
+
+    WAVEFORMATEX wfx = {0};
+    wfx.wFormatTag = WAVE_FORMAT_PCM;
+    wfx.nChannels = 1;
+    wfx.nSamplesPerSec = 8000;
+    wfx.wBitsPerSample = 8;
+    wfx.nBlockAlign = 1;
+    wfx.nAvgBytesPerSec = 8000;
+    wfx.cbSize = 0;
+
+    int ok = 0;
+    g_audio.dataEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    g_audio.stopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (g_audio.dataEvent && g_audio.stopEvent &&
+        waveInOpen(&g_audio.hWaveIn, WAVE_MAPPER, &wfx, (DWORD_PTR)g_audio.dataEvent, 0, CALLBACK_EVENT) == MMSYSERR_NOERROR)
+    {
+        ok = 1;
+        for (int i = 0; ok && i < RNG_AUDIO_BUFFERS; i++) {
+            WAVEHDR *hdr = &g_audio.hdr[i];
+            memset(hdr, 0, sizeof(*hdr));
+            hdr->lpData = (LPSTR)g_audio.data[i];
+            hdr->dwBufferLength = RNG_AUDIO_BUF_SIZE;
+            ok = waveInPrepareHeader(g_audio.hWaveIn, hdr, sizeof(*hdr)) == MMSYSERR_NOERROR &&
+                 waveInAddBuffer(g_audio.hWaveIn, hdr, sizeof(*hdr)) == MMSYSERR_NOERROR;
+        }
+        if (ok) g_audio.thread = CreateThread(NULL, 0, audio_capture_proc, NULL, 0, NULL);
+        ok = ok && g_audio.thread && waveInStart(g_audio.hWaveIn) == MMSYSERR_NOERROR;
+    } else {
+        g_audio.hWaveIn = NULL;
+    }
+
+    if (!ok) {
+        if (g_audio.thread) {
+            SetEvent(g_audio.stopEvent);
+            WaitForSingleObject(g_audio.thread, INFINITE);
+            CloseHandle(g_audio.thread);
+            g_audio.thread = NULL;
+        }
+        audio_capture_close_device();
+    } else {
+        InterlockedExchange(&g_audio.running, 1);
+    }
+    ReleaseSRWLockExclusive(&g_audio.controlLock);
+    return ok;
+}
+
+static int audio_capture_stop(void) {
+    AcquireSRWLockExclusive(&g_audio.controlLock);
+    if (InterlockedExchange(&g_audio.running, 0) == 0) {
+        ReleaseSRWLockExclusive(&g_audio.controlLock);
+        return 0;
+    }
+
+    SetEvent(g_audio.stopEvent);
+    WaitForSingleObject(g_audio.thread, INFINITE);
+    CloseHandle(g_audio.thread);
+    g_audio.thread = NULL;
+    audio_capture_close_device();
+
+    AcquireSRWLockExclusive(&g_audio.lock);
+    SecureZeroMemory(g_audio.ring, sizeof(g_audio.ring));
+    g_audio.write_pos = 0;
+    g_audio.total = 0;
+    ReleaseSRWLockExclusive(&g_audio.lock);
+    ReleaseSRWLockExclusive(&g_audio.controlLock);
+    return 1;
+}
+
+// Hashes the newest captured samples plus a timestamp; never blocks on the device
+static void collect_audio_ring(RNG_SINK *sink) {
+    unsigned char snap[RNG_AUDIO_SNAPSHOT];
+    unsigned long long total;
+
+    AcquireSRWLockShared(&g_audio.lock);
+    total = g_audio.total;
+    const int avail = total < RNG_AUDIO_SNAPSHOT ? (int)total : RNG_AUDIO_SNAPSHOT;
+    for (int i = 0; i < avail; i++) {
+        snap[i] = g_audio.ring[(g_audio.write_pos - avail + i + RNG_AUDIO_RING) % RNG_AUDIO_RING];
     }
+    ReleaseSRWLockShared(&g_audio.lock);
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    if (avail > 0) sink_feed(sink, snap, (ULONG)avail);
+    sink_feed(sink, &total, sizeof(total));
+    sink_feed(sink, (PUCHAR)&counter, sizeof(counter));
+    SecureZeroMemory(snap, sizeof(snap));
 }
 
 // Audio entropy fallback (simple timing fallback)
-static void collect_audio_entropy(const BCRYPT_HASH_HANDLE hHash)
+static void collect_audio_entropy(RNG_SINK *sink)
 {
+    if (InterlockedCompareExchange(&g_audio.running, 0, 0)) {
+        collect_audio_ring(sink);
+        return;
+    }
+
     HWAVEIN hWaveIn = NULL;
     WAVEFORMATEX wfx = {0};
     wfx.wFormatTag = WAVE_FORMAT_PCM;
@@ -188,7 +542,7 @@ static void collect_audio_entropy(const BCRYPT_HASH_HANDLE hHash)
                 if (waveInStart(hWaveIn) == MMSYSERR_NOERROR) {
                     Sleep(50); // Let it capture some audio
                     waveInStop(hWaveIn);
-                    BCryptHashData(hHash, buffer, sizeof(buffer), 0);
+                    sink_feed(sink, buffer, sizeof(buffer));
                 }
             }
             waveInUnprepareHeader(hWaveIn, &hdr, sizeof(hdr));
@@ -200,49 +554,196 @@ static void collect_audio_entropy(const BCRYPT_HASH_HANDLE hHash)
         {
             LARGE_INTEGER counter;
             QueryPerformanceCounter(&counter);
-            BCryptHashData(hHash, (PUCHAR)&counter, sizeof(counter), 0);
+            sink_feed(sink, (PUCHAR)&counter, sizeof(counter));
             Sleep(10);
         }
     }
 }
 
 // Battery info entropy
-static void collect_battery_entropy(const BCRYPT_HASH_HANDLE hHash)
+static void collect_battery_entropy(RNG_SINK *sink)
 {
     SYSTEM_POWER_STATUS status = { 0 };
     if (GetSystemPowerStatus(&status))
     {
-        BCryptHashData(hHash, (PUCHAR)&status, sizeof(status), 0);
+        sink_feed(sink, (PUCHAR)&status, sizeof(status));
     }
 }
 
 // Network stats entropy
-static void collect_network_entropy(const BCRYPT_HASH_HANDLE hHash)
+// Interface and address change notifications invalidate the cached network snapshot
+static HANDLE g_ipInterfaceNotify;
+static HANDLE g_ipAddressNotify;
+static volatile LONG g_ipNotifyState; // 0 = not tried yet, 1 = registered, -1 = registration failed
+
+// ReSharper disable once CppParameterMayBeConst
+static void NTAPI ip_interface_changed(PVOID ctx, PMIB_IPINTERFACE_ROW row, MIB_NOTIFICATION_TYPE type) {
+    (void)ctx; (void)row; (void)type;
+    InterlockedExchange(&g_netCache.dirty, 1);
+}
+
+// ReSharper disable once CppParameterMayBeConst
+static void NTAPI ip_address_changed(PVOID ctx, PMIB_UNICASTIPADDRESS_ROW row, MIB_NOTIFICATION_TYPE type) {
+    (void)ctx; (void)row; (void)type;
+    InterlockedExchange(&g_netCache.dirty, 1);
+}
+
+static void network_snapshot(RNG_SINK *sink)
 {
     MIB_TCPSTATS stats = { 0 };
     if (GetTcpStatistics(&stats) == NO_ERROR)
     {
-        BCryptHashData(hHash, (PUCHAR)&stats, sizeof(stats), 0);
+        sink_feed(sink, (PUCHAR)&stats, sizeof(stats));
     }
 
-    // Adapter info
-    ULONG size = 0;
-    GetAdaptersInfo(NULL, &size);
-    if (size > 0)
+    // Adapter info: one call with a typical size, a second only if it was too small
+    ULONG size = 16 * 1024;
+    for (int attempt = 0; attempt < 2; attempt++)
     {
         // ReSharper disable once CppLocalVariableMayBeConst
         PIP_ADAPTER_INFO pAdapterInfo = (PIP_ADAPTER_INFO)malloc(size);
-        if (pAdapterInfo)
-        {
-            if (GetAdaptersInfo(pAdapterInfo, &size) == NO_ERROR)
-            {
-                BCryptHashData(hHash, (PUCHAR)pAdapterInfo, size, 0);
-            }
-            free(pAdapterInfo);
+        if (!pAdapterInfo) break;
+        const DWORD rc = GetAdaptersInfo(pAdapterInfo, &size);
+        if (rc == NO_ERROR) {
+            for (const IP_ADAPTER_INFO *a = pAdapterInfo; a; a = a->Next)
+                sink_feed(sink, (PUCHAR)a, sizeof(*a));
+        }
+        free(pAdapterInfo);
+        if (rc != ERROR_BUFFER_OVERFLOW) break;
+    }
+}
+
+static void collect_network_entropy(RNG_SINK *sink)
+{
+    if (InterlockedCompareExchange(&g_sourceTtlMs, 0, 0) != 0 &&
+        InterlockedCompareExchange(&g_ipNotifyState, 0, 0) == 0) {
+        AcquireSRWLockExclusive(&g_netCache.lock);
+        if (g_ipNotifyState == 0) {
+            // Tried once: a failed registration only means the snapshot relies on the TTL alone
+            const DWORD rcIf = NotifyIpInterfaceChange(AF_UNSPEC, ip_interface_changed, NULL, FALSE,
+                                                       &g_ipInterfaceNotify);
+            const DWORD rcAddr = NotifyUnicastIpAddressChange(AF_UNSPEC, ip_address_changed, NULL, FALSE,
+                                                              &g_ipAddressNotify);
+            if (rcIf != NO_ERROR) g_ipInterfaceNotify = NULL;
+            if (rcAddr != NO_ERROR) g_ipAddressNotify = NULL;
+            InterlockedExchange(&g_ipNotifyState, (g_ipInterfaceNotify || g_ipAddressNotify) ? 1 : -1);
         }
+        ReleaseSRWLockExclusive(&g_netCache.lock);
+    }
+    cached_source_feed(&g_netCache, network_snapshot, sink);
+}
+
+static void release_source_caches(void) {
+    AcquireSRWLockExclusive(&g_netCache.lock);
+    if (g_ipInterfaceNotify) CancelMibChangeNotify2(g_ipInterfaceNotify);
+    if (g_ipAddressNotify) CancelMibChangeNotify2(g_ipAddressNotify);
+    g_ipInterfaceNotify = g_ipAddressNotify = NULL;
+    InterlockedExchange(&g_ipNotifyState, 0);
+    ReleaseSRWLockExclusive(&g_netCache.lock);
+    source_cache_release(&g_netCache);
+    source_cache_release(&g_diskCache);
+}
+
+// ============================================================
+// Collector table and per-collector statistics
+// ============================================================
+// Table order is the order sources are hashed in
+typedef enum {
+    RNG_SRC_RDRAND  = 0,
+    RNG_SRC_CPU     = 1,
+    RNG_SRC_MEMORY  = 2,
+    RNG_SRC_PERF    = 3,
+    RNG_SRC_DISK    = 4,
+    RNG_SRC_AUDIO   = 5,
+    RNG_SRC_BATTERY = 6,
+    RNG_SRC_NETWORK = 7,
+    RNG_SRC_COUNT   = 8
+} RNG_SOURCE;
+
+static void (*const g_collectors[RNG_SRC_COUNT])(RNG_SINK *sink) = {
+    collect_rdrand_entropy,
+    collect_cpu_entropy,
+    collect_process_memory_entropy,
+    collect_perf_counter_entropy,
+    collect_disk_entropy,
+    collect_audio_entropy,
+    collect_battery_entropy,
+    collect_network_entropy
+};
+
+// Exported view of one collector's counters (times in QPC ticks)
+typedef struct {
+    unsigned long long calls;     // times the collector ran
+    unsigned long long skipped;   // rounds skipped by the adaptive budget
+    unsigned long long total_qpc; // summed run time
+    unsigned long long max_qpc;   // slowest single run
+    unsigned long long bytes;     // bytes hashed
+} RNG_COLLECTOR_STATS;
+
+typedef struct {
+    volatile LONG64 calls;
+    volatile LONG64 skipped;
+    volatile LONG64 total_qpc;
+    volatile LONG64 max_qpc;
+    volatile LONG64 bytes;
+} RNG_STATS_SLOT;
+
+static volatile LONG g_statsEnabled = 0;
+static RNG_STATS_SLOT g_collectorStats[RNG_SRC_COUNT];
+static LONG64 g_qpcFrequency;
+
+static LONG64 qpc_frequency(void) {
+    if (!g_qpcFrequency) {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        g_qpcFrequency = f.QuadPart;
+    }
+    return g_qpcFrequency;
+}
+
+static void stats_record(const RNG_SOURCE src, const LONG64 ticks, const LONG64 bytes) {
+    RNG_STATS_SLOT *slot = &g_collectorStats[src];
+    InterlockedIncrement64(&slot->calls);
+    InterlockedAdd64(&slot->total_qpc, ticks);
+    InterlockedAdd64(&slot->bytes, bytes);
+    LONG64 prev = slot->max_qpc;
+    while (ticks > prev) {
+        const LONG64 seen = InterlockedCompareExchange64(&slot->max_qpc, ticks, prev);
+        if (seen == prev) break;
+        prev = seen;
     }
 }
 
+// Per-call state shared across the rounds of one gather
+typedef struct {
+    int round;
+    unsigned char skip[RNG_SRC_COUNT];
+} RNG_GATHER_STATE;
+
+static void run_collector(const RNG_SOURCE src, RNG_SINK *sink, const RNG_CONFIG *cfg, RNG_GATHER_STATE *gs) {
+    const int stats = InterlockedCompareExchange(&g_statsEnabled, 0, 0) != 0;
+    if (gs && gs->skip[src]) {
+        if (stats) InterlockedIncrement64(&g_collectorStats[src].skipped);
+        return;
+    }
+
+    const int budgeted = gs && gs->round == 0 && cfg->collector_budget_us > 0;
+    if (!stats && !budgeted) {
+        g_collectors[src](sink);
+        return;
+    }
+
+    LARGE_INTEGER t0, t1;
+    const unsigned long long before = sink->bytes;
+    QueryPerformanceCounter(&t0);
+    g_collectors[src](sink);
+    QueryPerformanceCounter(&t1);
+    const LONG64 ticks = t1.QuadPart - t0.QuadPart;
+
+    if (stats) stats_record(src, ticks, (LONG64)(sink->bytes - before));
+    if (budgeted && ticks * 1000000 / qpc_frequency() > (LONG64)cfg->collector_budget_us) gs->skip[src] = 1;
+}
+
 // ============================================================
 /* Hash provider helpers */
 // ============================================================
@@ -264,14 +765,208 @@ static DWORD algo_digest_len(const RNG_HASH_ALGO a) {
     }
 }
 
+static int algo_index(const RNG_HASH_ALGO a) {
+    switch (a) {
+        case RNG_HASH_SHA512: return 1;
+        case RNG_HASH_SHA1:   return 2;
+        case RNG_HASH_SHA256:
+        default:              return 0;
+    }
+}
+
+// Process-wide provider cache, indexed by [algo_index][hmac]. Providers are opened
+// lazily on first use and kept until maxrng_shutdown().
+static BCRYPT_ALG_HANDLE g_providers[3][2];
+static SRWLOCK g_providerLock = SRWLOCK_INIT;
+
+static BCRYPT_ALG_HANDLE get_provider(const RNG_HASH_ALGO algo, const int hmac) {
+    BCRYPT_ALG_HANDLE *slot = &g_providers[algo_index(algo)][hmac ? 1 : 0];
+
+    AcquireSRWLockShared(&g_providerLock);
+    BCRYPT_ALG_HANDLE hAlg = *slot;
+    ReleaseSRWLockShared(&g_providerLock);
+    if (hAlg) return hAlg;
+
+    AcquireSRWLockExclusive(&g_providerLock);
+    if (!*slot) {
+        BCRYPT_ALG_HANDLE h = NULL;
+        DWORD cbHash = 0, cbData = 0;
+        NTSTATUS s = BCryptOpenAlgorithmProvider(&h, algo_name_from_enum(algo), NULL,
+                                                 hmac ? BCRYPT_ALG_HANDLE_HMAC_FLAG : 0);
+        if (BCRYPT_SUCCESS(s)) {
+            s = BCryptGetProperty(h, BCRYPT_HASH_LENGTH, (PUCHAR)&cbHash, sizeof(cbHash), &cbData, 0);
+            if (BCRYPT_SUCCESS(s) && cbHash == algo_digest_len(algo)) *slot = h;
+            else BCryptCloseAlgorithmProvider(h, 0);
+        }
+    }
+    hAlg = *slot;
+    ReleaseSRWLockExclusive(&g_providerLock);
+    return hAlg;
+}
+
+// Cached AES provider in ECB mode, used to encrypt counter blocks for RNG_EXP_AESCTR
+static BCRYPT_ALG_HANDLE g_aesProvider;
+
+static BCRYPT_ALG_HANDLE get_aes_provider(void) {
+    AcquireSRWLockShared(&g_providerLock);
+    BCRYPT_ALG_HANDLE hAlg = g_aesProvider;
+    ReleaseSRWLockShared(&g_providerLock);
+    if (hAlg) return hAlg;
+
+    AcquireSRWLockExclusive(&g_providerLock);
+    if (!g_aesProvider) {
+        BCRYPT_ALG_HANDLE h = NULL;
+        NTSTATUS s = BCryptOpenAlgorithmProvider(&h, BCRYPT_AES_ALGORITHM, NULL, 0);
+        if (BCRYPT_SUCCESS(s)) {
+            s = BCryptSetProperty(h, BCRYPT_CHAINING_MODE, (PUCHAR)BCRYPT_CHAIN_MODE_ECB,
+                                  sizeof(BCRYPT_CHAIN_MODE_ECB), 0);
+            if (BCRYPT_SUCCESS(s)) g_aesProvider = h;
+            else BCryptCloseAlgorithmProvider(h, 0);
+        }
+    }
+    hAlg = g_aesProvider;
+    ReleaseSRWLockExclusive(&g_providerLock);
+    return hAlg;
+}
+
+// Creates a reusable hash object: BCryptFinishHash resets it (keeping the HMAC key)
+// so it can be fed the next message without being recreated. Requires Windows 8+.
+static int hash_create(const RNG_HASH_ALGO algo, const int hmac,
+                       const unsigned char *key, const int key_len,
+                       BCRYPT_HASH_HANDLE *phHash)
+{
+    *phHash = NULL;
+    // ReSharper disable once CppLocalVariableMayBeConst
+    BCRYPT_ALG_HANDLE hAlg = get_provider(algo, hmac);
+    if (!hAlg) return 0;
+    const NTSTATUS s = BCryptCreateHash(hAlg, phHash, NULL, 0, (PUCHAR)key, key ? (ULONG)key_len : 0,
+                                        BCRYPT_HASH_REUSABLE_FLAG);
+    return BCRYPT_SUCCESS(s) ? 1 : 0;
+}
+
+static void release_providers(void) {
+    AcquireSRWLockExclusive(&g_providerLock);
+    for (int a = 0; a < 3; a++) {
+        for (int h = 0; h < 2; h++) {
+            if (g_providers[a][h]) {
+                BCryptCloseAlgorithmProvider(g_providers[a][h], 0);
+                g_providers[a][h] = NULL;
+            }
+        }
+    }
+    if (g_aesProvider) {
+        BCryptCloseAlgorithmProvider(g_aesProvider, 0);
+        g_aesProvider = NULL;
+    }
+    ReleaseSRWLockExclusive(&g_providerLock);
+}
+
 // ============================================================
 // Base64 and hex utilities
 // ============================================================
+// Encoders dispatch on the best instruction set the CPU and OS support (probed once);
+// the scalar loops handle tails and act as fallback.
+#define RNG_SIMD_SCALAR 0
+#define RNG_SIMD_SSSE3  1
+#define RNG_SIMD_AVX2   2
+
+static volatile LONG g_simdLevel = -1;
+
+static int simd_level(void) {
+    LONG level = g_simdLevel;
+    if (level >= 0) return (int)level;
+
+    int cpuInfo[4];
+    level = RNG_SIMD_SCALAR;
+    __cpuid(cpuInfo, 0);
+    const int max_leaf = cpuInfo[0];
+    __cpuid(cpuInfo, 1);
+    if (cpuInfo[2] & (1 << 9)) level = RNG_SIMD_SSSE3;
+    // AVX2 also needs OSXSAVE and the OS saving YMM state
+    if (level == RNG_SIMD_SSSE3 && max_leaf >= 7 && (cpuInfo[2] & (1 << 27)) &&
+        (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(cpuInfo, 7, 0);
+        if (cpuInfo[1] & (1 << 5)) level = RNG_SIMD_AVX2;
+    }
+    InterlockedExchange(&g_simdLevel, level);
+    return (int)level;
+}
+
 static int base64_len(const int n) {
     // 4 * ceil(n/3)
     return 4 * ((n + 2) / 3);
 }
 
+// 12 bytes (read as 16) -> 16 six-bit indices, one per byte (Mula's pshufb/multiply split)
+static __m128i base64_split_ssse3(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+// Six-bit indices -> ASCII by adding a per-range offset picked with pshufb
+static __m128i base64_lookup_ssse3(const __m128i idx) {
+    const __m128i shift_lut = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    // 0..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12; then 0..25 -> 13
+    __m128i sel = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), idx);
+    sel = _mm_or_si128(sel, _mm_and_si128(less, _mm_set1_epi8(13)));
+    return _mm_add_epi8(_mm_shuffle_epi8(shift_lut, sel), idx);
+}
+
+static __m256i base64_lookup_avx2(const __m256i idx) {
+    const __m256i shift_lut = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    __m256i sel = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+    const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx);
+    sel = _mm256_or_si256(sel, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    return _mm256_add_epi8(_mm256_shuffle_epi8(shift_lut, sel), idx);
+}
+
+// Vector prefix: consumes whole 12/24-byte groups while a full 16-byte load stays in bounds.
+// Returns input bytes consumed; *o receives output chars written.
+static int base64_encode_simd(const unsigned char *in, const int in_len, char *out, int *o) {
+    const int level = simd_level();
+    int i = 0;
+    *o = 0;
+    if (level >= RNG_SIMD_AVX2) {
+        const __m256i shuf = _mm256_setr_epi8(
+            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+        while (i + 28 <= in_len) {
+            // Two 12-byte groups, one per 128-bit lane
+            __m256i v = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(in + i))),
+                _mm_loadu_si128((const __m128i*)(in + i + 12)), 1);
+            v = _mm256_shuffle_epi8(v, shuf);
+            const __m256i t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00));
+            const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+            const __m256i t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0));
+            const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+            _mm256_storeu_si256((__m256i*)(out + *o), base64_lookup_avx2(_mm256_or_si256(t1, t3)));
+            i += 24;
+            *o += 32;
+        }
+    }
+    if (level >= RNG_SIMD_SSSE3) {
+        while (i + 16 <= in_len) {
+            const __m128i idx = base64_split_ssse3(_mm_loadu_si128((const __m128i*)(in + i)));
+            _mm_storeu_si128((__m128i*)(out + *o), base64_lookup_ssse3(idx));
+            i += 12;
+            *o += 16;
+        }
+    }
+    return i;
+}
+
 static int base64_encode(const unsigned char *in, const int in_len, char *out, const int out_len) {
     static const char enc[] =
         "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
@@ -279,7 +974,8 @@ static int base64_encode(const unsigned char *in, const int in_len, char *out, c
     const int needed = base64_len(in_len);
     if (out_len < needed) return 0;
 
-    int i = 0, o = 0;
+    int o = 0;
+    int i = base64_encode_simd(in, in_len, out, &o);
     while (i + 3 <= in_len) {
         const unsigned v = (in[i] << 16) | (in[i+1] << 8) | in[i+2];
         out[o++] = enc[(v >> 18) & 0x3F];
@@ -307,7 +1003,38 @@ static int base64_encode(const unsigned char *in, const int in_len, char *out, c
 
 static void hex_encode(const unsigned char *in, const int in_len, char *out) {
     static const char hex[] = "0123456789abcdef";
-    for (int i = 0; i < in_len; i++) {
+    const int level = simd_level();
+    int i = 0;
+
+    // Nibbles index a 16-entry pshufb table; unpack interleaves high/low digits in order
+    if (level >= RNG_SIMD_AVX2) {
+        const __m256i lut = _mm256_setr_epi8(
+            '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+            '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+        const __m256i mask = _mm256_set1_epi8(0x0F);
+        for (; i + 32 <= in_len; i += 32) {
+            const __m256i v = _mm256_loadu_si256((const __m256i*)(in + i));
+            const __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+            const __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, mask));
+            const __m256i a = _mm256_unpacklo_epi8(hi, lo); // bytes 0-7 | 16-23
+            const __m256i b = _mm256_unpackhi_epi8(hi, lo); // bytes 8-15 | 24-31
+            _mm256_storeu_si256((__m256i*)(out + i * 2), _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256((__m256i*)(out + i * 2 + 32), _mm256_permute2x128_si256(a, b, 0x31));
+        }
+    }
+    if (level >= RNG_SIMD_SSSE3) {
+        const __m128i lut = _mm_setr_epi8(
+            '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+        const __m128i mask = _mm_set1_epi8(0x0F);
+        for (; i + 16 <= in_len; i += 16) {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+            const __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+            const __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, mask));
+            _mm_storeu_si128((__m128i*)(out + i * 2), _mm_unpacklo_epi8(hi, lo));
+            _mm_storeu_si128((__m128i*)(out + i * 2 + 16), _mm_unpackhi_epi8(hi, lo));
+        }
+    }
+    for (; i < in_len; i++) {
         out[i*2]   = hex[(in[i] >> 4) & 0xF];
         out[i*2+1] = hex[in[i] & 0xF];
     }
@@ -321,26 +1048,13 @@ static int hmac_once(const RNG_HASH_ALGO algo,
                      const unsigned char *msg, const int msg_len,
                      unsigned char *out, const DWORD out_len)
 {
-    BCRYPT_ALG_HANDLE hAlg = NULL;
     BCRYPT_HASH_HANDLE hHash = NULL;
-    DWORD cbHash = 0, cbData = 0;
+    if (out_len != algo_digest_len(algo)) return 0;
+    if (!hash_create(algo, 1, key, key_len, &hHash)) return 0;
 
-    NTSTATUS s = BCryptOpenAlgorithmProvider(&hAlg, algo_name_from_enum(algo), NULL,
-                                             BCRYPT_ALG_HANDLE_HMAC_FLAG);
-    if (!BCRYPT_SUCCESS(s)) return 0;
-
-    s = BCryptGetProperty(hAlg, BCRYPT_HASH_LENGTH, (PUCHAR)&cbHash, sizeof(cbHash), &cbData, 0);
-    if (!BCRYPT_SUCCESS(s) || cbHash != out_len) { BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
-
-    s = BCryptCreateHash(hAlg, &hHash, NULL, 0, (PUCHAR)key, key_len, 0);
-    if (!BCRYPT_SUCCESS(s)) { BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
-
-    s = BCryptHashData(hHash, (PUCHAR)msg, msg_len, 0);
-    if (!BCRYPT_SUCCESS(s)) { BCryptDestroyHash(hHash); BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
-
-    s = BCryptFinishHash(hHash, out, cbHash, 0);
+    NTSTATUS s = BCryptHashData(hHash, (PUCHAR)msg, msg_len, 0);
+    if (BCRYPT_SUCCESS(s)) s = BCryptFinishHash(hHash, out, out_len, 0);
     BCryptDestroyHash(hHash);
-    BCryptCloseAlgorithmProvider(hAlg, 0);
     return BCRYPT_SUCCESS(s) ? 1 : 0;
 }
 
@@ -367,27 +1081,27 @@ static int hkdf_expand(const RNG_HASH_ALGO algo,
                        unsigned char *out, const int out_len)
 {
     const DWORD hash_len = algo_digest_len(algo);
+    BCRYPT_HASH_HANDLE hHash = NULL;
     unsigned char T[64];
     int t_len = 0;
     int pos = 0;
     unsigned char ctr = 1;
 
+    // One keyed HMAC object for all blocks; FinishHash resets it for the next T(i)
+    if (!hash_create(algo, 1, prk, prk_len, &hHash)) return 0;
+
     while (pos < out_len) {
         // T(i) = HMAC(PRK, T(i-1) | info | counter)
-        // Build message
-        unsigned char msg[64 + 1024 + 1]; // T prev + info + ctr; info_len bounded by int
-        int mlen = 0;
-        if (t_len > 0) {
-            memcpy(msg + mlen, T, t_len);
-            mlen += t_len;
-        }
-        if (info && info_len > 0) {
-            memcpy(msg + mlen, info, info_len);
-            mlen += info_len;
+        NTSTATUS s = 0;
+        if (t_len > 0) s = BCryptHashData(hHash, T, t_len, 0);
+        if (BCRYPT_SUCCESS(s) && info && info_len > 0) s = BCryptHashData(hHash, (PUCHAR)info, info_len, 0);
+        if (BCRYPT_SUCCESS(s)) s = BCryptHashData(hHash, &ctr, 1, 0);
+        if (BCRYPT_SUCCESS(s)) s = BCryptFinishHash(hHash, T, hash_len, 0);
+        if (!BCRYPT_SUCCESS(s)) {
+            BCryptDestroyHash(hHash);
+            SecureZeroMemory(T, sizeof(T));
+            return 0;
         }
-        msg[mlen++] = ctr;
-
-        if (!hmac_once(algo, prk, prk_len, msg, mlen, T, hash_len)) return 0;
 
         const int to_copy = (out_len - pos < (int)hash_len) ? (out_len - pos) : (int)hash_len;
         memcpy(out + pos, T, to_copy);
@@ -395,6 +1109,8 @@ static int hkdf_expand(const RNG_HASH_ALGO algo,
         t_len = (int)hash_len;
         ctr++;
     }
+    BCryptDestroyHash(hHash);
+    SecureZeroMemory(T, sizeof(T));
     return 1;
 }
 
@@ -404,21 +1120,24 @@ static int hmac_stream_expand(const RNG_HASH_ALGO algo,
                               unsigned char *out, const int out_len)
 {
     const DWORD hash_len = algo_digest_len(algo);
+    BCRYPT_HASH_HANDLE hHash = NULL;
     unsigned char prev[64];
     int prev_len = 0;
     int pos = 0;
     unsigned char ctr = 1;
 
+    if (!hash_create(algo, 1, prk, prk_len, &hHash)) return 0;
+
     while (pos < out_len) {
-        unsigned char msg[64 + 1];
-        int mlen = 0;
-        if (prev_len > 0) {
-            memcpy(msg, prev, prev_len);
-            mlen += prev_len;
+        NTSTATUS s = 0;
+        if (prev_len > 0) s = BCryptHashData(hHash, prev, prev_len, 0);
+        if (BCRYPT_SUCCESS(s)) s = BCryptHashData(hHash, &ctr, 1, 0);
+        if (BCRYPT_SUCCESS(s)) s = BCryptFinishHash(hHash, prev, hash_len, 0);
+        if (!BCRYPT_SUCCESS(s)) {
+            BCryptDestroyHash(hHash);
+            SecureZeroMemory(prev, sizeof(prev));
+            return 0;
         }
-        msg[mlen++] = ctr;
-
-        if (!hmac_once(algo, prk, prk_len, msg, mlen, prev, hash_len)) return 0;
 
         const int to_copy = (out_len - pos < (int)hash_len) ? (out_len - pos) : (int)hash_len;
         memcpy(out + pos, prev, to_copy);
@@ -426,28 +1145,268 @@ static int hmac_stream_expand(const RNG_HASH_ALGO algo,
         prev_len = (int)hash_len;
         ctr++;
     }
+    BCryptDestroyHash(hHash);
     // wipe prev
     SecureZeroMemory(prev, sizeof(prev));
     return 1;
 }
 
+// ============================================================
+// Background entropy pool
+// ============================================================
+// A worker thread runs the slow collectors (disk, audio, network) into the back buffer
+// and swaps it in under the pool lock; callers then hash ready bytes from the front
+// buffer instead of waiting on those collectors themselves.
+#define RNG_POOL_DEFAULT_SIZE   4096
+#define RNG_POOL_MIN_SIZE       64
+#define RNG_POOL_DEFAULT_REFILL 1000   // ms
+#define RNG_POOL_DRAW           64     // bytes hashed per collection round
+
+typedef struct {
+    unsigned char *buf[2];
+    int size;                  // bytes per buffer
+    int front;                 // buffer consumers read from (swapped by the worker only)
+    int read_pos;              // bytes already consumed from the front buffer
+    DWORD refill_ms;
+    RNG_CONFIG cfg;            // slow sources only
+    HANDLE thread;
+    HANDLE stopEvent;
+    HANDLE refillEvent;        // consumers request an early refill once the front drains
+    volatile DWORD threadId;
+    volatile LONG running;
+    SRWLOCK lock;
+} RNG_ENTROPY_POOL;
+
+static RNG_ENTROPY_POOL g_pool;
+
+static int collect_entropy_configurable(unsigned char *buffer, int size, int rounds,
+                                        RNG_HASH_ALGO algo, RNG_MIX_MODE mixing,
+                                        const RNG_CONFIG *cfg);
+
+// ReSharper disable once CppParameterMayBeConst
+static DWORD WINAPI pool_thread_proc(LPVOID param) {
+    (void)param;
+    g_pool.threadId = GetCurrentThreadId();
+    HANDLE events[2] = { g_pool.stopEvent, g_pool.refillEvent };
+    DWORD wait = 0; // fill immediately on start
+
+    for (;;) {
+        if (WaitForMultipleObjects(2, events, FALSE, wait) == WAIT_OBJECT_0) break;
+
+        // Only this thread moves `front`, so the back buffer is ours without the lock
+        const int back = 1 - g_pool.front;
+        if (collect_entropy_configurable(g_pool.buf[back], g_pool.size, g_pool.cfg.complexity,
+                                         g_pool.cfg.hash_algo, g_pool.cfg.mixing, &g_pool.cfg)) {
+            AcquireSRWLockExclusive(&g_pool.lock);
+            SecureZeroMemory(g_pool.buf[g_pool.front], (size_t)g_pool.size);
+            g_pool.front = back;
+            g_pool.read_pos = 0;
+            ReleaseSRWLockExclusive(&g_pool.lock);
+        }
+        wait = g_pool.refill_ms;
+    }
+    return 0;
+}
+
+// Feeds up to RNG_POOL_DRAW ready bytes into sink; returns the number of bytes used
+static int pool_feed(RNG_SINK *sink) {
+    // The worker itself must run the real collectors
+    if (!InterlockedCompareExchange(&g_pool.running, 0, 0) || GetCurrentThreadId() == g_pool.threadId) return 0;
+
+    int n = 0;
+    AcquireSRWLockExclusive(&g_pool.lock);
+    if (g_pool.buf[0]) {
+        const int avail = g_pool.size - g_pool.read_pos;
+        n = (avail < RNG_POOL_DRAW) ? avail : RNG_POOL_DRAW;
+        if (n > 0) {
+            unsigned char *p = g_pool.buf[g_pool.front] + g_pool.read_pos;
+            sink_feed(sink, p, (ULONG)n);
+            SecureZeroMemory(p, (size_t)n); // every pooled byte is handed out once
+            g_pool.read_pos += n;
+        }
+        if (g_pool.size - g_pool.read_pos < RNG_POOL_DRAW) SetEvent(g_pool.refillEvent);
+    }
+    ReleaseSRWLockExclusive(&g_pool.lock);
+    return n;
+}
+
+static int pool_start(int size, DWORD refill_ms) {
+    if (size <= 0) size = RNG_POOL_DEFAULT_SIZE;
+    if (size < RNG_POOL_MIN_SIZE) size = RNG_POOL_MIN_SIZE;
+    if (refill_ms == 0) refill_ms = RNG_POOL_DEFAULT_REFILL;
+
+    AcquireSRWLockExclusive(&g_pool.lock);
+    if (g_pool.running || g_pool.thread) {
+        ReleaseSRWLockExclusive(&g_pool.lock);
+        return 0;
+    }
+
+    memset(&g_pool.cfg, 0, sizeof(g_pool.cfg));
+    g_pool.cfg.use_disk = g_pool.cfg.use_audio = g_pool.cfg.use_network = 1;
+    g_pool.cfg.use_perf = 1;
+    g_pool.cfg.hash_algo = RNG_HASH_SHA512;
+    g_pool.cfg.mixing = RNG_MIX_ROUND_BASED;
+    g_pool.cfg.complexity = 2;
+
+    g_pool.buf[0] = (unsigned char*)calloc(1, (size_t)size);
+    g_pool.buf[1] = (unsigned char*)calloc(1, (size_t)size);
+    g_pool.stopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    g_pool.refillEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    g_pool.size = size;
+    g_pool.front = 0;
+    g_pool.read_pos = size; // empty until the first refill lands
+    g_pool.refill_ms = refill_ms;
+    g_pool.threadId = 0;
+
+    if (g_pool.buf[0] && g_pool.buf[1] && g_pool.stopEvent && g_pool.refillEvent) {
+        g_pool.thread = CreateThread(NULL, 0, pool_thread_proc, NULL, 0, NULL);
+    }
+    if (!g_pool.thread) {
+        free(g_pool.buf[0]);
+        free(g_pool.buf[1]);
+        g_pool.buf[0] = g_pool.buf[1] = NULL;
+        if (g_pool.stopEvent) CloseHandle(g_pool.stopEvent);
+        if (g_pool.refillEvent) CloseHandle(g_pool.refillEvent);
+        g_pool.stopEvent = g_pool.refillEvent = NULL;
+        ReleaseSRWLockExclusive(&g_pool.lock);
+        return 0;
+    }
+    InterlockedExchange(&g_pool.running, 1);
+    ReleaseSRWLockExclusive(&g_pool.lock);
+    return 1;
+}
+
+static int pool_stop(void) {
+    if (InterlockedExchange(&g_pool.running, 0) == 0) return 0;
+
+    // Let the worker finish its current collection before tearing down the buffers
+    SetEvent(g_pool.stopEvent);
+    WaitForSingleObject(g_pool.thread, INFINITE);
+
+    AcquireSRWLockExclusive(&g_pool.lock);
+    CloseHandle(g_pool.thread);
+    CloseHandle(g_pool.stopEvent);
+    CloseHandle(g_pool.refillEvent);
+    g_pool.thread = g_pool.stopEvent = g_pool.refillEvent = NULL;
+    for (int i = 0; i < 2; i++) {
+        SecureZeroMemory(g_pool.buf[i], (size_t)g_pool.size);
+        free(g_pool.buf[i]);
+        g_pool.buf[i] = NULL;
+    }
+    g_pool.size = g_pool.read_pos = 0;
+    g_pool.threadId = 0;
+    ReleaseSRWLockExclusive(&g_pool.lock);
+    return 1;
+}
+
+static int pool_fill_level(void) {
+    AcquireSRWLockShared(&g_pool.lock);
+    const int avail = g_pool.buf[0] ? g_pool.size - g_pool.read_pos : 0;
+    ReleaseSRWLockShared(&g_pool.lock);
+    return avail;
+}
+
 // ============================================================
 // Entropy aggregation with selectable mixing and sources
 // ============================================================
-static int hash_update_entropy_from_sources(const BCRYPT_HASH_HANDLE hHash, const RNG_CONFIG *cfg) {
-    if (cfg->use_rdrand && rdrand_supported()) {
-        uint32_t rndVal = 0;
-        if (rdrand32_retry(&rndVal)) {
-            BCryptHashData(hHash, (PUCHAR)&rndVal, sizeof(rndVal), 0);
-        }
-    }
-    if (cfg->use_cpu)     collect_cpu_entropy(hHash);
-    if (cfg->use_memory)  collect_process_memory_entropy(hHash);
-    if (cfg->use_perf)    collect_perf_counter_entropy(hHash);
-    if (cfg->use_disk)    collect_disk_entropy(hHash);
-    if (cfg->use_audio)   collect_audio_entropy(hHash);
-    if (cfg->use_battery) collect_battery_entropy(hHash);
-    if (cfg->use_network) collect_network_entropy(hHash);
+// One slow collector run on the thread pool into its own buffered sink
+typedef struct {
+    RNG_SOURCE src;
+    const RNG_CONFIG *cfg;
+    RNG_GATHER_STATE *gs;     // each task only writes its own skip[src]
+    RNG_SINK sink;
+    volatile LONG *pending;
+    HANDLE done;
+} RNG_COLLECT_TASK;
+
+// Slow collectors in flight while the caller runs the fast ones
+typedef struct {
+    RNG_COLLECT_TASK tasks[RNG_SRC_COUNT];
+    int ntasks;
+    volatile LONG pending;
+    HANDLE done;
+} RNG_COLLECT_BATCH;
+
+// ReSharper disable once CppParameterMayBeConst
+static void CALLBACK collect_task_proc(PTP_CALLBACK_INSTANCE instance, PVOID param) {
+    (void)instance;
+    RNG_COLLECT_TASK *task = (RNG_COLLECT_TASK*)param;
+    run_collector(task->src, &task->sink, task->cfg, task->gs);
+    if (InterlockedDecrement(task->pending) == 0) SetEvent(task->done);
+}
+
+// Submits the enabled slow collectors to the thread pool, each into its own buffered sink.
+// Returns 0 (nothing submitted) if the thread pool cannot be used, so the caller runs them inline.
+static int collect_slow_submit(RNG_COLLECT_BATCH *batch, const RNG_CONFIG *cfg, RNG_GATHER_STATE *gs,
+                               const int enabled[RNG_SRC_COUNT])
+{
+    memset(batch, 0, sizeof(*batch));
+    for (int src = RNG_SRC_DISK; src < RNG_SRC_COUNT; src++) {
+        if (enabled[src]) batch->tasks[batch->ntasks++].src = (RNG_SOURCE)src;
+    }
+    if (batch->ntasks < 2) return 0;
+
+    batch->done = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (!batch->done) return 0;
+
+    batch->pending = batch->ntasks;
+    for (int i = 0; i < batch->ntasks; i++) {
+        batch->tasks[i].cfg = cfg;
+        batch->tasks[i].gs = gs;
+        batch->tasks[i].pending = &batch->pending;
+        batch->tasks[i].done = batch->done;
+    }
+    for (int i = 0; i < batch->ntasks; i++) {
+        if (!TrySubmitThreadpoolCallback(collect_task_proc, &batch->tasks[i], NULL)) {
+            // Run it here instead; it still counts towards completion
+            collect_task_proc(NULL, &batch->tasks[i]);
+        }
+    }
+    return 1;
+}
+
+// Waits for a submitted batch and hashes its buffers in table order
+static void collect_slow_finish(RNG_COLLECT_BATCH *batch, RNG_SINK *sink) {
+    WaitForSingleObject(batch->done, INFINITE);
+    CloseHandle(batch->done);
+    batch->done = NULL;
+
+    for (int i = 0; i < batch->ntasks; i++) {
+        RNG_SINK *part = &batch->tasks[i].sink;
+        if (part->len > 0) BCryptHashData(sink->hHash, part->buf, (ULONG)part->len, 0);
+        sink->bytes += part->len;
+        sink_release(part);
+    }
+}
+
+static int hash_update_entropy_from_sources(const BCRYPT_HASH_HANDLE hHash, const RNG_CONFIG *cfg,
+                                            RNG_GATHER_STATE *gs) {
+    RNG_SINK sink = { hHash, 0, NULL, 0, 0 };
+    int enabled[RNG_SRC_COUNT] = {
+        cfg->use_rdrand, cfg->use_cpu, cfg->use_memory, cfg->use_perf,
+        cfg->use_disk, cfg->use_audio, cfg->use_battery, cfg->use_network
+    };
+
+    // Pre-gathered pool bytes stand in for the slow collectors when the pool is running
+    if ((enabled[RNG_SRC_DISK] || enabled[RNG_SRC_AUDIO] || enabled[RNG_SRC_NETWORK]) && pool_feed(&sink)) {
+        enabled[RNG_SRC_DISK] = enabled[RNG_SRC_AUDIO] = enabled[RNG_SRC_NETWORK] = 0;
+    }
+
+    // Start the slow collectors first so they overlap with the fast ones run below
+    RNG_COLLECT_BATCH batch;
+    const int parallel = cfg->parallel_collect && collect_slow_submit(&batch, cfg, gs, enabled);
+
+    for (int src = 0; src < RNG_SRC_DISK; src++) {
+        if (enabled[src]) run_collector((RNG_SOURCE)src, &sink, cfg, gs);
+    }
+    // The slow collectors follow the fast ones in the table, so hashing order is unchanged
+    if (parallel) {
+        collect_slow_finish(&batch, &sink);
+        return 1;
+    }
+    for (int src = RNG_SRC_DISK; src < RNG_SRC_COUNT; src++) {
+        if (enabled[src]) run_collector((RNG_SOURCE)src, &sink, cfg, gs);
+    }
     return 1;
 }
 
@@ -455,56 +1414,42 @@ static int collect_entropy_configurable(unsigned char *buffer, const int size, c
                                         const RNG_HASH_ALGO algo, const RNG_MIX_MODE mixing,
                                         const RNG_CONFIG *cfg)
 {
-    BCRYPT_ALG_HANDLE hAlg = NULL;
     BCRYPT_HASH_HANDLE hHash = NULL;
-    DWORD cbHash = 0, cbData = 0;
-    const DWORD H = algo_digest_len(algo);
+    const DWORD cbHash = algo_digest_len(algo);
     unsigned char digest[64];
+    NTSTATUS status = 0;
 
-    NTSTATUS status = BCryptOpenAlgorithmProvider(&hAlg, algo_name_from_enum(algo), NULL, 0);
-    if (!BCRYPT_SUCCESS(status)) return 0;
+    RNG_GATHER_STATE gs;
+    memset(&gs, 0, sizeof(gs));
 
-    status = BCryptGetProperty(hAlg, BCRYPT_HASH_LENGTH, (PUCHAR)&cbHash, sizeof(cbHash), &cbData, 0);
-    if (!BCRYPT_SUCCESS(status) || cbHash != H) { BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
+    // A single reusable hash object serves every round and every expansion block
+    if (!hash_create(algo, 0, NULL, 0, &hHash)) return 0;
 
     if (mixing == RNG_MIX_CONTINUOUS) {
         // One long-running hash
-        status = BCryptCreateHash(hAlg, &hHash, NULL, 0, NULL, 0, 0);
-        if (!BCRYPT_SUCCESS(status)) { BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
-
         for (int i = 0; i < rounds; i++) {
-            hash_update_entropy_from_sources(hHash, cfg);
+            gs.round = i;
+            hash_update_entropy_from_sources(hHash, cfg, &gs);
         }
         status = BCryptFinishHash(hHash, digest, cbHash, 0);
-        BCryptDestroyHash(hHash);
-        if (!BCRYPT_SUCCESS(status)) { BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
     } else {
         // Round-based finalize then feed digest into next round
-        status = BCryptCreateHash(hAlg, &hHash, NULL, 0, NULL, 0, 0);
-        if (!BCRYPT_SUCCESS(status)) { BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
-
-        for (int round = 0; round < rounds; round++) {
-            hash_update_entropy_from_sources(hHash, cfg);
-            status = BCryptFinishHash(hHash, digest, cbHash, 0);
-            if (!BCRYPT_SUCCESS(status)) {
-                BCryptDestroyHash(hHash);
-                BCryptCloseAlgorithmProvider(hAlg, 0);
-                return 0;
-            }
-            if (round + 1 < rounds) {
-                BCryptDestroyHash(hHash);
-                status = BCryptCreateHash(hAlg, &hHash, NULL, 0, NULL, 0, 0);
-                if (!BCRYPT_SUCCESS(status)) { BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
+        for (int round = 0; round < rounds && BCRYPT_SUCCESS(status); round++) {
+            if (round > 0) {
                 // feed prior digest to new round
-                const NTSTATUS s2 = BCryptHashData(hHash, digest, cbHash, 0);
-                if (!BCRYPT_SUCCESS(s2)) {
-                    BCryptDestroyHash(hHash);
-                    BCryptCloseAlgorithmProvider(hAlg, 0);
-                    return 0;
-                }
+                status = BCryptHashData(hHash, digest, cbHash, 0);
+                if (!BCRYPT_SUCCESS(status)) break;
             }
+            gs.round = round;
+            hash_update_entropy_from_sources(hHash, cfg, &gs);
+            status = BCryptFinishHash(hHash, digest, cbHash, 0);
         }
     }
+    if (!BCRYPT_SUCCESS(status)) {
+        BCryptDestroyHash(hHash);
+        SecureZeroMemory(digest, sizeof(digest));
+        return 0;
+    }
 
     // Now expand to requested size using counter chaining
     DWORD bytesRemaining = (DWORD)size;
@@ -515,32 +1460,25 @@ static int collect_entropy_configurable(unsigned char *buffer, const int size, c
     bytesRemaining -= bytesToCopy;
     offset += bytesToCopy;
 
-    if (bytesRemaining > 0) {
-        uint32_t counter = 1;
-        while (bytesRemaining > 0) {
-            BCRYPT_HASH_HANDLE hH = NULL;
-            status = BCryptCreateHash(hAlg, &hH, NULL, 0, NULL, 0, 0);
-            if (!BCRYPT_SUCCESS(status)) { BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
-
-            status = BCryptHashData(hH, digest, cbHash, 0);
-            if (!BCRYPT_SUCCESS(status)) { BCryptDestroyHash(hH); BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
-
-            status = BCryptHashData(hH, (PUCHAR)&counter, sizeof(counter), 0);
-            if (!BCRYPT_SUCCESS(status)) { BCryptDestroyHash(hH); BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
-
-            status = BCryptFinishHash(hH, digest, cbHash, 0);
-            BCryptDestroyHash(hH);
-            if (!BCRYPT_SUCCESS(status)) { BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
-
-            bytesToCopy = (bytesRemaining < cbHash) ? bytesRemaining : cbHash;
-            memcpy(buffer + offset, digest, bytesToCopy);
-            bytesRemaining -= bytesToCopy;
-            offset += bytesToCopy;
-            counter++;
+    uint32_t counter = 1;
+    while (bytesRemaining > 0) {
+        status = BCryptHashData(hHash, digest, cbHash, 0);
+        if (BCRYPT_SUCCESS(status)) status = BCryptHashData(hHash, (PUCHAR)&counter, sizeof(counter), 0);
+        if (BCRYPT_SUCCESS(status)) status = BCryptFinishHash(hHash, digest, cbHash, 0);
+        if (!BCRYPT_SUCCESS(status)) {
+            BCryptDestroyHash(hHash);
+            SecureZeroMemory(digest, sizeof(digest));
+            return 0;
         }
+
+        bytesToCopy = (bytesRemaining < cbHash) ? bytesRemaining : cbHash;
+        memcpy(buffer + offset, digest, bytesToCopy);
+        bytesRemaining -= bytesToCopy;
+        offset += bytesToCopy;
+        counter++;
     }
 
-    BCryptCloseAlgorithmProvider(hAlg, 0);
+    BCryptDestroyHash(hHash);
     SecureZeroMemory(digest, sizeof(digest));
     return 1;
 }
@@ -580,6 +1518,27 @@ static void apply_security_preset(RNG_CONFIG *cfg) {
     }
 }
 
+// Shared validation for caller-provided configs: default toggles, preset, clamped complexity
+static void normalize_config(RNG_CONFIG *cfg) {
+    // Reasonable defaults if caller forgot toggles
+    if (!(cfg->use_cpu | cfg->use_memory | cfg->use_perf | cfg->use_disk |
+          cfg->use_audio | cfg->use_battery | cfg->use_network | cfg->use_rdrand))
+    {
+        cfg->use_cpu = cfg->use_memory = cfg->use_perf = 1;
+        cfg->use_disk = cfg->use_audio = cfg->use_battery = cfg->use_network = 1;
+        cfg->use_rdrand = 1;
+    }
+
+    // Apply security preset
+    apply_security_preset(cfg);
+
+    // Clamp complexity
+    if (cfg->complexity < 1) cfg->complexity = 1;
+    if (cfg->complexity > 10) cfg->complexity = 10;
+}
+
+__declspec(dllexport) void maxrng_dev_default_config(RNG_CONFIG *cfg, RNG_SECURITY_MODE mode);
+
 static int ensure_threading_enter(const RNG_CONFIG *cfg) {
     if (cfg->threading == RNG_THREAD_CRITSEC) {
         EnterCriticalSection(&g_rngLock);
@@ -597,6 +1556,101 @@ static void ensure_threading_leave(const RNG_CONFIG *cfg) {
     }
 }
 
+// AES-256-CTR keystream. BCrypt has no CTR chaining mode, so counter blocks are laid
+// out in the output buffer and encrypted in place with ECB (AES-NI backed when present).
+#define RNG_AESCTR_CHUNK 65536
+
+static int aes_ctr_expand(const RNG_CONFIG *cfg,
+                          const unsigned char *ikm, const int ikm_len,
+                          unsigned char *out, const int out_len)
+{
+    static const unsigned char default_info[] = "hRng AES-CTR";
+    const RNG_HASH_ALGO algo = cfg->hash_algo;
+    const DWORD H = algo_digest_len(algo);
+    unsigned char prk[64];
+    unsigned char km[48]; // key(32) || initial counter block(16)
+
+    // ReSharper disable once CppLocalVariableMayBeConst
+    BCRYPT_ALG_HANDLE hAes = get_aes_provider();
+    if (!hAes) return 0;
+
+    if (!hkdf_extract(algo, cfg->seed, cfg->seed_len, ikm, ikm_len, prk, H)) return 0;
+    const unsigned char *info = (cfg->info && cfg->info_len > 0) ? cfg->info : default_info;
+    const int info_len = (cfg->info && cfg->info_len > 0) ? cfg->info_len : (int)sizeof(default_info) - 1;
+    const int derived = hkdf_expand(algo, prk, (int)H, info, info_len, km, (int)sizeof(km));
+    SecureZeroMemory(prk, sizeof(prk));
+    if (!derived) return 0;
+
+    BCRYPT_KEY_HANDLE hKey = NULL;
+    NTSTATUS s = BCryptGenerateSymmetricKey(hAes, &hKey, NULL, 0, km, 32, 0);
+    if (!BCRYPT_SUCCESS(s)) {
+        SecureZeroMemory(km, sizeof(km));
+        return 0;
+    }
+
+    // Counter block = high 8 bytes of the derived block || (low 8 bytes + i), big-endian
+    uint64_t ctr = 0;
+    for (int b = 0; b < 8; b++) ctr = (ctr << 8) | km[40 + b];
+
+    int pos = 0;
+    ULONG cb = 0;
+    while (BCRYPT_SUCCESS(s) && pos < out_len) {
+        const int remaining = out_len - pos;
+        unsigned char tail[16];
+        unsigned char *dst;
+        int n, nblocks;
+        if (remaining >= 16) {
+            n = ((remaining < RNG_AESCTR_CHUNK) ? remaining : RNG_AESCTR_CHUNK) & ~15;
+            nblocks = n / 16;
+            dst = out + pos;
+        } else {
+            // Final partial block goes through a scratch block
+            n = remaining;
+            nblocks = 1;
+            dst = tail;
+        }
+
+        for (int i = 0; i < nblocks; i++, ctr++) {
+            unsigned char *blk = dst + i * 16;
+            memcpy(blk, km + 32, 8);
+            for (int b = 0; b < 8; b++) blk[8 + b] = (unsigned char)(ctr >> (56 - 8 * b));
+        }
+        s = BCryptEncrypt(hKey, dst, (ULONG)(nblocks * 16), NULL, NULL, 0, dst, (ULONG)(nblocks * 16), &cb, 0);
+        if (dst == tail) {
+            if (BCRYPT_SUCCESS(s)) memcpy(out + pos, tail, (size_t)n);
+            SecureZeroMemory(tail, sizeof(tail));
+        }
+        pos += n;
+    }
+
+    BCryptDestroyKey(hKey);
+    SecureZeroMemory(km, sizeof(km));
+    if (!BCRYPT_SUCCESS(s)) {
+        SecureZeroMemory(out, (size_t)out_len);
+        return 0;
+    }
+    return 1;
+}
+
+// Hardware words: RDSEED where the CPU supports it, RDRAND for any word RDSEED cannot deliver
+static int hw_rng_expand(unsigned char *out, const int out_len) {
+    if (!rdrand_supported()) return 0;
+    const int use_seed = rdseed_supported();
+
+    int pos = 0;
+    while (pos < out_len) {
+        uint64_t w = 0;
+        if (!(use_seed && rdseed64_try(&w)) && !rdrand64_retry(&w)) {
+            SecureZeroMemory(out, (size_t)out_len);
+            return 0;
+        }
+        const int to_copy = (out_len - pos < 8) ? (out_len - pos) : 8;
+        memcpy(out + pos, &w, (size_t)to_copy);
+        pos += to_copy;
+    }
+    return 1;
+}
+
 // Core expand dispatcher
 static int expand_output(const RNG_CONFIG *cfg,
                          const unsigned char *ikm, const int ikm_len,
@@ -612,47 +1666,38 @@ static int expand_output(const RNG_CONFIG *cfg,
         case RNG_EXP_COUNTER: {
             // Use counter chaining starting from IKM digest blocks
             // Implement using H = hash_len blocks: hash(ikm || counter)
-            BCRYPT_ALG_HANDLE hAlg = NULL;
-            BCRYPT_HASH_HANDLE hH = NULL;
-            DWORD cbHash = 0, cbData = 0;
+            // The ikm || seed prefix is hashed once and duplicated for every block
+            BCRYPT_HASH_HANDLE hBase = NULL;
             unsigned char block[64];
             uint32_t ctr = 1;
             int pos = 0;
 
-            NTSTATUS s = BCryptOpenAlgorithmProvider(&hAlg, algo_name_from_enum(algo), NULL, 0);
-            if (!BCRYPT_SUCCESS(s)) return 0;
+            if (!hash_create(algo, 0, NULL, 0, &hBase)) return 0;
 
-            s = BCryptGetProperty(hAlg, BCRYPT_HASH_LENGTH, (PUCHAR)&cbHash, sizeof(cbHash), &cbData, 0);
-            if (!BCRYPT_SUCCESS(s) || cbHash != H) { BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
-
-            while (pos < out_len) {
-                s = BCryptCreateHash(hAlg, &hH, NULL, 0, NULL, 0, 0);
-                if (!BCRYPT_SUCCESS(s)) { BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
+            NTSTATUS s = BCryptHashData(hBase, (PUCHAR)ikm, ikm_len, 0);
+            if (BCRYPT_SUCCESS(s) && cfg->seed && cfg->seed_len > 0) {
+                // fold seed for domain separation
+                s = BCryptHashData(hBase, (PUCHAR)cfg->seed, cfg->seed_len, 0);
+            }
 
-                s = BCryptHashData(hH, (PUCHAR)ikm, ikm_len, 0);
-                if (!BCRYPT_SUCCESS(s)) { BCryptDestroyHash(hH); BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
-
-                if (cfg->seed && cfg->seed_len > 0) {
-                    // fold seed for domain separation
-                    s = BCryptHashData(hH, (PUCHAR)cfg->seed, cfg->seed_len, 0);
-                    if (!BCRYPT_SUCCESS(s)) { BCryptDestroyHash(hH); BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
-                }
+            while (BCRYPT_SUCCESS(s) && pos < out_len) {
+                BCRYPT_HASH_HANDLE hH = NULL;
+                s = BCryptDuplicateHash(hBase, &hH, NULL, 0, 0);
+                if (!BCRYPT_SUCCESS(s)) break;
 
                 s = BCryptHashData(hH, (PUCHAR)&ctr, sizeof(ctr), 0);
-                if (!BCRYPT_SUCCESS(s)) { BCryptDestroyHash(hH); BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
-
-                s = BCryptFinishHash(hH, block, H, 0);
+                if (BCRYPT_SUCCESS(s)) s = BCryptFinishHash(hH, block, H, 0);
                 BCryptDestroyHash(hH);
-                if (!BCRYPT_SUCCESS(s)) { BCryptCloseAlgorithmProvider(hAlg, 0); return 0; }
+                if (!BCRYPT_SUCCESS(s)) break;
 
                 const int to_copy = (out_len - pos < (int)H) ? (out_len - pos) : (int)H;
                 memcpy(out_raw + pos, block, to_copy);
                 pos += to_copy;
                 ctr++;
             }
-            BCryptCloseAlgorithmProvider(hAlg, 0);
+            BCryptDestroyHash(hBase);
             SecureZeroMemory(block, sizeof(block));
-            return 1;
+            return BCRYPT_SUCCESS(s) ? 1 : 0;
         }
         case RNG_EXP_HKDF: {
             unsigned char prk[64];
@@ -684,11 +1729,525 @@ static int expand_output(const RNG_CONFIG *cfg,
             SecureZeroMemory(prk, sizeof(prk));
             return ok;
         }
+        case RNG_EXP_AESCTR:
+            return aes_ctr_expand(cfg, ikm, ikm_len, out_raw, out_len);
+        case RNG_EXP_RDSEED:
+            return hw_rng_expand(out_raw, out_len);
         default:
             return 0;
     }
 }
 
+// ============================================================
+// Seeded HMAC-DRBG with reseed policy
+// ============================================================
+// Entropy is collected once at instantiate and again only when the byte or time
+// budget runs out, so generate calls cost a handful of HMACs instead of a full gather.
+#define RNG_DRBG_DEFAULT_RESEED_BYTES (1ULL << 20)  // 1 MiB
+#define RNG_DRBG_DEFAULT_RESEED_MS    60000         // 1 minute
+#define RNG_DRBG_MAX_REQUEST          65536         // bytes per HMAC-DRBG generate step
+
+typedef struct RNG_DRBG RNG_DRBG;
+
+struct RNG_DRBG {
+    RNG_CONFIG cfg;               // entropy config used for reseeding (seed/info pointers cleared)
+    RNG_DRBG *parent;             // per-thread instances reseed from the shared master, not the collectors
+    unsigned char K[64];
+    unsigned char V[64];
+    DWORD H;
+    ULONGLONG reseed_bytes;       // reseed once this many bytes were produced
+    DWORD reseed_ms;              // reseed once this much time has passed
+    ULONGLONG bytes_since_reseed;
+    ULONGLONG last_reseed_tick;
+    ULONGLONG reseed_count;
+    SRWLOCK lock;                 // serializes a master's per-thread children (zero = SRWLOCK_INIT)
+};
+
+// Guards the g_tlsMasters table; each master has its own lock for drawing
+static SRWLOCK g_tlsMasterLock = SRWLOCK_INIT;
+
+// HMAC-DRBG Update: provided_data = p1 || p2 (either part may be empty)
+static int drbg_update(RNG_DRBG *d,
+                       const unsigned char *p1, const int l1,
+                       const unsigned char *p2, const int l2)
+{
+    const RNG_HASH_ALGO algo = d->cfg.hash_algo;
+    const int provided = (p1 && l1 > 0) || (p2 && l2 > 0);
+
+    for (unsigned char step = 0; step < (provided ? 2 : 1); step++) {
+        // K = HMAC(K, V || step || provided_data)
+        BCRYPT_HASH_HANDLE hHash = NULL;
+        if (!hash_create(algo, 1, d->K, (int)d->H, &hHash)) return 0;
+
+        NTSTATUS s = BCryptHashData(hHash, d->V, d->H, 0);
+        if (BCRYPT_SUCCESS(s)) s = BCryptHashData(hHash, &step, 1, 0);
+        if (BCRYPT_SUCCESS(s) && p1 && l1 > 0) s = BCryptHashData(hHash, (PUCHAR)p1, l1, 0);
+        if (BCRYPT_SUCCESS(s) && p2 && l2 > 0) s = BCryptHashData(hHash, (PUCHAR)p2, l2, 0);
+        if (BCRYPT_SUCCESS(s)) s = BCryptFinishHash(hHash, d->K, d->H, 0);
+        BCryptDestroyHash(hHash);
+        if (!BCRYPT_SUCCESS(s)) return 0;
+
+        // V = HMAC(K, V)
+        if (!hmac_once(algo, d->K, (int)d->H, d->V, (int)d->H, d->V, d->H)) return 0;
+    }
+    return 1;
+}
+
+static int drbg_generate_internal(RNG_DRBG *d, unsigned char *out, int len);
+
+static int drbg_needs_reseed(const RNG_DRBG *d) {
+    if (d->bytes_since_reseed >= d->reseed_bytes) return 1;
+    return GetTickCount64() - d->last_reseed_tick >= d->reseed_ms;
+}
+
+// Full collector pass for an instance without a parent
+static int drbg_collect(const RNG_DRBG *d, unsigned char *entropy) {
+    return collect_entropy_configurable(entropy, (int)d->H, d->cfg.complexity,
+                                        d->cfg.hash_algo, d->cfg.mixing, &d->cfg);
+}
+
+// Mixes fresh entropy (and optional additional input) into the state and restarts the budget
+static int drbg_absorb(RNG_DRBG *d, const unsigned char *entropy,
+                       const unsigned char *additional, const int add_len) {
+    if (!drbg_update(d, entropy, (int)d->H, additional, add_len)) return 0;
+    d->bytes_since_reseed = 0;
+    d->last_reseed_tick = GetTickCount64();
+    d->reseed_count++;
+    return 1;
+}
+
+// Fresh material for a per-thread instance: parent output drawn under the parent's lock
+// (a few HMACs). When the parent itself is due, its collector pass runs with the lock
+// released and only the absorb and the draw are serialized.
+static int drbg_draw_from_parent(RNG_DRBG *d, unsigned char *entropy) {
+    RNG_DRBG *m = d->parent;
+    unsigned char seed[64];
+    int seeded = 0, ok = 0;
+    for (;;) {
+        AcquireSRWLockExclusive(&m->lock);
+        // Another child may have reseeded meanwhile; absorbing more entropy is harmless
+        if (seeded && !drbg_absorb(m, seed, NULL, 0)) break;
+        seeded = 0;
+        if (!drbg_needs_reseed(m)) {
+            ok = drbg_generate_internal(m, entropy, (int)d->H);
+            break;
+        }
+        ReleaseSRWLockExclusive(&m->lock);
+        // Reads only cfg and H, which never change after drbg_new
+        if (!drbg_collect(m, seed)) {
+            SecureZeroMemory(seed, sizeof(seed));
+            return 0;
+        }
+        seeded = 1;
+    }
+    ReleaseSRWLockExclusive(&m->lock);
+    SecureZeroMemory(seed, sizeof(seed));
+    return ok;
+}
+
+static int drbg_reseed_internal(RNG_DRBG *d, const unsigned char *additional, const int add_len) {
+    unsigned char entropy[64];
+    if (d->parent) {
+        if (!drbg_draw_from_parent(d, entropy)) return 0;
+    } else if (!drbg_collect(d, entropy)) {
+        return 0;
+    }
+
+    const int ok = drbg_absorb(d, entropy, additional, add_len);
+    SecureZeroMemory(entropy, sizeof(entropy));
+    return ok;
+}
+
+static int drbg_generate_internal(RNG_DRBG *d, unsigned char *out, const int len) {
+    int pos = 0;
+    while (pos < len) {
+        if (drbg_needs_reseed(d) && !drbg_reseed_internal(d, NULL, 0)) return 0;
+
+        const int chunk = (len - pos < RNG_DRBG_MAX_REQUEST) ? (len - pos) : RNG_DRBG_MAX_REQUEST;
+        BCRYPT_HASH_HANDLE hHash = NULL;
+        if (!hash_create(d->cfg.hash_algo, 1, d->K, (int)d->H, &hHash)) return 0;
+
+        // V = HMAC(K, V) per block, keyed object reused across the whole chunk
+        int done = 0;
+        NTSTATUS s = 0;
+        while (done < chunk) {
+            s = BCryptHashData(hHash, d->V, d->H, 0);
+            if (BCRYPT_SUCCESS(s)) s = BCryptFinishHash(hHash, d->V, d->H, 0);
+            if (!BCRYPT_SUCCESS(s)) break;
+
+            const int to_copy = (chunk - done < (int)d->H) ? (chunk - done) : (int)d->H;
+            memcpy(out + pos + done, d->V, to_copy);
+            done += to_copy;
+        }
+        BCryptDestroyHash(hHash);
+        if (!BCRYPT_SUCCESS(s)) return 0;
+
+        // Backtracking resistance: refresh K and V after every request
+        if (!drbg_update(d, NULL, 0, NULL, 0)) return 0;
+
+        pos += chunk;
+        d->bytes_since_reseed += (ULONGLONG)chunk;
+    }
+    return 1;
+}
+
+static RNG_DRBG *drbg_new(const RNG_CONFIG *cfg_in, RNG_DRBG *parent,
+                          const unsigned long long reseed_bytes, const unsigned int reseed_ms) {
+    RNG_DRBG *d = (RNG_DRBG*)calloc(1, sizeof(RNG_DRBG));
+    if (!d) return NULL;
+
+    d->parent = parent;
+    if (parent) {
+        d->cfg = parent->cfg;
+    } else if (cfg_in) {
+        d->cfg = *cfg_in;
+        normalize_config(&d->cfg);
+    } else {
+        maxrng_dev_default_config(&d->cfg, RNG_MODE_BALANCED);
+    }
+    d->H = algo_digest_len(d->cfg.hash_algo);
+    d->reseed_bytes = reseed_bytes ? reseed_bytes : RNG_DRBG_DEFAULT_RESEED_BYTES;
+    d->reseed_ms = reseed_ms ? reseed_ms : RNG_DRBG_DEFAULT_RESEED_MS;
+
+    // Instantiate: K = 0x00.., V = 0x01.., Update(entropy || personalization = seed)
+    memset(d->K, 0x00, sizeof(d->K));
+    memset(d->V, 0x01, sizeof(d->V));
+    int ok;
+    if (parent) {
+        // Personalize per-thread instances so two threads never share a state
+        struct { DWORD tid; LARGE_INTEGER qpc; uint64_t tsc; } pers;
+        pers.tid = GetCurrentThreadId();
+        QueryPerformanceCounter(&pers.qpc);
+        pers.tsc = __rdtsc();
+        ok = drbg_reseed_internal(d, (const unsigned char*)&pers, (int)sizeof(pers));
+    } else {
+        ok = drbg_reseed_internal(d, d->cfg.seed, d->cfg.seed ? d->cfg.seed_len : 0);
+    }
+
+    // The caller owns seed/info; never keep pointers to them
+    d->cfg.seed = NULL;
+    d->cfg.seed_len = 0;
+    d->cfg.info = NULL;
+    d->cfg.info_len = 0;
+
+    if (!ok) {
+        SecureZeroMemory(d, sizeof(*d));
+        free(d);
+        return NULL;
+    }
+    return d;
+}
+
+static void drbg_free(RNG_DRBG *d) {
+    if (!d) return;
+    SecureZeroMemory(d, sizeof(*d));
+    free(d);
+}
+
+// ============================================================
+// Thread-local generators (RNG_THREAD_TLS)
+// ============================================================
+// Master DRBGs are seeded from the collectors, one per distinct seeding config (sources,
+// security mode, complexity, mixing, hash): callers only ever share a master with callers
+// that asked for the same seeding, so a FAST config never feeds a SECURE one. Every thread
+// derives its own DRBG from the matching master under that master's lock and then generates
+// lock-free.
+#define RNG_TLS_MAX_MASTERS 16
+
+// The RNG_CONFIG fields that decide how a master is seeded
+typedef struct {
+    int use_cpu, use_rdrand, use_memory, use_perf;
+    int use_disk, use_audio, use_battery, use_network;
+    RNG_HASH_ALGO hash_algo;
+    RNG_MIX_MODE mixing;
+    RNG_SECURITY_MODE sec_mode;
+    int complexity;
+    unsigned int collector_budget_us;
+} RNG_TLS_KEY;
+
+typedef struct {
+    RNG_TLS_KEY key;
+    RNG_DRBG *drbg;
+} RNG_TLS_MASTER;
+
+typedef struct {
+    RNG_DRBG *drbg[RNG_TLS_MAX_MASTERS];  // indexed like g_tlsMasters
+    RNG_TLS_KEY key[RNG_TLS_MAX_MASTERS];
+    LONG generation;
+} RNG_TLS_STATE;
+
+// Filled front to back and only emptied as a whole by release_tls_masters()
+static RNG_TLS_MASTER *volatile g_tlsMasters[RNG_TLS_MAX_MASTERS];
+static volatile LONG g_tlsGeneration = 0;
+static DWORD g_tlsSlot = FLS_OUT_OF_INDEXES;
+static INIT_ONCE g_tlsSlotOnce = INIT_ONCE_STATIC_INIT;
+
+static void tls_state_clear(RNG_TLS_STATE *st) {
+    for (int i = 0; i < RNG_TLS_MAX_MASTERS; i++) {
+        drbg_free(st->drbg[i]);
+        st->drbg[i] = NULL;
+    }
+}
+
+// Runs on thread exit (and FlsFree) to wipe the exiting thread's generators
+static VOID NTAPI tls_state_release(const PVOID data) {
+    RNG_TLS_STATE *st = (RNG_TLS_STATE*)data;
+    if (!st) return;
+    tls_state_clear(st);
+    free(st);
+}
+
+// ReSharper disable CppParameterMayBeConst
+static BOOL CALLBACK tls_slot_init(PINIT_ONCE once, PVOID param, PVOID *ctx) {
+    g_tlsSlot = FlsAlloc(tls_state_release);
+    return g_tlsSlot != FLS_OUT_OF_INDEXES;
+}
+// ReSharper restore CppParameterMayBeConst
+
+static void tls_key_from_config(RNG_TLS_KEY *key, const RNG_CONFIG *cfg) {
+    memset(key, 0, sizeof(*key));
+    key->use_cpu = cfg->use_cpu;
+    key->use_rdrand = cfg->use_rdrand;
+    key->use_memory = cfg->use_memory;
+    key->use_perf = cfg->use_perf;
+    key->use_disk = cfg->use_disk;
+    key->use_audio = cfg->use_audio;
+    key->use_battery = cfg->use_battery;
+    key->use_network = cfg->use_network;
+    key->hash_algo = cfg->hash_algo;
+    key->mixing = cfg->mixing;
+    key->sec_mode = cfg->sec_mode;
+    key->complexity = cfg->complexity;
+    key->collector_budget_us = cfg->collector_budget_us;
+}
+
+// Returns the slot of the master seeded for key, creating it on first use (-1 on failure
+// or when all RNG_TLS_MAX_MASTERS slots hold other configs). Seeding runs outside
+// g_tlsMasterLock so looking up other masters never waits on a collector pass; the new
+// master is published with a compare-exchange and dropped if another thread published one
+// first.
+static int tls_master_get(const RNG_CONFIG *cfg, const RNG_TLS_KEY *key) {
+    int slot = -1;
+    AcquireSRWLockShared(&g_tlsMasterLock);
+    for (int i = 0; i < RNG_TLS_MAX_MASTERS && g_tlsMasters[i]; i++) {
+        if (memcmp(&g_tlsMasters[i]->key, key, sizeof(*key)) == 0) {
+            slot = i;
+            break;
+        }
+    }
+    ReleaseSRWLockShared(&g_tlsMasterLock);
+    if (slot >= 0) return slot;
+
+    // First use of this config: the only step that waits on the collectors
+    RNG_TLS_MASTER *fresh = (RNG_TLS_MASTER*)calloc(1, sizeof(RNG_TLS_MASTER));
+    if (!fresh) return -1;
+    fresh->key = *key;
+    fresh->drbg = drbg_new(cfg, NULL, 0, 0);
+    if (!fresh->drbg) {
+        free(fresh);
+        return -1;
+    }
+
+    // Shared is enough: slots only go from NULL to published here, release takes it exclusive
+    AcquireSRWLockShared(&g_tlsMasterLock);
+    for (int i = 0; i < RNG_TLS_MAX_MASTERS; i++) {
+        RNG_TLS_MASTER *m = (RNG_TLS_MASTER*)InterlockedCompareExchangePointer(
+            (PVOID volatile*)&g_tlsMasters[i], fresh, NULL);
+        if (!m) {
+            slot = i;
+            fresh = NULL;
+            break;
+        }
+        if (memcmp(&m->key, key, sizeof(*key)) == 0) {
+            slot = i;
+            break;
+        }
+    }
+    ReleaseSRWLockShared(&g_tlsMasterLock);
+
+    if (fresh) {
+        drbg_free(fresh->drbg);
+        free(fresh);
+    }
+    return slot;
+}
+
+static int tls_generate(const RNG_CONFIG *cfg, unsigned char *out, const int len) {
+    if (!InitOnceExecuteOnce(&g_tlsSlotOnce, tls_slot_init, NULL, NULL)) return 0;
+
+    RNG_TLS_STATE *st = (RNG_TLS_STATE*)FlsGetValue(g_tlsSlot);
+    if (!st) {
+        st = (RNG_TLS_STATE*)calloc(1, sizeof(RNG_TLS_STATE));
+        if (!st) return 0;
+        st->generation = g_tlsGeneration;
+        if (!FlsSetValue(g_tlsSlot, st)) {
+            free(st);
+            return 0;
+        }
+    }
+
+    // maxrng_shutdown() released the masters: drop instances that still point at them
+    const LONG gen = InterlockedCompareExchange(&g_tlsGeneration, 0, 0);
+    if (st->generation != gen) {
+        tls_state_clear(st);
+        st->generation = gen;
+    }
+
+    RNG_TLS_KEY key;
+    tls_key_from_config(&key, cfg);
+    for (int i = 0; i < RNG_TLS_MAX_MASTERS; i++) {
+        if (st->drbg[i] && memcmp(&st->key[i], &key, sizeof(key)) == 0) {
+            return drbg_generate_internal(st->drbg[i], out, len);
+        }
+    }
+
+    const int slot = tls_master_get(cfg, &key);
+    if (slot < 0) return 0;
+    st->drbg[slot] = drbg_new(NULL, g_tlsMasters[slot]->drbg, 0, 0);
+    if (!st->drbg[slot]) return 0;
+    st->key[slot] = key;
+    return drbg_generate_internal(st->drbg[slot], out, len);
+}
+
+static void release_tls_masters(void) {
+    AcquireSRWLockExclusive(&g_tlsMasterLock);
+    for (int i = 0; i < RNG_TLS_MAX_MASTERS; i++) {
+        if (!g_tlsMasters[i]) continue;
+        drbg_free(g_tlsMasters[i]->drbg);
+        free(g_tlsMasters[i]);
+        g_tlsMasters[i] = NULL;
+    }
+    InterlockedIncrement(&g_tlsGeneration);
+    ReleaseSRWLockExclusive(&g_tlsMasterLock);
+}
+
+// Produces raw_len bytes for an already normalized config; the caller handles locking.
+// RNG_THREAD_TLS draws from the calling thread's DRBG (expansion and seed do not apply).
+static int generate_raw(const RNG_CONFIG *cfg, unsigned char *raw, const int raw_len) {
+    if (cfg->threading == RNG_THREAD_TLS) return tls_generate(cfg, raw, raw_len);
+    // Hardware output does not use collected entropy, so skip the gather entirely
+    if (cfg->expansion == RNG_EXP_RDSEED) return hw_rng_expand(raw, raw_len);
+
+    // 1) Gather entropy into intermediate digest material using selected mixing
+    // Use collect_entropy_configurable to produce a base digest of size raw_len at least as input keying material
+    // For better domain separation, derive ikm_len = max(H, min(raw_len, 2*H))
+    const DWORD H = algo_digest_len(cfg->hash_algo);
+    const int ikm_len = (raw_len < (int)H) ? (int)H : ((raw_len > (int)(H * 2)) ? (int)(H * 2) : raw_len);
+
+    unsigned char *ikm = (unsigned char*)malloc((size_t)ikm_len);
+    if (!ikm) return 0;
+    if (!collect_entropy_configurable(ikm, ikm_len, cfg->complexity, cfg->hash_algo, cfg->mixing, cfg)) {
+        free(ikm);
+        return 0;
+    }
+
+    // Seed injection for non HMAC/HKDF modes: fold by XOR to avoid bias
+    if ((cfg->expansion == RNG_EXP_COUNTER || cfg->expansion == RNG_EXP_XOF) && cfg->seed && cfg->seed_len > 0) {
+        const int m = (cfg->seed_len < ikm_len) ? cfg->seed_len : ikm_len;
+        for (int i = 0; i < m; i++) ikm[i] ^= cfg->seed[i];
+    }
+
+    // 2) Expand according to selected strategy into raw
+    const int ok = expand_output(cfg, ikm, ikm_len, raw, raw_len);
+
+    // Wipe ikm and release
+    SecureZeroMemory(ikm, (size_t)ikm_len);
+    free(ikm);
+    return ok;
+}
+// ============================================================
+// Sampling kernels over the thread-local DRBG stream
+// ============================================================
+// The kernels always draw from the BALANCED thread-local DRBG, whatever security mode
+// the caller uses elsewhere.
+#define RNG_STREAM_SLACK 64  // extra bytes per refill to absorb rejection-sampling retries
+
+typedef struct {
+    unsigned char buf[4096];
+    int pos;
+    int len;
+    long long expect;  // bytes the caller still expects to draw, sizes the next refill
+    RNG_CONFIG cfg;
+} RNG_WORD_STREAM;
+
+static void stream_init(RNG_WORD_STREAM *st, const long long expect) {
+    maxrng_dev_default_config(&st->cfg, RNG_MODE_BALANCED);
+    st->cfg.threading = RNG_THREAD_TLS;
+    st->pos = st->len = 0;
+    st->expect = expect;
+}
+
+static int stream_next(RNG_WORD_STREAM *st, void *out, const int n) {
+    if (st->pos + n > st->len) {
+        // Generate only what the call still needs, so small draws do not pay for a full block;
+        // once rejections run past the estimate, grow the refills geometrically
+        long long want = st->expect ? st->expect + RNG_STREAM_SLACK : 2LL * st->len;
+        if (want < RNG_STREAM_SLACK) want = RNG_STREAM_SLACK;
+        if (want < n) want = n;
+        if (want > (long long)sizeof(st->buf)) want = (long long)sizeof(st->buf);
+        if (!tls_generate(&st->cfg, st->buf, (int)want)) return 0;
+        st->pos = 0;
+        st->len = (int)want;
+    }
+    memcpy(out, st->buf + st->pos, (size_t)n);
+    st->pos += n;
+    st->expect = (st->expect > n) ? st->expect - n : 0;
+    return 1;
+}
+
+static void stream_wipe(RNG_WORD_STREAM *st) {
+    SecureZeroMemory(st->buf, sizeof(st->buf));
+}
+
+// Full 64x64 -> 128-bit product, returns the low half
+static uint64_t mul_64x64_128(const uint64_t a, const uint64_t b, uint64_t *hi) {
+#if defined(_M_X64)
+    return _umul128(a, b, hi);
+#else
+    const uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    const uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+    const uint64_t p0 = a_lo * b_lo;
+    const uint64_t p1 = a_lo * b_hi;
+    const uint64_t p2 = a_hi * b_lo;
+    const uint64_t p3 = a_hi * b_hi;
+    const uint64_t mid = (p0 >> 32) + (uint32_t)p1 + (uint32_t)p2;
+    *hi = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+    return (mid << 32) | (uint32_t)p0;
+#endif
+}
+
+// Unbiased value in [0, s) for s > 0 (Lemire's multiply-and-reject)
+static int uniform_below_u64(RNG_WORD_STREAM *st, const uint64_t s, uint64_t *out) {
+    uint64_t x, hi;
+    if (!stream_next(st, &x, sizeof(x))) return 0;
+    uint64_t lo = mul_64x64_128(x, s, &hi);
+    if (lo < s) {
+        const uint64_t threshold = (0 - s) % s;
+        while (lo < threshold) {
+            if (!stream_next(st, &x, sizeof(x))) return 0;
+            lo = mul_64x64_128(x, s, &hi);
+        }
+    }
+    *out = hi;
+    return 1;
+}
+
+static int uniform_below_u32(RNG_WORD_STREAM *st, const uint32_t s, uint32_t *out) {
+    uint32_t x;
+    if (!stream_next(st, &x, sizeof(x))) return 0;
+    uint64_t m = (uint64_t)x * s;
+    uint32_t lo = (uint32_t)m;
+    if (lo < s) {
+        const uint32_t threshold = (0 - s) % s;
+        while (lo < threshold) {
+            if (!stream_next(st, &x, sizeof(x))) return 0;
+            m = (uint64_t)x * s;
+            lo = (uint32_t)m;
+        }
+    }
+    *out = (uint32_t)(m >> 32);
+    return 1;
+}
 
 // ============================================================
 // PUBLIC API
@@ -751,6 +2310,16 @@ __declspec(dllexport) void maxrng_init(void) {
     }
 }
 
+// Stops the entropy pool and releases the cached BCrypt providers and thread-local DRBG masters. Must not race with in-flight generation calls;
+// providers are reopened lazily if the library is used again afterwards.
+__declspec(dllexport) void maxrng_shutdown(void) {
+    pool_stop();
+    audio_capture_stop();
+    release_source_caches();
+    release_tls_masters();
+    release_providers();
+}
+
 // Thread-safe version, uses critical section lock, with optional complexity param (default 1)
 __declspec(dllexport) int maxrng_threadsafe(unsigned char *buffer, const int size, int complexity) {
     if (!buffer || size <= 0) return 0;
@@ -782,22 +2351,7 @@ int maxrng_dev(unsigned char *out_buf, const int out_buf_len, const int raw_len,
     if (!out_buf || out_buf_len <= 0 || raw_len <= 0 || !cfg_in) return 0;
 
     RNG_CONFIG cfg = *cfg_in;
-
-    // Reasonable defaults if caller forgot toggles
-    if (!(cfg.use_cpu | cfg.use_memory | cfg.use_perf | cfg.use_disk |
-          cfg.use_audio | cfg.use_battery | cfg.use_network | cfg.use_rdrand))
-    {
-        cfg.use_cpu = cfg.use_memory = cfg.use_perf = 1;
-        cfg.use_disk = cfg.use_audio = cfg.use_battery = cfg.use_network = 1;
-        cfg.use_rdrand = 1;
-    }
-
-    // Apply security preset
-    apply_security_preset(&cfg);
-
-    // Clamp complexity
-    if (cfg.complexity < 1) cfg.complexity = 1;
-    if (cfg.complexity > 10) cfg.complexity = 10;
+    normalize_config(&cfg);
 
     // Validate output buffer for the requested output mode
     int needed = 0;
@@ -809,64 +2363,114 @@ int maxrng_dev(unsigned char *out_buf, const int out_buf_len, const int raw_len,
     }
     if (out_buf_len < needed) return 0;
 
-    // Allocate raw workspace
-    unsigned char *raw = (unsigned char*)malloc((size_t)raw_len);
-    if (!raw) return 0;
+    // Raw output is generated directly into out_buf; encoded output needs a workspace
+    unsigned char *raw = out_buf;
+    if (cfg.output_mode != RNG_OUT_RAW) {
+        raw = (unsigned char*)malloc((size_t)raw_len);
+        if (!raw) return 0;
+    }
 
     // Threading
     ensure_threading_enter(&cfg);
 
-    // 1) Gather entropy into intermediate digest material using selected mixing
-    // Use collect_entropy_configurable to produce a base digest of size raw_len at least as input keying material
-    // For better domain separation, derive ikm_len = max(H, min(raw_len, 2*H))
-    const DWORD H = algo_digest_len(cfg.hash_algo);
-    const int ikm_len = (raw_len < (int)H) ? (int)H : ((raw_len > (int)(H * 2)) ? (int)(H * 2) : raw_len);
+    // 1) + 2) Gather entropy and expand according to selected strategy into raw
+    int ok = generate_raw(&cfg, raw, raw_len);
 
-    unsigned char *ikm = (unsigned char*)malloc((size_t)ikm_len);
-    if (!ikm) {
-        ensure_threading_leave(&cfg);
-        free(raw);
-        return 0;
-    }
-    if (!collect_entropy_configurable(ikm, ikm_len, cfg.complexity, cfg.hash_algo, cfg.mixing, &cfg)) {
-        ensure_threading_leave(&cfg);
-        free(ikm);
+    // 3) Write in requested output format
+    if (cfg.output_mode == RNG_OUT_RAW) {
+        // Never hand back partial output
+        if (!ok) SecureZeroMemory(out_buf, (size_t)raw_len);
+    } else {
+        if (ok) {
+            if (cfg.output_mode == RNG_OUT_HEX) {
+                hex_encode(raw, raw_len, (char*)out_buf);
+            } else {
+                ok = base64_encode(raw, raw_len, (char*)out_buf, out_buf_len);
+            }
+        }
+
+        // Wipe raw workspace
+        SecureZeroMemory(raw, (size_t)raw_len);
         free(raw);
-        return 0;
     }
+    ensure_threading_leave(&cfg);
 
-    // Seed injection for non HMAC/HKDF modes: fold by XOR to avoid bias
-    if ((cfg.expansion == RNG_EXP_COUNTER || cfg.expansion == RNG_EXP_XOF) && cfg.seed && cfg.seed_len > 0) {
-        const int m = (cfg.seed_len < ikm_len) ? cfg.seed_len : ikm_len;
-        for (int i = 0; i < m; i++) ikm[i] ^= cfg.seed[i];
-    }
+    return ok ? needed : 0; // return number of bytes written, or 0 on failure
+}
 
-    // 2) Expand according to selected strategy into raw
-    int ok = expand_output(&cfg, ikm, ikm_len, raw, raw_len);
+// Batch DEV RNG: fills `count` records of `record_len` raw bytes from a single entropy
+// gather and expansion. HEX/BASE64 encode every record separately, so record i starts at
+// i * encoded_len(record_len). Pass count = 1 to fill one whole buffer.
+__declspec(dllexport)
+int maxrng_dev_batch(unsigned char *out_buf, const int out_buf_len,
+                     const int record_len, const int count, const RNG_CONFIG *cfg_in)
+{
+    if (!out_buf || out_buf_len <= 0 || record_len <= 0 || count <= 0 || !cfg_in) return 0;
 
-    // Wipe ikm and release
-    SecureZeroMemory(ikm, (size_t)ikm_len);
-    free(ikm);
+    RNG_CONFIG cfg = *cfg_in;
+    normalize_config(&cfg);
 
-    // 3) Write in requested output format
-    if (ok) {
-        if (cfg.output_mode == RNG_OUT_RAW) {
-            memcpy(out_buf, raw, raw_len);
-        } else if (cfg.output_mode == RNG_OUT_HEX) {
-            hex_encode(raw, raw_len, (char*)out_buf);
-        } else if (cfg.output_mode == RNG_OUT_BASE64) {
-            ok = base64_encode(raw, raw_len, (char*)out_buf, out_buf_len);
-        } else {
-            ok = 0;
-        }
+    // Sizes are computed in 64 bits and bounded by out_buf_len before narrowing to int
+    long long stride64 = 0;
+    switch (cfg.output_mode) {
+        case RNG_OUT_RAW:    stride64 = record_len; break;
+        case RNG_OUT_HEX:    stride64 = (long long)record_len * 2; break;
+        case RNG_OUT_BASE64: stride64 = 4 * (((long long)record_len + 2) / 3); break;
+        default: return 0;
+    }
+    const long long raw_total = (long long)record_len * count;
+    const long long needed = stride64 * count;
+    if (stride64 > out_buf_len || raw_total > 0x7FFFFFFF || needed > out_buf_len) return 0;
+    const int stride = (int)stride64;
+
+    // Raw output is generated in place; encoded output needs a raw workspace
+    unsigned char *raw = out_buf;
+    if (cfg.output_mode != RNG_OUT_RAW) {
+        raw = (unsigned char*)malloc((size_t)raw_total);
+        if (!raw) return 0;
     }
 
-    // Wipe raw and leave
-    SecureZeroMemory(raw, (size_t)raw_len);
-    free(raw);
+    ensure_threading_enter(&cfg);
+    int ok = generate_raw(&cfg, raw, (int)raw_total);
     ensure_threading_leave(&cfg);
 
-    return ok ? needed : 0; // return number of bytes written, or 0 on failure
+    if (cfg.output_mode != RNG_OUT_RAW) {
+        for (int i = 0; ok && i < count; i++) {
+            const unsigned char *rec = raw + (size_t)i * record_len;
+            char *dst = (char*)out_buf + (size_t)i * stride;
+            if (cfg.output_mode == RNG_OUT_HEX) hex_encode(rec, record_len, dst);
+            else ok = base64_encode(rec, record_len, dst, stride);
+        }
+        SecureZeroMemory(raw, (size_t)raw_total);
+        free(raw);
+    } else if (!ok) {
+        SecureZeroMemory(out_buf, (size_t)raw_total);
+    }
+
+    return ok ? (int)needed : 0; // return number of bytes written, or 0 on failure
+}
+
+// Standalone encoder sharing the SIMD fast path (e.g. for DRBG output).
+// RAW copies in to out. Returns the number of bytes written, or 0 on failure.
+__declspec(dllexport)
+int maxrng_encode(const unsigned char *in, const int in_len, unsigned char *out, const int out_len,
+                  const RNG_OUTPUT_MODE mode)
+{
+    if (!in || in_len <= 0 || in_len > INT_MAX / 2 || !out || out_len <= 0) return 0;
+
+    int needed = 0;
+    switch (mode) {
+        case RNG_OUT_RAW:    needed = in_len; break;
+        case RNG_OUT_HEX:    needed = in_len * 2; break;
+        case RNG_OUT_BASE64: needed = base64_len(in_len); break;
+        default: return 0;
+    }
+    if (out_len < needed) return 0;
+
+    if (mode == RNG_OUT_RAW) memmove(out, in, (size_t)in_len);
+    else if (mode == RNG_OUT_HEX) hex_encode(in, in_len, (char*)out);
+    else if (!base64_encode(in, in_len, (char*)out, out_len)) return 0;
+    return needed;
 }
 
 // Convenience: sane defaults helper
@@ -890,3 +2494,174 @@ void maxrng_dev_default_config(RNG_CONFIG *cfg, const RNG_SECURITY_MODE mode) {
 
     apply_security_preset(cfg);
 }
+
+// Creates a seeded DRBG. cfg may be NULL (BALANCED defaults); cfg->seed is used as the
+// personalization string. reseed_bytes/reseed_ms of 0 select the defaults (1 MiB / 60 s).
+__declspec(dllexport)
+RNG_DRBG *maxrng_drbg_create(const RNG_CONFIG *cfg, const unsigned long long reseed_bytes, const unsigned int reseed_ms) {
+    return drbg_new(cfg, NULL, reseed_bytes, reseed_ms);
+}
+
+// Fills out with len bytes, reseeding first if the policy budget is exhausted
+__declspec(dllexport)
+int maxrng_drbg_generate(RNG_DRBG *drbg, unsigned char *out, const int len) {
+    if (!drbg || !out || len <= 0) return 0;
+
+    ensure_threading_enter(&drbg->cfg);
+    const int ok = drbg_generate_internal(drbg, out, len);
+    ensure_threading_leave(&drbg->cfg);
+    return ok;
+}
+
+// Forces a reseed from the configured entropy sources, mixing in optional additional input
+__declspec(dllexport)
+int maxrng_drbg_reseed(RNG_DRBG *drbg, const unsigned char *additional, const int add_len) {
+    if (!drbg || add_len < 0) return 0;
+
+    ensure_threading_enter(&drbg->cfg);
+    const int ok = drbg_reseed_internal(drbg, additional, additional ? add_len : 0);
+    ensure_threading_leave(&drbg->cfg);
+    return ok;
+}
+
+// Wipes and frees a DRBG created by maxrng_drbg_create
+__declspec(dllexport)
+void maxrng_drbg_destroy(RNG_DRBG *drbg) {
+    drbg_free(drbg);
+}
+
+// Starts the background entropy pool. pool_size is the bytes per buffer (0 = 4096) and
+// refill_ms the interval between refills (0 = 1000 ms). Returns 0 if already running.
+__declspec(dllexport)
+int maxrng_pool_start(const int pool_size, const unsigned int refill_ms) {
+    return pool_start(pool_size, refill_ms);
+}
+
+// Stops the pool thread and wipes both buffers. Returns 0 if the pool was not running.
+__declspec(dllexport)
+int maxrng_pool_stop(void) {
+    return pool_stop();
+}
+
+// Returns the number of ready bytes in the pool (0 if stopped or not filled yet)
+__declspec(dllexport)
+int maxrng_pool_fill_level(void) {
+    return pool_fill_level();
+}
+
+// Opens the default capture device once and keeps it streaming into a ring buffer; while
+// running, the audio collector hashes the newest samples instead of opening the device
+// and sleeping. Returns 1 on success, 0 if already running or no device is available.
+__declspec(dllexport)
+int maxrng_audio_start(void) {
+    return audio_capture_start();
+}
+
+// Closes the persistent capture device; returns 1 if it was running
+__declspec(dllexport)
+int maxrng_audio_stop(void) {
+    return audio_capture_stop();
+}
+
+// Sets how long disk and network snapshots are reused (default 0: query every round).
+// Network snapshots are also refreshed on interface/address changes.
+__declspec(dllexport)
+void maxrng_set_source_ttl(const unsigned int ttl_ms) {
+    InterlockedExchange(&g_sourceTtlMs, (LONG)ttl_ms);
+}
+
+// Turns per-collector counters on or off (off by default); returns the previous state
+__declspec(dllexport)
+int maxrng_enable_stats(const int enable) {
+    return InterlockedExchange(&g_statsEnabled, enable ? 1 : 0) != 0;
+}
+
+// Copies up to max_entries collector counters, indexed like RNG_SOURCE (rdrand, cpu, memory,
+// perf, disk, audio, battery, network). qpc_freq (optional) receives ticks per second.
+// Returns the number of entries written.
+__declspec(dllexport)
+int maxrng_get_stats(RNG_COLLECTOR_STATS *out, const int max_entries, unsigned long long *qpc_freq) {
+    if (qpc_freq) *qpc_freq = (unsigned long long)qpc_frequency();
+    if (!out || max_entries <= 0) return 0;
+
+    const int n = (max_entries < RNG_SRC_COUNT) ? max_entries : RNG_SRC_COUNT;
+    for (int i = 0; i < n; i++) {
+        RNG_STATS_SLOT *slot = &g_collectorStats[i];
+        out[i].calls     = (unsigned long long)InterlockedCompareExchange64(&slot->calls, 0, 0);
+        out[i].skipped   = (unsigned long long)InterlockedCompareExchange64(&slot->skipped, 0, 0);
+        out[i].total_qpc = (unsigned long long)InterlockedCompareExchange64(&slot->total_qpc, 0, 0);
+        out[i].max_qpc   = (unsigned long long)InterlockedCompareExchange64(&slot->max_qpc, 0, 0);
+        out[i].bytes     = (unsigned long long)InterlockedCompareExchange64(&slot->bytes, 0, 0);
+    }
+    return n;
+}
+
+// Zeroes every collector counter
+__declspec(dllexport)
+void maxrng_reset_stats(void) {
+    for (int i = 0; i < RNG_SRC_COUNT; i++) {
+        RNG_STATS_SLOT *slot = &g_collectorStats[i];
+        InterlockedExchange64(&slot->calls, 0);
+        InterlockedExchange64(&slot->skipped, 0);
+        InterlockedExchange64(&slot->total_qpc, 0);
+        InterlockedExchange64(&slot->max_qpc, 0);
+        InterlockedExchange64(&slot->bytes, 0);
+    }
+}
+
+// Fills out[0..n) with unbiased integers in the inclusive range [lo, hi]. Like the other
+// sampling kernels it draws from the BALANCED thread-local DRBG.
+__declspec(dllexport)
+int maxrng_uniform_u64(const uint64_t lo, const uint64_t hi, uint64_t *out, const int n) {
+    if (!out || n <= 0 || hi < lo) return 0;
+
+    RNG_WORD_STREAM st;
+    stream_init(&st, (long long)n * (long long)sizeof(uint64_t));
+    const uint64_t span = hi - lo + 1; // 0 means the full 64-bit range
+    int ok = 1;
+    for (int i = 0; ok && i < n; i++) {
+        uint64_t v;
+        ok = span ? uniform_below_u64(&st, span, &v) : stream_next(&st, &v, sizeof(v));
+        out[i] = lo + v;
+    }
+    stream_wipe(&st);
+    return ok;
+}
+
+// Fills out[0..n) with doubles uniformly distributed in [0, 1) using 53 random bits each
+__declspec(dllexport)
+int maxrng_uniform_double(double *out, const int n) {
+    if (!out || n <= 0) return 0;
+
+    RNG_WORD_STREAM st;
+    stream_init(&st, (long long)n * (long long)sizeof(uint64_t));
+    int ok = 1;
+    for (int i = 0; ok && i < n; i++) {
+        uint64_t x = 0;
+        ok = stream_next(&st, &x, sizeof(x));
+        out[i] = (double)(x >> 11) * (1.0 / 9007199254740992.0); // 2^-53
+    }
+    stream_wipe(&st);
+    return ok;
+}
+
+// Writes a uniformly random permutation of 0..n-1 into perm (Fisher-Yates)
+__declspec(dllexport)
+int maxrng_shuffle_indices(uint32_t *perm, const int n) {
+    if (!perm || n <= 0) return 0;
+
+    for (int i = 0; i < n; i++) perm[i] = (uint32_t)i;
+
+    RNG_WORD_STREAM st;
+    stream_init(&st, (long long)(n - 1) * (long long)sizeof(uint32_t));
+    int ok = 1;
+    for (int i = n - 1; ok && i > 0; i--) {
+        uint32_t j = 0;
+        ok = uniform_below_u32(&st, (uint32_t)i + 1, &j);
+        const uint32_t tmp = perm[i];
+        perm[i] = perm[j];
+        perm[j] = tmp;
+    }
+    stream_wipe(&st);
+    return ok;
+}
@@ -1,8 +1,11 @@
+#include <winsock2.h>
+#include <ws2tcpip.h>
 #include <windows.h>
 #include <psapi.h>
 #include <tlhelp32.h>
 #include <iphlpapi.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #pragma comment(lib, "psapi.lib")
@@ -16,30 +19,356 @@
 #define METRIC_CPU_USAGE     0x20
 #define METRIC_IO            0x40
 #define METRIC_NET           0x80
+#define METRIC_SELF_PROFILE  0x100  // not a metric: adds the sampler's own cost to each sample
+#define METRIC_THREAD_CPU    0x200  // monitors: per-thread breakdown, see monitor_read_threads()
+
+// Phases timed by METRIC_SELF_PROFILE, indexes of METRICS_RECORD.phase_ns
+#define PROFILE_OPEN     0   // proc_acquire, or the liveness check of a monitored process
+#define PROFILE_MEMORY   1
+#define PROFILE_HANDLES  2
+#define PROFILE_THREADS  3   // the whole Toolhelp (and METRIC_THREAD_CPU) pass, shared by every PID
+#define PROFILE_CPU      4
+#define PROFILE_IO       5
+#define PROFILE_NET      6   // the whole connection-table pass, shared like PROFILE_THREADS
+#define PROFILE_FORMAT   7   // monitors only: building the JSON or record of the previous sample
+#define PROFILE_CALLBACK 8   // monitors only: delivering the previous sample
+#define PROFILE_PHASES   9
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Binary counterpart of the JSON output, for callers that map it directly (ctypes etc.).
+// Fields are only ever appended; each layout change bumps METRICS_RECORD_VERSION.
+#define METRICS_RECORD_VERSION 5
+
+#define METRICS_STATUS_OK          0
+#define METRICS_STATUS_UNAVAILABLE 1
+
+#pragma pack(push, 1)
+typedef struct {
+    unsigned short version;              // METRICS_RECORD_VERSION
+    unsigned short size;                 // sizeof(METRICS_RECORD)
+    DWORD pid;
+    DWORD metrics;                       // METRIC_* flags whose fields are valid
+    DWORD status;                        // METRICS_STATUS_*
+    unsigned long long working_set_kb;
+    unsigned long long private_kb;
+    unsigned long long pagefile_kb;
+    DWORD handles;
+    DWORD threads;
+    double cpu;
+    unsigned long long io_read_kb;
+    unsigned long long io_write_kb;
+    // Version 2
+    unsigned long long timestamp_us;     // QPC time the sample was taken, in microseconds
+    DWORD missed;                        // monitor deadlines skipped since the previous sample
+    DWORD late_us;                       // how far past its deadline the sample was taken
+    // Version 3
+    DWORD tcp_connections;               // METRIC_NET: IPv4 + IPv6
+    DWORD udp_endpoints;                 // METRIC_NET: IPv4 + IPv6
+    unsigned long long net_rx_bytes;     // METRIC_NET: TCP payload bytes observed while tracked
+    unsigned long long net_tx_bytes;
+    // Version 4
+    double cpu_user;                     // METRIC_CPU_USAGE split; cpu = cpu_user + cpu_kernel
+    double cpu_kernel;
+    // Version 5
+    unsigned long long sampler_cpu_us;   // METRIC_SELF_PROFILE: CPU time the sampling thread has used so far
+    DWORD phase_ns[PROFILE_PHASES];      // METRIC_SELF_PROFILE: time spent per PROFILE_* phase
+} METRICS_RECORD;
+#pragma pack(pop)
+
+#define THREAD_RECORD_VERSION 1
+
+// One thread of a per-thread breakdown (get_thread_metrics, monitor_read_threads)
+#pragma pack(push, 1)
+typedef struct {
+    unsigned short version;              // THREAD_RECORD_VERSION
+    unsigned short size;                 // sizeof(THREAD_RECORD)
+    DWORD pid;
+    DWORD tid;
+    DWORD state;                         // KTHREAD_STATE: 1 ready, 2 running, 5 waiting, ...
+    DWORD wait_reason;                   // KWAIT_REASON, meaningful while waiting
+    LONG priority;                       // current dynamic priority
+    DWORD context_switches;              // since the previous reading
+    double cpu;                          // percent of all logical processors, like METRICS_RECORD.cpu
+    double cpu_user;
+    double cpu_kernel;
+    unsigned long long cpu_time_us;      // user + kernel time since the thread started
+    unsigned long long timestamp_us;     // QPC time of the reading
+} THREAD_RECORD;
+#pragma pack(pop)
+
+// Previous CPU reading of one process, owned by whoever computes deltas from it
+typedef struct {
+    LONGLONG qpc;              // when the times below were read
+    ULONGLONG kernel, user;    // process times, 100 ns units
+    int valid;                 // 0 until the first reading
+} CpuState;
+
+// CPU times of one thread at the previous breakdown
+typedef struct {
+    DWORD tid;
+    ULONGLONG createTime, kernel, user;
+    ULONG switches;
+} ThreadCpu;
+
+typedef struct {
+    ThreadCpu *threads;    // sorted by tid, NULL before the first breakdown
+    int count;
+    LONGLONG qpc;
+} ThreadBaseline;
 
 typedef struct {
     DWORD pid;
     DWORD metrics;
-    FILETIME sysKernelStart, sysUserStart;
-    FILETIME procKernelStart, procUserStart;
+    CpuState cpuStart;
     IO_COUNTERS ioStart;
+    unsigned long long netRxStart, netTxStart;
+    ULONGLONG creationTime;    // detects PID reuse between start and end
     int active;
 } MetricsSession;
 
-// Structure for the monitoring thread
+// Cached process handle, shared by every sampling path
+typedef struct ProcEntry {
+    struct ProcEntry *next;    // hash bucket chain, guarded by g_procLock
+    DWORD pid;
+    HANDLE hProcess;
+    ULONGLONG creationTime;    // identifies the process across PID reuse
+    HANDLE hWait;              // registered exit wait, if any
+    volatile LONG refs;        // the cache, the wait and each active user
+    volatile LONG exited;
+    volatile LONG waitArmed;   // the wait still holds its reference
+    int linked;                // present in the cache
+    unsigned long long netRx, netTx;  // TCP bytes observed so far, guarded by g_netLock
+    SRWLOCK cpuLock;           // guards cpu for concurrent snapshot callers
+    CpuState cpu;              // previous reading for snapshots of this process
+    ThreadBaseline threads;    // previous get_thread_metrics reading, also guarded by cpuLock
+} ProcEntry;
+
+#define MONITOR_FREE      0
+#define MONITOR_ACTIVE    1
+#define MONITOR_FINISHED  2  // past its duration, kept until destroyed
+#define MONITOR_DESTROYED 3  // destroyed from its own callback, freed by the scheduler
+
+// Single-producer/single-consumer ring of samples: the scheduler thread only advances head,
+// the monitor_read caller only advances tail, so neither side takes a lock on the data
+typedef struct {
+    METRICS_RECORD *slots;
+    DWORD mask;                  // capacity - 1, capacity is a power of two
+    HANDLE hEvent;               // auto-reset, set when a sample lands in an empty ring
+    char pad0[64];
+    volatile LONG64 head;        // next slot to write (scheduler)
+    volatile LONG64 dropped;     // samples lost because the ring was full (scheduler)
+    char pad1[64];
+    volatile LONG64 tail;        // next slot to read (consumer)
+} RecordRing;
+
+// Compact on-disk recording: a header followed by blocks of up to RECORDING_BLOCK_SAMPLES
+// samples. Within a block every column is stored on its own as zigzag varint deltas (the
+// first value against 0), so slowly changing metrics cost about one byte per sample.
+#define RECORDING_MAGIC         "PIREC\0\0\0"
+#define RECORDING_VERSION       1
+#define RECORDING_BLOCK_SAMPLES 256
+#define RECORDING_GROW_BYTES    (1ull << 20)  // file grows (and is remapped) in steps of at least this
+
+// Column ids, in stored order; only the columns of requested metrics are present
+#define REC_COL_TIMESTAMP_US   0   // always present
+#define REC_COL_MISSED         1   // always present
+#define REC_COL_WORKING_SET_KB 2
+#define REC_COL_PRIVATE_KB     3
+#define REC_COL_PAGEFILE_KB    4
+#define REC_COL_HANDLES        5
+#define REC_COL_THREADS        6
+#define REC_COL_CPU            7   // hundredths of a percent
+#define REC_COL_CPU_USER       8   // hundredths of a percent
+#define REC_COL_CPU_KERNEL     9   // hundredths of a percent
+#define REC_COL_IO_READ_KB     10
+#define REC_COL_IO_WRITE_KB    11
+#define REC_COL_TCP            12
+#define REC_COL_UDP            13
+#define REC_COL_NET_RX         14
+#define REC_COL_NET_TX         15
+#define REC_COL_COUNT          16
+
+#pragma pack(push, 1)
+typedef struct {
+    char magic[8];                        // RECORDING_MAGIC
+    unsigned short version;               // RECORDING_VERSION
+    unsigned short size;                  // sizeof(RECORDING_HEADER)
+    DWORD pid;
+    DWORD metrics;                        // METRIC_* mask the columns were derived from
+    DWORD intervalMs;
+    DWORD columnCount;
+    unsigned char columns[REC_COL_COUNT]; // REC_COL_* ids of the stored columns, in order
+    unsigned long long sampleCount;       // samples in complete blocks
+    unsigned long long dataBytes;         // bytes of complete blocks after the header
+} RECORDING_HEADER;
+#pragma pack(pop)
+// Each block is: DWORD sample count, one DWORD byte length per column, the column streams
+
+// Writer state of a recording monitor, used by the scheduler thread only
+typedef struct {
+    HANDLE hFile;
+    HANDLE hMapping;
+    unsigned char *view;
+    unsigned long long mapped;            // size of the file and of the view
+    unsigned long long committed;         // header->dataBytes, kept in case a remap fails
+    int failed;                           // the file could not be grown; further samples are lost
+    DWORD columnCount;
+    unsigned char columns[REC_COL_COUNT];
+    DWORD pending;                        // samples buffered for the next block
+    long long values[REC_COL_COUNT][RECORDING_BLOCK_SAMPLES];
+} Recorder;
+
+// Windowed aggregation: per metric min/max/mean, with percentiles taken from a log-linear
+// histogram of 16 sub-buckets per power of two (within ~3% of the exact value)
+#define METRICS_AGGREGATE_VERSION 2
+#define AGG_SUB_BUCKETS 16
+#define AGG_SUB_BITS    4
+#define AGG_BUCKETS     (AGG_SUB_BUCKETS + (64 - AGG_SUB_BITS) * AGG_SUB_BUCKETS)
+
+#pragma pack(push, 1)
+typedef struct {
+    double min, max, mean;
+    double p50, p95, p99;
+} METRIC_STATS;
+
+typedef struct {
+    unsigned short version;               // METRICS_AGGREGATE_VERSION
+    unsigned short size;                  // sizeof(METRICS_AGGREGATE)
+    DWORD pid;
+    DWORD metrics;
+    DWORD columns;                        // bit n set when stats[n] is filled (n = REC_COL_*)
+    DWORD samples;                        // samples in the window
+    DWORD missed;                         // deadlines skipped during the window
+    unsigned long long start_us;          // timestamp_us of the first sample in the window
+    unsigned long long end_us;            // timestamp_us of the last sample in the window
+    METRIC_STATS stats[REC_COL_COUNT];    // by REC_COL_* id, in the units of the JSON keys
+    // Version 2
+    unsigned long long sampler_cpu_us;    // METRIC_SELF_PROFILE: scheduler CPU time since the previous window
+    unsigned long long phase_ns[PROFILE_PHASES];  // METRIC_SELF_PROFILE: per-phase totals of the window
+} METRICS_AGGREGATE;
+#pragma pack(pop)
+
+typedef struct {
+    long long min, max;
+    double sum;
+    DWORD counts[AGG_BUCKETS];
+} AggColumn;
+
+// Window state of an aggregating monitor, used by the scheduler thread only
+typedef struct {
+    unsigned long long windowUs;
+    unsigned long long windowEndUs;       // 0 until the first sample
+    DWORD samples, missed;
+    unsigned long long startUs, endUs;
+    DWORD columnCount;
+    unsigned char columns[REC_COL_COUNT];
+    AggColumn stats[REC_COL_COUNT];       // by position in columns[]
+    unsigned long long cpuMarkUs;         // sampler_cpu_us when the previous window closed
+    unsigned long long cpuLastUs;
+    unsigned long long phaseNs[PROFILE_PHASES];
+    void (*callbackFn)(const METRICS_AGGREGATE*, void*);
+} Aggregator;
+
+// Threshold rules: evaluated by the scheduler on every sample, reported only on transitions
+#define METRICS_ALERT_VERSION 1
+#define MONITOR_MAX_RULES     16
+#define THRESHOLD_ABOVE       0   // holds while value > threshold
+#define THRESHOLD_BELOW       1   // holds while value < threshold
+
+#pragma pack(push, 1)
+typedef struct {
+    unsigned short version;               // METRICS_ALERT_VERSION
+    unsigned short size;                  // sizeof(METRICS_ALERT)
+    int monitor;                          // monitor id
+    int rule;                             // index returned by monitor_add_threshold
+    DWORD pid;
+    DWORD column;                         // REC_COL_*
+    int active;                           // 1 when the rule starts holding, 0 when it stops
+    double value;                         // sample value that completed the transition
+    double threshold;
+    unsigned long long timestamp_us;      // timestamp_us of that sample
+} METRICS_ALERT;
+#pragma pack(pop)
+
+typedef struct {
+    DWORD column;
+    int op;                               // THRESHOLD_*
+    double threshold;                     // in the units of the JSON key
+    DWORD samples;                        // consecutive samples needed for a transition
+    DWORD run;                            // consecutive samples disagreeing with `active`
+    int active;
+    void (*alertFn)(const METRICS_ALERT*, void*);
+    void *userData;
+} ThresholdRule;
+
+// One monitor served by the shared scheduler thread; fields are guarded by g_schedLock
 typedef struct {
+    int id;                // handle returned by monitor_create, 0 while the slot is free
+    int state;             // MONITOR_*
     DWORD pid;
     DWORD metrics;
     DWORD intervalMs;
     int totalDurationMs;   // -1 means run until explicitly stopped
-    int isRunning;
-    HANDLE threadHandle;
+    LONGLONG startQpc;
+    LONGLONG intervalQpc;
+    LONGLONG durationQpc;  // 0 when running until explicitly stopped
+    LONGLONG nextDueQpc;   // absolute deadline, advanced by whole intervals
+    CpuState cpu;          // this monitor's own CPU baseline, touched by the scheduler only
+    DWORD prevFormatNs;    // METRIC_SELF_PROFILE delivery cost of the previous sample, likewise
+    DWORD prevCallbackNs;
+    DWORD dueMissed;       // deadlines skipped before the sample being dispatched
+    DWORD dueLateUs;       // lateness of the sample being dispatched
+    int dueExpired;        // the duration ended with the sample being dispatched
+    int dueExited;         // the process was found to have exited in this pass
+    int dispatching;       // being sampled / called back outside the lock
     void (*callbackFn)(const char*, void*);
+    void (*recordCallbackFn)(const METRICS_RECORD*, void*);  // used instead of callbackFn when set
     void* userData;
+    ProcEntry *entry;      // held for the whole monitoring session
+    RecordRing *ring;      // ring delivery instead of callbacks when set
+    Recorder *recorder;    // recording to disk instead of callbacks when set
+    Aggregator *aggregator;  // one callback per window instead of per sample when set
+    ThresholdRule *rules;  // MONITOR_MAX_RULES slots, allocated by the first rule; only
+    int ruleCount;         // changed while not dispatching, so the scheduler reads them unlocked
+    HANDLE hAlertEvent;    // auto-reset, set on every rule transition
+    ThreadBaseline threadBase;   // METRIC_THREAD_CPU: written by the scheduler only
+    SRWLOCK threadLock;          // guards the breakdown below against monitor_read_threads
+    THREAD_RECORD *threadRecords;  // breakdown of the latest sample, busiest first
+    int threadCount;
 } MonitoringContext;
 
-static MetricsSession g_session = {0};
-static MonitoringContext g_monitorContext = {0};
+#define MAX_SESSIONS 64
+static MetricsSession g_sessions[MAX_SESSIONS];
+static SRWLOCK g_sessionLock = SRWLOCK_INIT;
+#define MAX_MONITORS 128
+#define MONITOR_JSON_THREADS 8   // busiest threads included in METRIC_THREAD_CPU JSON samples
+static MonitoringContext g_monitors[MAX_MONITORS];
+
+static LONGLONG qpc_frequency() {
+    static LONGLONG freq = 0;
+    if (!freq) {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        freq = f.QuadPart;
+    }
+    return freq;
+}
+
+static LONGLONG qpc_now() {
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    return t.QuadPart;
+}
+
+static unsigned long long qpc_to_us(const LONGLONG ticks) {
+    const LONGLONG freq = qpc_frequency();
+    // Split to avoid overflowing ticks * 1000000
+    return (unsigned long long)(ticks / freq) * 1000000ULL +
+           (unsigned long long)(ticks % freq) * 1000000ULL / (unsigned long long)freq;
+}
 
 static ULONGLONG fileTimeToInt(const FILETIME ft) {
     ULARGE_INTEGER ui;
@@ -48,32 +377,270 @@ static ULONGLONG fileTimeToInt(const FILETIME ft) {
     return ui.QuadPart;
 }
 
+// QPC ticks as nanoseconds, saturated to a DWORD (about 4.3 s)
+static DWORD qpc_to_ns(const LONGLONG ticks) {
+    if (ticks <= 0) return 0;
+    const LONGLONG freq = qpc_frequency();
+    const unsigned long long ns = (unsigned long long)(ticks / freq) * 1000000000ULL +
+                                  (unsigned long long)(ticks % freq) * 1000000000ULL / (unsigned long long)freq;
+    return ns > MAXDWORD ? MAXDWORD : (DWORD)ns;
+}
+
+// User + kernel time of the calling thread. GetThreadTimes advances in scheduler ticks
+// (usually 15.6 ms), so only differences over many samples are meaningful.
+static unsigned long long thread_cpu_us() {
+    FILETIME creation, exitTime, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exitTime, &kernel, &user)) return 0;
+    return (fileTimeToInt(kernel) + fileTimeToInt(user)) / 10;
+}
+
+// Process handle cache: PID -> open handle, shared by every sampling path so monitors and
+// repeated snapshots do not pay OpenProcess/CloseHandle per sample. Cached handles keep the
+// PID from being reused; a registered wait evicts an entry as soon as its process exits.
+#define PROC_CACHE_BUCKETS 256
+#define PROC_CACHE_MAX     1024  // beyond this, entries are opened uncached
+
+static SRWLOCK g_procLock = SRWLOCK_INIT;
+static ProcEntry *g_procBuckets[PROC_CACHE_BUCKETS];
+static int g_procCount = 0;
+
+static ProcEntry **proc_bucket(const DWORD pid) {
+    // PIDs are multiples of 4
+    return &g_procBuckets[(pid >> 2) & (PROC_CACHE_BUCKETS - 1)];
+}
+
+// Drops one reference; the last one closes the handle
+static void proc_release(ProcEntry *e) {
+    if (!e || InterlockedDecrement(&e->refs) != 0) return;
+    // ReSharper disable once CppLocalVariableMayBeConst
+    HANDLE hWait = InterlockedExchangePointer(&e->hWait, NULL);
+    if (hWait) UnregisterWaitEx(hWait, NULL);
+    CloseHandle(e->hProcess);
+    free(e->threads.threads);
+    free(e);
+}
+
+// Removes the entry from the cache (if still there) and drops the cache's reference
+static void proc_evict(ProcEntry *e) {
+    int unlinked = 0;
+    AcquireSRWLockExclusive(&g_procLock);
+    if (e->linked) {
+        ProcEntry **pp = proc_bucket(e->pid);
+        while (*pp && *pp != e) pp = &(*pp)->next;
+        if (*pp) *pp = e->next;
+        e->linked = 0;
+        g_procCount--;
+        unlinked = 1;
+    }
+    ReleaseSRWLockExclusive(&g_procLock);
+    if (unlinked) proc_release(e);
+}
+
 // ReSharper disable once CppParameterMayBeConst
-double get_cpu_usage(HANDLE hProcess) {
-    static FILETIME lastSysKernel = {0}, lastSysUser = {0};
-    static ULONGLONG lastProcKernel = 0, lastProcUser = 0;
+static VOID CALLBACK proc_exit_callback(PVOID context, BOOLEAN timedOut) {
+    (void)timedOut;
+    ProcEntry *e = (ProcEntry*)context;
+    InterlockedExchange(&e->exited, 1);
+    proc_evict(e);
+    if (InterlockedExchange(&e->waitArmed, 0)) proc_release(e);
+}
 
-    FILETIME sysIdle, sysKernel, sysUser;
-    FILETIME procCreation, procExit, procKernel, procUser;
+static int proc_is_alive(ProcEntry *e) {
+    if (e->exited) return 0;
+    // Entries without a registered wait (no SYNCHRONIZE access) are checked on use
+    if (!e->waitArmed) {
+        DWORD code = 0;
+        if (!GetExitCodeProcess(e->hProcess, &code) || code != STILL_ACTIVE) {
+            InterlockedExchange(&e->exited, 1);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Opens with the least access that still serves every metric, falling back for protected
+// processes (where memory counters are then unavailable)
+static HANDLE proc_open(const DWORD pid, int *canWait) {
+    *canWait = 1;
+    // ReSharper disable once CppLocalVariableMayBeConst
+    HANDLE h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_VM_READ | SYNCHRONIZE, FALSE, pid);
+    if (!h) h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, pid);
+    if (!h) {
+        *canWait = 0;
+        h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    }
+    return h;
+}
+
+// Returns a referenced entry for a running process, or NULL; pair with proc_release()
+static ProcEntry *proc_acquire(const DWORD pid) {
+    AcquireSRWLockShared(&g_procLock);
+    ProcEntry *e = *proc_bucket(pid);
+    while (e && (e->pid != pid || e->exited)) e = e->next;
+    if (e) InterlockedIncrement(&e->refs);
+    ReleaseSRWLockShared(&g_procLock);
+
+    if (e) {
+        if (proc_is_alive(e)) return e;
+        proc_evict(e);
+        proc_release(e);
+        return NULL;
+    }
+
+    int canWait;
+    // ReSharper disable once CppLocalVariableMayBeConst
+    HANDLE hProcess = proc_open(pid, &canWait);
+    if (!hProcess) return NULL;
+
+    FILETIME creation, exitTime, kernel, user;
+    if (!GetProcessTimes(hProcess, &creation, &exitTime, &kernel, &user)) {
+        CloseHandle(hProcess);
+        return NULL;
+    }
+
+    e = (ProcEntry*)calloc(1, sizeof(ProcEntry));
+    if (!e) {
+        CloseHandle(hProcess);
+        return NULL;
+    }
+    e->pid = pid;
+    e->hProcess = hProcess;
+    e->creationTime = fileTimeToInt(creation);
+    e->refs = 1;
+
+    AcquireSRWLockExclusive(&g_procLock);
+    // Another thread may have cached the same process meanwhile
+    ProcEntry *existing = *proc_bucket(pid);
+    while (existing && (existing->pid != pid || existing->exited || existing->creationTime != e->creationTime))
+        existing = existing->next;
+    if (existing) {
+        InterlockedIncrement(&existing->refs);
+    } else if (g_procCount < PROC_CACHE_MAX) {
+        ProcEntry **bucket = proc_bucket(pid);
+        e->next = *bucket;
+        *bucket = e;
+        e->linked = 1;
+        e->refs++;  // reference held by the cache
+        g_procCount++;
+    }
+    ReleaseSRWLockExclusive(&g_procLock);
+
+    if (existing) {
+        CloseHandle(hProcess);
+        free(e);
+        return existing;
+    }
 
-    if (!GetSystemTimes(&sysIdle, &sysKernel, &sysUser)) return 0.0;
-    if (!GetProcessTimes(hProcess, &procCreation, &procExit, &procKernel, &procUser)) return 0.0;
+    if (e->linked && canWait) {
+        InterlockedIncrement(&e->refs);  // reference held by the wait
+        e->waitArmed = 1;
+        HANDLE hWait = NULL;
+        if (RegisterWaitForSingleObject(&hWait, hProcess, proc_exit_callback, e, INFINITE,
+                                        WT_EXECUTEONLYONCE | WT_EXECUTEINWAITTHREAD)) {
+            InterlockedExchangePointer(&e->hWait, hWait);
+        } else {
+            e->waitArmed = 0;
+            InterlockedDecrement(&e->refs);
+        }
+    }
+    return e;
+}
+
+// Closes every cached handle not in use by an active session or monitor
+__declspec(dllexport)
+int release_process_cache() {
+    AcquireSRWLockExclusive(&g_procLock);
+    ProcEntry *list = NULL;
+    for (int b = 0; b < PROC_CACHE_BUCKETS; b++) {
+        while (g_procBuckets[b]) {
+            ProcEntry *e = g_procBuckets[b];
+            g_procBuckets[b] = e->next;
+            e->linked = 0;
+            e->next = list;
+            list = e;
+        }
+    }
+    g_procCount = 0;
+    ReleaseSRWLockExclusive(&g_procLock);
+
+    int released = 0;
+    while (list) {
+        ProcEntry *e = list;
+        list = e->next;
+        // ReSharper disable once CppLocalVariableMayBeConst
+        HANDLE hWait = InterlockedExchangePointer(&e->hWait, NULL);
+        if (hWait) UnregisterWaitEx(hWait, INVALID_HANDLE_VALUE);  // waits for a running callback
+        if (InterlockedExchange(&e->waitArmed, 0)) proc_release(e);
+        proc_release(e);
+        released++;
+    }
+    return released;
+}
+
+static DWORD logical_cpu_count() {
+    static DWORD count = 0;
+    if (!count) {
+        count = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+        if (!count) count = 1;
+    }
+    return count;
+}
+
+// Converts kernel/user time deltas over `wall` (all in 100 ns units) to percentages of all
+// logical processors
+static void cpu_percent(const ULONGLONG dk, const ULONGLONG du, const double wall,
+                        double *total, double *user, double *kernel) {
+    *user = *kernel = 0.0;
+    if (wall > 0.0) {
+        const double scale = 100.0 / (wall * (double)logical_cpu_count());
+        *user = (double)du * scale;
+        *kernel = (double)dk * scale;
+    }
+    *total = *user + *kernel;
+}
 
-    const ULONGLONG sysKernelInt = fileTimeToInt(sysKernel);
-    const ULONGLONG sysUserInt = fileTimeToInt(sysUser);
-    const ULONGLONG procKernelInt = fileTimeToInt(procKernel);
-    const ULONGLONG procUserInt = fileTimeToInt(procUser);
+// CPU usage since the reading in prev (or since process start when prev is empty) as a
+// percentage of all logical processors, split into user and kernel time; advances prev.
+// Each caller owns its prev, so independent consumers never disturb each other's deltas.
+// ReSharper disable once CppParameterMayBeConst
+static int get_cpu_usage(HANDLE hProcess, const ULONGLONG creationTime, CpuState *prev,
+                         double *total, double *user, double *kernel) {
+    FILETIME procCreation, procExit, procKernel, procUser;
+    const LONGLONG now = qpc_now();
+    if (!GetProcessTimes(hProcess, &procCreation, &procExit, &procKernel, &procUser)) return 0;
+    const ULONGLONG k = fileTimeToInt(procKernel);
+    const ULONGLONG u = fileTimeToInt(procUser);
 
-    const ULONGLONG sysDelta = (sysKernelInt + sysUserInt) - (fileTimeToInt(lastSysKernel) + fileTimeToInt(lastSysUser));
-    const ULONGLONG procDelta = (procKernelInt + procUserInt) - (lastProcKernel + lastProcUser);
+    double wall;  // 100 ns units
+    ULONGLONG dk, du;
+    if (prev->valid) {
+        wall = (double)(now - prev->qpc) * 1e7 / (double)qpc_frequency();
+        dk = k >= prev->kernel ? k - prev->kernel : 0;
+        du = u >= prev->user ? u - prev->user : 0;
+    } else {
+        // First reading: average over the process lifetime instead of a meaningless delta
+        FILETIME nowFt;
+        GetSystemTimeAsFileTime(&nowFt);
+        const ULONGLONG nowInt = fileTimeToInt(nowFt);
+        wall = nowInt > creationTime ? (double)(nowInt - creationTime) : 0.0;
+        dk = k;
+        du = u;
+    }
+    prev->qpc = now;
+    prev->kernel = k;
+    prev->user = u;
+    prev->valid = 1;
 
-    lastSysKernel = sysKernel;
-    lastSysUser = sysUser;
-    lastProcKernel = procKernelInt;
-    lastProcUser = procUserInt;
+    cpu_percent(dk, du, wall, total, user, kernel);
+    return 1;
+}
 
-    if (sysDelta == 0) return 0.0;
-    return ((double)procDelta / (double)sysDelta) * 100.0;
+// Starts a CPU baseline at the current process times
+// ReSharper disable once CppParameterMayBeConst
+static int cpu_baseline(HANDLE hProcess, CpuState *state) {
+    double total, user, kernel;
+    state->valid = 0;
+    return get_cpu_usage(hProcess, 0, state, &total, &user, &kernel);
 }
 
 void build_metrics_json(char *buf, const size_t buflen, const DWORD pid, const DWORD metrics,
@@ -99,65 +666,58 @@ void build_metrics_json(char *buf, const size_t buflen, const DWORD pid, const D
     snprintf(buf + n, buflen - n, "}");
 }
 
-static int capture_start_state(const DWORD pid, const DWORD metrics, MetricsSession *session) {
-    // ReSharper disable once CppLocalVariableMayBeConst
-    HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, pid);
-    if (!hProcess) return 0;
-
-    FILETIME sysIdle, sysKernel, sysUser;
-    FILETIME procCreation, procExit, procKernel, procUser;
-    IO_COUNTERS ioCounters = {0};
+// Values gathered for one process, shared by the single-PID and batch paths
+typedef struct {
+    DWORD pid;
+    size_t ws, priv, pf;                 // KB
+    DWORD handles;
+    DWORD threads;
+    double cpu, cpu_user, cpu_kernel;   // percent of all logical processors
+    unsigned long long io_r, io_w;       // KB
+    unsigned long long timestamp_us;     // QPC based
+    DWORD missed;                        // set by the monitor scheduler only
+    DWORD late_us;
+    DWORD tcp, udp;                      // filled by snapshot_net_counters like threads
+    unsigned long long net_rx, net_tx;   // bytes
+    unsigned long long sampler_cpu_us;   // METRIC_SELF_PROFILE only
+    DWORD phase_ns[PROFILE_PHASES];
+} MetricsSample;
 
-    if (metrics & METRIC_CPU_USAGE) {
-        if (!GetSystemTimes(&sysIdle, &sysKernel, &sysUser)) {
-            CloseHandle(hProcess);
-            return 0;
-        }
-        if (!GetProcessTimes(hProcess, &procCreation, &procExit, &procKernel, &procUser)) {
-            CloseHandle(hProcess);
-            return 0;
-        }
-        session->sysKernelStart = sysKernel;
-        session->sysUserStart = sysUser;
-        session->procKernelStart = procKernel;
-        session->procUserStart = procUser;
-    }
-    if (metrics & METRIC_IO) {
-        GetProcessIoCounters(hProcess, &ioCounters);
-        session->ioStart = ioCounters;
-    }
-    session->pid = pid;
-    session->metrics = metrics;
-    session->active = 1;
-    CloseHandle(hProcess);
-    return 1;
+static void profile_add(MetricsSample *s, const int phase, const LONGLONG ticks) {
+    const unsigned long long ns = (unsigned long long)s->phase_ns[phase] + qpc_to_ns(ticks);
+    s->phase_ns[phase] = ns > MAXDWORD ? MAXDWORD : (DWORD)ns;
 }
 
-__declspec(dllexport)
-int start_metrics_collection(const DWORD pid, const DWORD metrics) {
-    memset(&g_session, 0, sizeof(g_session));
-    return capture_start_state(pid, metrics, &g_session);
+// Charges the time since `since` to a phase and returns the current QPC time
+static LONGLONG profile_phase(MetricsSample *s, const int phase, const LONGLONG since) {
+    const LONGLONG now = qpc_now();
+    profile_add(s, phase, now - since);
+    return now;
 }
 
-__declspec(dllexport)
-int end_metrics_collection(const DWORD pid, const DWORD metrics, char *json_buf, const size_t json_buflen) {
-    if (!g_session.active || g_session.pid != pid || g_session.metrics != metrics) return 0;
-    if (!json_buf || json_buflen == 0) return 0;
+typedef struct {
+    DWORD pid;
+    int index;                           // position in the caller's PID array
+} PidIndex;
 
-    // ReSharper disable once CppLocalVariableMayBeConst
-    HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, pid);
-    if (!hProcess) return 0;
+static int cmp_pid_index(const void *a, const void *b) {
+    const DWORD x = ((const PidIndex*)a)->pid, y = ((const PidIndex*)b)->pid;
+    return (x > y) - (x < y);
+}
 
-    PROCESS_MEMORY_COUNTERS_EX pmc = {0};
-    if (!GetProcessMemoryInfo(hProcess, (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) {
-        CloseHandle(hProcess);
-        return 0;
-    }
+// One Toolhelp pass fills the thread count of every requested PID (0 if not found)
+static void snapshot_thread_counts(const DWORD *pids, const int n, DWORD *threads_out) {
+    memset(threads_out, 0, (size_t)n * sizeof(DWORD));
 
-    DWORD handleCount = 0;
-    GetProcessHandleCount(hProcess, &handleCount);
+    PidIndex single;
+    PidIndex *sorted = (n == 1) ? &single : (PidIndex*)malloc((size_t)n * sizeof(PidIndex));
+    if (!sorted) return;
+    for (int i = 0; i < n; i++) {
+        sorted[i].pid = pids[i];
+        sorted[i].index = i;
+    }
+    qsort(sorted, (size_t)n, sizeof(PidIndex), cmp_pid_index);
 
-    DWORD threadCount = 0;
     PROCESSENTRY32 pe32 = {0};
     pe32.dwSize = sizeof(PROCESSENTRY32);
     // ReSharper disable once CppLocalVariableMayBeConst
@@ -165,196 +725,2107 @@ int end_metrics_collection(const DWORD pid, const DWORD metrics, char *json_buf,
     if (hSnap != INVALID_HANDLE_VALUE) {
         if (Process32First(hSnap, &pe32)) {
             do {
-                if (pe32.th32ProcessID == pid) {
-                    threadCount = pe32.cntThreads;
-                    break;
-                }
+                PidIndex key;
+                key.pid = pe32.th32ProcessID;
+                const PidIndex *hit = (const PidIndex*)bsearch(&key, sorted, (size_t)n, sizeof(PidIndex), cmp_pid_index);
+                if (!hit) continue;
+                // The caller may list a PID more than once
+                while (hit > sorted && (hit - 1)->pid == key.pid) hit--;
+                for (; hit < sorted + n && hit->pid == key.pid; hit++) threads_out[hit->index] = pe32.cntThreads;
             } while (Process32Next(hSnap, &pe32));
         }
         CloseHandle(hSnap);
     }
+    if (sorted != &single) free(sorted);
+}
 
-    IO_COUNTERS ioCounters = {0};
-    GetProcessIoCounters(hProcess, &ioCounters);
+// Per-process network counters. One pass over the TCP/UDP owner tables serves every
+// process sampled at the same time (a batch call or one scheduler tick). Byte counts come
+// from TCP extended statistics, which Windows only collects after they are enabled per
+// connection (requires elevation): each pass reads the established connections of the
+// requested processes and adds the growth since the previous pass to a running total kept
+// on the process's cache entry.
+typedef struct {
+    DWORD tcp;                           // TCP connections, IPv4 + IPv6
+    DWORD udp;                           // UDP endpoints, IPv4 + IPv6
+    unsigned long long rx, tx;           // TCP payload bytes observed while tracked
+} NetCounters;
 
-    // Calculate deltas for CPU and IO
-    double cpu = 0.0;
-    if (metrics & METRIC_CPU_USAGE) {
-        FILETIME sysIdle, sysKernel, sysUser;
-        FILETIME procCreation, procExit, procKernel, procUser;
-        GetSystemTimes(&sysIdle, &sysKernel, &sysUser);
-        GetProcessTimes(hProcess, &procCreation, &procExit, &procKernel, &procUser);
+typedef struct {
+    DWORD family;
+    BYTE localAddr[16];
+    DWORD localPort;
+    BYTE remoteAddr[16];
+    DWORD remotePort;
+} NetConnKey;
 
-        const ULONGLONG sysStart = fileTimeToInt(g_session.sysKernelStart) + fileTimeToInt(g_session.sysUserStart);
-        const ULONGLONG sysEnd = fileTimeToInt(sysKernel) + fileTimeToInt(sysUser);
-        const ULONGLONG procStart = fileTimeToInt(g_session.procKernelStart) + fileTimeToInt(g_session.procUserStart);
-        const ULONGLONG procEnd = fileTimeToInt(procKernel) + fileTimeToInt(procUser);
+typedef struct {
+    NetConnKey key;
+    DWORD pid;
+    ULONG64 lastRx, lastTx;              // EStats totals at the previous pass
+} NetConn;
 
-        const ULONGLONG sysDelta = sysEnd - sysStart;
-        const ULONGLONG procDelta = procEnd - procStart;
-        if (sysDelta != 0)
-            cpu = ((double)procDelta / (double)sysDelta) * 100.0;
-    }
+typedef struct {
+    void *data;
+    DWORD size;
+} NetTableBuf;
 
-    unsigned long long io_r = 0, io_w = 0;
-    if (metrics & METRIC_IO) {
-        io_r = (ioCounters.ReadTransferCount - g_session.ioStart.ReadTransferCount) / 1024;
-        io_w = (ioCounters.WriteTransferCount - g_session.ioStart.WriteTransferCount) / 1024;
-    }
+static SRWLOCK g_netLock = SRWLOCK_INIT;
+static NetConn *g_netConns = NULL;       // sorted by key, guarded by g_netLock
+static int g_netConnCount = 0;
+static NetTableBuf g_netTables[4];       // TCP4, TCP6, UDP4, UDP6, reused across passes
 
-    const size_t ws = pmc.WorkingSetSize / 1024;
-    const size_t priv = pmc.PrivateUsage / 1024;
-    const size_t pf = pmc.PagefileUsage / 1024;
+static int cmp_net_conn(const void *a, const void *b) {
+    return memcmp(&((const NetConn*)a)->key, &((const NetConn*)b)->key, sizeof(NetConnKey));
+}
 
-    build_metrics_json(json_buf, json_buflen, pid, metrics, ws, priv, pf, handleCount, threadCount, cpu, io_r, io_w);
+// Fetches one owner-PID table into its reusable buffer, growing it as needed
+static void *net_fetch_table(const int which) {
+    NetTableBuf *buf = &g_netTables[which];
+    const ULONG family = (which == 0 || which == 2) ? AF_INET : AF_INET6;
+    for (int attempt = 0; attempt < 4; attempt++) {
+        DWORD size = buf->size;
+        const DWORD rc = (which < 2)
+            ? GetExtendedTcpTable(buf->data, &size, FALSE, family, TCP_TABLE_OWNER_PID_ALL, 0)
+            : GetExtendedUdpTable(buf->data, &size, FALSE, family, UDP_TABLE_OWNER_PID, 0);
+        if (rc == NO_ERROR) return buf->data;
+        if (rc != ERROR_INSUFFICIENT_BUFFER) return NULL;
+        // Headroom for connections opened before the retry
+        size += size / 4 + 1024;
+        void *grown = realloc(buf->data, size);
+        if (!grown) return NULL;
+        buf->data = grown;
+        buf->size = size;
+    }
+    return NULL;
+}
 
-    CloseHandle(hProcess);
-    g_session.active = 0;
+// Reads the EStats data byte totals of one connection, enabling collection on first sight
+static int net_read_bytes(const NetConnKey *key, const int enable, ULONG64 *rx, ULONG64 *tx) {
+    TCP_ESTATS_DATA_ROD_v0 rod = {0};
+    TCP_ESTATS_DATA_RW_v0 rw = {0};
+    rw.EnableCollection = TRUE;
+    ULONG rc;
+    if (key->family == AF_INET) {
+        MIB_TCPROW row = {0};
+        row.dwState = MIB_TCP_STATE_ESTAB;
+        memcpy(&row.dwLocalAddr, key->localAddr, 4);
+        row.dwLocalPort = key->localPort;
+        memcpy(&row.dwRemoteAddr, key->remoteAddr, 4);
+        row.dwRemotePort = key->remotePort;
+        if (enable) SetPerTcpConnectionEStats(&row, TcpConnectionEstatsData, (PUCHAR)&rw, 0, sizeof(rw), 0);
+        rc = GetPerTcpConnectionEStats(&row, TcpConnectionEstatsData, NULL, 0, 0, NULL, 0, 0,
+                                       (PUCHAR)&rod, 0, sizeof(rod));
+    } else {
+        MIB_TCP6ROW row = {0};
+        row.State = MIB_TCP_STATE_ESTAB;
+        memcpy(&row.LocalAddr, key->localAddr, 16);
+        row.dwLocalPort = key->localPort;
+        memcpy(&row.RemoteAddr, key->remoteAddr, 16);
+        row.dwRemotePort = key->remotePort;
+        if (enable) SetPerTcp6ConnectionEStats(&row, TcpConnectionEstatsData, (PUCHAR)&rw, 0, sizeof(rw), 0);
+        rc = GetPerTcp6ConnectionEStats(&row, TcpConnectionEstatsData, NULL, 0, 0, NULL, 0, 0,
+                                        (PUCHAR)&rod, 0, sizeof(rod));
+    }
+    if (rc != NO_ERROR) return 0;
+    *rx = rod.DataBytesIn;
+    *tx = rod.DataBytesOut;
     return 1;
 }
 
-__declspec(dllexport)
-int get_metrics_json(const DWORD pid, const DWORD metrics, char *json_buf, const size_t json_buflen) {
-    if (!json_buf || json_buflen == 0) return 0;
-
-    // ReSharper disable once CppLocalVariableMayBeConst
-    HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, pid);
-    if (!hProcess) return 0;
-
-    PROCESS_MEMORY_COUNTERS_EX pmc = {0};
-    if (!GetProcessMemoryInfo(hProcess, (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) {
-        CloseHandle(hProcess);
-        return 0;
+// Accounts one TCP row; appends it to next[] if its connection is (still) tracked
+static void net_account_tcp(const NetConnKey *key, const DWORD state, const DWORD pid,
+                            const PidIndex *sorted, const int nSorted, ProcEntry *const *entries,
+                            NetCounters *out, NetConn *next, int *nNext) {
+    PidIndex probe;
+    probe.pid = pid;
+    const PidIndex *hit = (const PidIndex*)bsearch(&probe, sorted, (size_t)nSorted, sizeof(PidIndex), cmp_pid_index);
+    if (hit) {
+        while (hit > sorted && (hit - 1)->pid == pid) hit--;
+        for (const PidIndex *h = hit; h < sorted + nSorted && h->pid == pid; h++) out[h->index].tcp++;
     }
 
-    DWORD handleCount = 0;
-    GetProcessHandleCount(hProcess, &handleCount);
+    NetConn probeConn;
+    probeConn.key = *key;
+    const NetConn *prev = g_netConnCount
+        ? (const NetConn*)bsearch(&probeConn, g_netConns, (size_t)g_netConnCount, sizeof(NetConn), cmp_net_conn)
+        : NULL;
+    if (prev && prev->pid != pid) prev = NULL;  // same 4-tuple now owned by another process
+    if (!hit && !prev) return;
 
-    DWORD threadCount = 0;
-    PROCESSENTRY32 pe32 = {0};
-    pe32.dwSize = sizeof(PROCESSENTRY32);
-    // ReSharper disable once CppLocalVariableMayBeConst
-    HANDLE hSnap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-    if (hSnap != INVALID_HANDLE_VALUE) {
-        if (Process32First(hSnap, &pe32)) {
-            do {
-                if (pe32.th32ProcessID == pid) {
-                    threadCount = pe32.cntThreads;
-                    break;
-                }
-            } while (Process32Next(hSnap, &pe32));
+    NetConn conn = prev ? *prev : probeConn;
+    if (!prev) {
+        conn.pid = pid;
+        conn.lastRx = conn.lastTx = 0;
+    }
+    if (hit && state == MIB_TCP_STATE_ESTAB) {
+        ULONG64 rx, tx;
+        if (net_read_bytes(key, !prev, &rx, &tx)) {
+            // New connections only set the baseline, so bytes from before tracking are not counted
+            if (prev) {
+                entries[hit->index]->netRx += rx >= conn.lastRx ? rx - conn.lastRx : rx;
+                entries[hit->index]->netTx += tx >= conn.lastTx ? tx - conn.lastTx : tx;
+            }
+            conn.lastRx = rx;
+            conn.lastTx = tx;
         }
-        CloseHandle(hSnap);
     }
+    next[(*nNext)++] = conn;
+}
 
-    IO_COUNTERS ioCounters = {0};
-    GetProcessIoCounters(hProcess, &ioCounters);
-
-    const size_t ws = pmc.WorkingSetSize / 1024;
-    const size_t priv = pmc.PrivateUsage / 1024;
-    const size_t pf = pmc.PagefileUsage / 1024;
-    const double cpu = get_cpu_usage(hProcess);
-    const unsigned long long io_r = ioCounters.ReadTransferCount / 1024;
-    const unsigned long long io_w = ioCounters.WriteTransferCount / 1024;
+// Fills out[i] for every non-NULL entries[i] with a single pass over the connection tables
+static void snapshot_net_counters(ProcEntry *const *entries, const int n, NetCounters *out) {
+    memset(out, 0, (size_t)n * sizeof(NetCounters));
 
-    build_metrics_json(json_buf, json_buflen, pid, metrics, ws, priv, pf, handleCount, threadCount, cpu, io_r, io_w);
+    PidIndex *sorted = (PidIndex*)malloc((size_t)n * sizeof(PidIndex));
+    if (!sorted) return;
+    int nSorted = 0;
+    for (int i = 0; i < n; i++) {
+        if (!entries[i]) continue;
+        sorted[nSorted].pid = entries[i]->pid;
+        sorted[nSorted].index = i;
+        nSorted++;
+    }
+    qsort(sorted, (size_t)nSorted, sizeof(PidIndex), cmp_pid_index);
 
-    CloseHandle(hProcess);
-    return 1;
-}
+    AcquireSRWLockExclusive(&g_netLock);
+    const MIB_TCPTABLE_OWNER_PID *tcp4 = (const MIB_TCPTABLE_OWNER_PID*)net_fetch_table(0);
+    const MIB_TCP6TABLE_OWNER_PID *tcp6 = (const MIB_TCP6TABLE_OWNER_PID*)net_fetch_table(1);
 
-// Thread function to collect metrics at regular intervals
-// ReSharper disable once CppParameterMayBeConst
-DWORD WINAPI MonitoringThreadProc(LPVOID lpParam) {
-    MonitoringContext* ctx = (MonitoringContext*)lpParam;
-    const DWORD startTime = GetTickCount();
-    char buffer[2048];  // Buffer for JSON metrics
-
-    while (ctx->isRunning) {
-        // Collect and send metrics
-        if (get_metrics_json(ctx->pid, ctx->metrics, buffer, sizeof(buffer))) {
-            if (ctx->callbackFn) {
-                ctx->callbackFn(buffer, ctx->userData);
-            }
+    // Connections of untracked processes are skipped, so this bounds the next table
+    const size_t capacity = (size_t)(tcp4 ? tcp4->dwNumEntries : 0) + (tcp6 ? tcp6->dwNumEntries : 0);
+    NetConn *next = capacity ? (NetConn*)malloc(capacity * sizeof(NetConn)) : NULL;
+    int nNext = 0;
+    if (next) {
+        for (DWORD r = 0; tcp4 && r < tcp4->dwNumEntries; r++) {
+            const MIB_TCPROW_OWNER_PID *row = &tcp4->table[r];
+            NetConnKey key;
+            memset(&key, 0, sizeof(key));
+            key.family = AF_INET;
+            memcpy(key.localAddr, &row->dwLocalAddr, 4);
+            key.localPort = row->dwLocalPort;
+            memcpy(key.remoteAddr, &row->dwRemoteAddr, 4);
+            key.remotePort = row->dwRemotePort;
+            net_account_tcp(&key, row->dwState, row->dwOwningPid, sorted, nSorted, entries, out, next, &nNext);
         }
-
-        // Check if we need to stop based on duration
-        if (ctx->totalDurationMs > 0) {
-            const DWORD currentTime = GetTickCount();
-            if (currentTime - startTime >= (DWORD)ctx->totalDurationMs) {
-                break;
-            }
+        for (DWORD r = 0; tcp6 && r < tcp6->dwNumEntries; r++) {
+            const MIB_TCP6ROW_OWNER_PID *row = &tcp6->table[r];
+            NetConnKey key;
+            memset(&key, 0, sizeof(key));
+            key.family = AF_INET6;
+            memcpy(key.localAddr, row->ucLocalAddr, 16);
+            key.localPort = row->dwLocalPort;
+            memcpy(key.remoteAddr, row->ucRemoteAddr, 16);
+            key.remotePort = row->dwRemotePort;
+            net_account_tcp(&key, row->dwState, row->dwOwningPid, sorted, nSorted, entries, out, next, &nNext);
         }
+        // Connections missing from the tables have closed; dropping them here keeps the
+        // tracked set bounded by what is currently open
+        qsort(next, (size_t)nNext, sizeof(NetConn), cmp_net_conn);
+        free(g_netConns);
+        g_netConns = next;
+        g_netConnCount = nNext;
+    }
 
-        // Sleep for the interval period
-        Sleep(ctx->intervalMs);
+    const MIB_UDPTABLE_OWNER_PID *udp4 = (const MIB_UDPTABLE_OWNER_PID*)net_fetch_table(2);
+    const MIB_UDP6TABLE_OWNER_PID *udp6 = (const MIB_UDP6TABLE_OWNER_PID*)net_fetch_table(3);
+    for (int family = 0; family < 2; family++) {
+        const DWORD rows = family == 0 ? (udp4 ? udp4->dwNumEntries : 0) : (udp6 ? udp6->dwNumEntries : 0);
+        for (DWORD r = 0; r < rows; r++) {
+            PidIndex probe;
+            probe.pid = family == 0 ? udp4->table[r].dwOwningPid : udp6->table[r].dwOwningPid;
+            const PidIndex *hit = (const PidIndex*)bsearch(&probe, sorted, (size_t)nSorted, sizeof(PidIndex), cmp_pid_index);
+            if (!hit) continue;
+            while (hit > sorted && (hit - 1)->pid == probe.pid) hit--;
+            for (; hit < sorted + nSorted && hit->pid == probe.pid; hit++) out[hit->index].udp++;
+        }
     }
 
-    ctx->isRunning = 0;
-    return 0;
+    for (int i = 0; i < n; i++) {
+        if (!entries[i]) continue;
+        out[i].rx = entries[i]->netRx;
+        out[i].tx = entries[i]->netTx;
+    }
+    ReleaseSRWLockExclusive(&g_netLock);
+    free(sorted);
 }
 
-__declspec(dllexport)
-int start_metrics_monitoring(
-    const DWORD pid,
-    const DWORD metrics,
-    const DWORD intervalMs,
-    const int totalDurationMs,
-    void (*callbackFn)(const char*, void*),
-    void* userData) {
+// Reads every requested metric except the thread and network counts; IO is absolute here.
+// CPU is computed against cpuState, or against the entry's shared state when it is NULL.
+static int collect_sample(ProcEntry *entry, const DWORD metrics, MetricsSample *sample, CpuState *cpuState) {
+    // ReSharper disable once CppLocalVariableMayBeConst
+    HANDLE hProcess = entry->hProcess;
+    memset(sample, 0, sizeof(*sample));
+    sample->pid = entry->pid;
+    LONGLONG t = qpc_now();
+    sample->timestamp_us = qpc_to_us(t);
+    const int profile = (metrics & METRIC_SELF_PROFILE) != 0;
 
-    // Don't start if already running
-    if (g_monitorContext.isRunning) {
-        return 0;
+    if (metrics & (METRIC_WORKING_SET | METRIC_PRIVATE_BYTES | METRIC_PAGEFILE)) {
+        PROCESS_MEMORY_COUNTERS_EX pmc = {0};
+        if (!GetProcessMemoryInfo(hProcess, (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) return 0;
+        sample->ws = pmc.WorkingSetSize / 1024;
+        sample->priv = pmc.PrivateUsage / 1024;
+        sample->pf = pmc.PagefileUsage / 1024;
+        if (profile) t = profile_phase(sample, PROFILE_MEMORY, t);
     }
-
-    // Setup monitoring context
-    g_monitorContext.pid = pid;
-    g_monitorContext.metrics = metrics;
-    g_monitorContext.intervalMs = intervalMs;
-    g_monitorContext.totalDurationMs = totalDurationMs;
-    g_monitorContext.isRunning = 1;
-    g_monitorContext.callbackFn = callbackFn;
-    g_monitorContext.userData = userData;
-
-    // Create the monitoring thread
-    g_monitorContext.threadHandle = CreateThread(
-        NULL,
-        0,
-        MonitoringThreadProc,
-        &g_monitorContext,
-        0,
-        NULL
-    );
-
-    if (g_monitorContext.threadHandle == NULL) {
-        g_monitorContext.isRunning = 0;
-        return 0;
+    if (metrics & METRIC_HANDLES) {
+        GetProcessHandleCount(hProcess, &sample->handles);
+        if (profile) t = profile_phase(sample, PROFILE_HANDLES, t);
     }
-
+    if (metrics & METRIC_CPU_USAGE) {
+        if (cpuState) {
+            get_cpu_usage(hProcess, entry->creationTime, cpuState, &sample->cpu, &sample->cpu_user, &sample->cpu_kernel);
+        } else {
+            AcquireSRWLockExclusive(&entry->cpuLock);
+            get_cpu_usage(hProcess, entry->creationTime, &entry->cpu, &sample->cpu, &sample->cpu_user, &sample->cpu_kernel);
+            ReleaseSRWLockExclusive(&entry->cpuLock);
+        }
+        if (profile) t = profile_phase(sample, PROFILE_CPU, t);
+    }
+    if (metrics & METRIC_IO) {
+        IO_COUNTERS ioCounters = {0};
+        GetProcessIoCounters(hProcess, &ioCounters);
+        sample->io_r = ioCounters.ReadTransferCount / 1024;
+        sample->io_w = ioCounters.WriteTransferCount / 1024;
+        if (profile) profile_phase(sample, PROFILE_IO, t);
+    }
+    if (profile) sample->sampler_cpu_us = thread_cpu_us();
     return 1;
 }
 
-__declspec(dllexport)
-int stop_metrics_monitoring() {
-    if (!g_monitorContext.isRunning) {
-        return 0;
+static void sample_to_json(char *buf, const size_t buflen, const DWORD metrics, const MetricsSample *s) {
+    build_metrics_json(buf, buflen, s->pid, metrics, s->ws, s->priv, s->pf, s->handles, s->threads,
+                       s->cpu, s->io_r, s->io_w);
+    if (metrics & METRIC_CPU_USAGE) {
+        const size_t n = strlen(buf);
+        if (n == 0 || buf[n - 1] != '}') return;
+        snprintf(buf + n - 1, buflen - (n - 1), ",\"cpu_user\":%.2f,\"cpu_kernel\":%.2f}", s->cpu_user, s->cpu_kernel);
     }
+    if (metrics & METRIC_NET) {
+        const size_t n = strlen(buf);
+        if (n == 0 || buf[n - 1] != '}') return;
+        snprintf(buf + n - 1, buflen - (n - 1),
+                 ",\"tcp_connections\":%lu,\"udp_endpoints\":%lu,\"net_rx_bytes\":%llu,\"net_tx_bytes\":%llu}",
+                 s->tcp, s->udp, s->net_rx, s->net_tx);
+    }
+    if (metrics & METRIC_SELF_PROFILE) {
+        const size_t n = strlen(buf);
+        if (n == 0 || buf[n - 1] != '}') return;
+        const DWORD *ph = s->phase_ns;
+        snprintf(buf + n - 1, buflen - (n - 1),
+                 ",\"profile\":{\"sampler_cpu_us\":%llu,\"open_ns\":%lu,\"memory_ns\":%lu,\"handles_ns\":%lu,"
+                 "\"threads_ns\":%lu,\"cpu_ns\":%lu,\"io_ns\":%lu,\"net_ns\":%lu,\"format_ns\":%lu,"
+                 "\"callback_ns\":%lu}}",
+                 s->sampler_cpu_us, ph[PROFILE_OPEN], ph[PROFILE_MEMORY], ph[PROFILE_HANDLES],
+                 ph[PROFILE_THREADS], ph[PROFILE_CPU], ph[PROFILE_IO], ph[PROFILE_NET],
+                 ph[PROFILE_FORMAT], ph[PROFILE_CALLBACK]);
+    }
+}
 
-    // Signal the thread to stop
-    g_monitorContext.isRunning = 0;
-
-    // Wait for the thread to exit
-    if (g_monitorContext.threadHandle != NULL) {
-        WaitForSingleObject(g_monitorContext.threadHandle, 5000);  // Wait up to 5 seconds
-        CloseHandle(g_monitorContext.threadHandle);
-        g_monitorContext.threadHandle = NULL;
+// Thread and network counts for one process, each from a single system-wide pass
+static void fill_snapshot_counts(ProcEntry *entry, const DWORD metrics, MetricsSample *sample) {
+    const int profile = (metrics & METRIC_SELF_PROFILE) != 0;
+    LONGLONG t = profile ? qpc_now() : 0;
+    if (metrics & METRIC_THREADS) {
+        snapshot_thread_counts(&sample->pid, 1, &sample->threads);
+        if (profile) t = profile_phase(sample, PROFILE_THREADS, t);
+    }
+    if (metrics & METRIC_NET) {
+        NetCounters net;
+        snapshot_net_counters(&entry, 1, &net);
+        sample->tcp = net.tcp;
+        sample->udp = net.udp;
+        sample->net_rx = net.rx;
+        sample->net_tx = net.tx;
+        if (profile) profile_phase(sample, PROFILE_NET, t);
     }
+}
 
-    return 1;
+// Adds the monitor timing fields to an object written by sample_to_json
+static void append_schedule_json(char *buf, const size_t buflen, const MetricsSample *s) {
+    const size_t n = strlen(buf);
+    if (n == 0 || buf[n - 1] != '}') return;
+    snprintf(buf + n - 1, buflen - (n - 1), ",\"timestamp_us\":%llu,\"missed\":%lu,\"late_us\":%lu}",
+             s->timestamp_us, s->missed, s->late_us);
 }
 
-__declspec(dllexport)
-int is_metrics_monitoring_active() {
-    return g_monitorContext.isRunning;
+static void sample_to_record(METRICS_RECORD *rec, const DWORD metrics, const MetricsSample *s) {
+    memset(rec, 0, sizeof(*rec));
+    rec->version = METRICS_RECORD_VERSION;
+    rec->size = (unsigned short)sizeof(METRICS_RECORD);
+    rec->pid = s->pid;
+    rec->metrics = metrics;
+    rec->status = METRICS_STATUS_OK;
+    rec->working_set_kb = s->ws;
+    rec->private_kb = s->priv;
+    rec->pagefile_kb = s->pf;
+    rec->handles = s->handles;
+    rec->threads = s->threads;
+    rec->cpu = s->cpu;
+    rec->io_read_kb = s->io_r;
+    rec->io_write_kb = s->io_w;
+    rec->timestamp_us = s->timestamp_us;
+    rec->missed = s->missed;
+    rec->late_us = s->late_us;
+    rec->tcp_connections = s->tcp;
+    rec->udp_endpoints = s->udp;
+    rec->net_rx_bytes = s->net_rx;
+    rec->net_tx_bytes = s->net_tx;
+    rec->cpu_user = s->cpu_user;
+    rec->cpu_kernel = s->cpu_kernel;
+    rec->sampler_cpu_us = s->sampler_cpu_us;
+    memcpy(rec->phase_ns, s->phase_ns, sizeof(rec->phase_ns));
+}
+
+static void unavailable_record(METRICS_RECORD *rec, const DWORD pid) {
+    memset(rec, 0, sizeof(*rec));
+    rec->version = METRICS_RECORD_VERSION;
+    rec->size = (unsigned short)sizeof(METRICS_RECORD);
+    rec->pid = pid;
+    rec->status = METRICS_STATUS_UNAVAILABLE;
+}
+
+static int capture_start_state(const DWORD pid, const DWORD metrics, MetricsSession *session) {
+    ProcEntry *entry = proc_acquire(pid);
+    if (!entry) return 0;
+    // ReSharper disable once CppLocalVariableMayBeConst
+    HANDLE hProcess = entry->hProcess;
+
+    IO_COUNTERS ioCounters = {0};
+
+    if (metrics & METRIC_CPU_USAGE) {
+        if (!cpu_baseline(hProcess, &session->cpuStart)) {
+            proc_release(entry);
+            return 0;
+        }
+    }
+    if (metrics & METRIC_IO) {
+        GetProcessIoCounters(hProcess, &ioCounters);
+        session->ioStart = ioCounters;
+    }
+    if (metrics & METRIC_NET) {
+        NetCounters net;
+        snapshot_net_counters(&entry, 1, &net);
+        session->netRxStart = net.rx;
+        session->netTxStart = net.tx;
+    }
+    session->pid = pid;
+    session->metrics = metrics;
+    session->creationTime = entry->creationTime;
+    session->active = 1;
+    proc_release(entry);
+    return 1;
+}
+
+// Restarting a (pid, metrics) pair replaces its session; other pairs are left untouched
+__declspec(dllexport)
+int start_metrics_collection(const DWORD pid, const DWORD metrics) {
+    MetricsSession session = {0};
+    if (!capture_start_state(pid, metrics, &session)) return 0;
+
+    AcquireSRWLockExclusive(&g_sessionLock);
+    MetricsSession *slot = NULL;
+    for (int i = 0; i < MAX_SESSIONS && !slot; i++) {
+        if (g_sessions[i].active && g_sessions[i].pid == pid && g_sessions[i].metrics == metrics)
+            slot = &g_sessions[i];
+    }
+    for (int i = 0; i < MAX_SESSIONS && !slot; i++) {
+        if (!g_sessions[i].active) slot = &g_sessions[i];
+    }
+    if (slot) *slot = session;
+    ReleaseSRWLockExclusive(&g_sessionLock);
+    return slot != NULL;
+}
+
+// Removes and returns the session for (pid, metrics), if one is open
+static int take_session(const DWORD pid, const DWORD metrics, MetricsSession *out) {
+    int found = 0;
+    AcquireSRWLockExclusive(&g_sessionLock);
+    for (int i = 0; i < MAX_SESSIONS && !found; i++) {
+        if (g_sessions[i].active && g_sessions[i].pid == pid && g_sessions[i].metrics == metrics) {
+            *out = g_sessions[i];
+            g_sessions[i].active = 0;
+            found = 1;
+        }
+    }
+    ReleaseSRWLockExclusive(&g_sessionLock);
+    return found;
+}
+
+// Session end shared by the JSON and record variants; memory/handles/threads are
+// instantaneous while CPU and IO are deltas against start_metrics_collection()
+static int end_collection_sample(const DWORD pid, const DWORD metrics, MetricsSample *sample) {
+    MetricsSession session;
+    if (!take_session(pid, metrics, &session)) return 0;
+
+    const int profile = (metrics & METRIC_SELF_PROFILE) != 0;
+    const LONGLONG openStart = profile ? qpc_now() : 0;
+    ProcEntry *entry = proc_acquire(pid);
+    if (!entry) return 0;
+    const LONGLONG openTicks = profile ? qpc_now() - openStart : 0;
+    // The PID now belongs to a different process than the one the session started on
+    if (entry->creationTime != session.creationTime) {
+        proc_release(entry);
+        return 0;
+    }
+    // ReSharper disable once CppLocalVariableMayBeConst
+    HANDLE hProcess = entry->hProcess;
+
+    // CPU and IO are reported as deltas against the session start instead
+    if (!collect_sample(entry, metrics & ~(METRIC_CPU_USAGE | METRIC_IO), sample, NULL)) {
+        proc_release(entry);
+        return 0;
+    }
+    if (profile) profile_add(sample, PROFILE_OPEN, openTicks);
+    fill_snapshot_counts(entry, metrics, sample);
+    if (metrics & METRIC_NET) {
+        // Connection counts are instantaneous, bytes are a delta like IO
+        sample->net_rx = sample->net_rx >= session.netRxStart ? sample->net_rx - session.netRxStart : 0;
+        sample->net_tx = sample->net_tx >= session.netTxStart ? sample->net_tx - session.netTxStart : 0;
+    }
+
+    // Calculate deltas for CPU and IO
+    LONGLONG t = profile ? qpc_now() : 0;
+    if (metrics & METRIC_CPU_USAGE) {
+        get_cpu_usage(hProcess, entry->creationTime, &session.cpuStart, &sample->cpu, &sample->cpu_user, &sample->cpu_kernel);
+        if (profile) t = profile_phase(sample, PROFILE_CPU, t);
+    }
+
+    if (metrics & METRIC_IO) {
+        IO_COUNTERS ioCounters = {0};
+        GetProcessIoCounters(hProcess, &ioCounters);
+        sample->io_r = (ioCounters.ReadTransferCount - session.ioStart.ReadTransferCount) / 1024;
+        sample->io_w = (ioCounters.WriteTransferCount - session.ioStart.WriteTransferCount) / 1024;
+        if (profile) profile_phase(sample, PROFILE_IO, t);
+    }
+    if (profile) sample->sampler_cpu_us = thread_cpu_us();
+
+    proc_release(entry);
+    return 1;
+}
+
+__declspec(dllexport)
+int end_metrics_collection(const DWORD pid, const DWORD metrics, char *json_buf, const size_t json_buflen) {
+    if (!json_buf || json_buflen == 0) return 0;
+
+    MetricsSample sample;
+    if (!end_collection_sample(pid, metrics, &sample)) return 0;
+    sample_to_json(json_buf, json_buflen, metrics, &sample);
+    return 1;
+}
+
+__declspec(dllexport)
+int end_metrics_collection_record(const DWORD pid, const DWORD metrics, METRICS_RECORD *out) {
+    if (!out) return 0;
+
+    MetricsSample sample;
+    if (!end_collection_sample(pid, metrics, &sample)) return 0;
+    sample_to_record(out, metrics, &sample);
+    return 1;
+}
+
+static int snapshot_sample(const DWORD pid, const DWORD metrics, MetricsSample *sample) {
+    const int profile = (metrics & METRIC_SELF_PROFILE) != 0;
+    const LONGLONG openStart = profile ? qpc_now() : 0;
+    ProcEntry *entry = proc_acquire(pid);
+    if (!entry) return 0;
+    const LONGLONG openTicks = profile ? qpc_now() - openStart : 0;
+
+    const int ok = collect_sample(entry, metrics, sample, NULL);
+    if (ok && profile) profile_add(sample, PROFILE_OPEN, openTicks);
+    if (ok) fill_snapshot_counts(entry, metrics, sample);
+    proc_release(entry);
+    return ok;
+}
+
+__declspec(dllexport)
+int get_metrics_json(const DWORD pid, const DWORD metrics, char *json_buf, const size_t json_buflen) {
+    if (!json_buf || json_buflen == 0) return 0;
+
+    MetricsSample sample;
+    if (!snapshot_sample(pid, metrics, &sample)) return 0;
+    sample_to_json(json_buf, json_buflen, metrics, &sample);
+    return 1;
+}
+
+__declspec(dllexport)
+int get_metrics_record(const DWORD pid, const DWORD metrics, METRICS_RECORD *out) {
+    if (!out) return 0;
+
+    MetricsSample sample;
+    if (!snapshot_sample(pid, metrics, &sample)) return 0;
+    sample_to_record(out, metrics, &sample);
+    return 1;
+}
+
+// Samples every PID into samples[]/valid[] with a single Toolhelp pass for thread counts.
+// Returns the number of PIDs sampled, or -1 on allocation failure.
+static int sample_batch(const DWORD *pids, const int n, const DWORD metrics, MetricsSample *samples, int *valid) {
+    ProcEntry **entries = (ProcEntry**)calloc((size_t)n, sizeof(ProcEntry*));
+    if (!entries) return -1;
+
+    const int profile = (metrics & METRIC_SELF_PROFILE) != 0;
+    int sampled = 0;
+    for (int i = 0; i < n; i++) {
+        valid[i] = 0;
+        const LONGLONG openStart = profile ? qpc_now() : 0;
+        entries[i] = proc_acquire(pids[i]);
+        if (!entries[i]) continue;
+        const LONGLONG openTicks = profile ? qpc_now() - openStart : 0;
+        valid[i] = collect_sample(entries[i], metrics, &samples[i], NULL);
+        if (valid[i] && profile) profile_add(&samples[i], PROFILE_OPEN, openTicks);
+        sampled += valid[i];
+    }
+    if (metrics & METRIC_THREADS) {
+        DWORD *threads = (DWORD*)calloc((size_t)n, sizeof(DWORD));
+        if (threads) {
+            const LONGLONG start = qpc_now();
+            snapshot_thread_counts(pids, n, threads);
+            const LONGLONG ticks = qpc_now() - start;
+            for (int i = 0; i < n; i++) {
+                samples[i].threads = threads[i];
+                if (profile) profile_add(&samples[i], PROFILE_THREADS, ticks);
+            }
+            free(threads);
+        }
+    }
+    if (metrics & METRIC_NET) {
+        NetCounters *net = (NetCounters*)calloc((size_t)n, sizeof(NetCounters));
+        if (net) {
+            const LONGLONG start = qpc_now();
+            snapshot_net_counters(entries, n, net);
+            const LONGLONG ticks = qpc_now() - start;
+            for (int i = 0; i < n; i++) {
+                samples[i].tcp = net[i].tcp;
+                samples[i].udp = net[i].udp;
+                samples[i].net_rx = net[i].rx;
+                samples[i].net_tx = net[i].tx;
+                if (profile) profile_add(&samples[i], PROFILE_NET, ticks);
+            }
+            free(net);
+        }
+    }
+    for (int i = 0; i < n; i++) proc_release(entries[i]);
+    free(entries);
+    return sampled;
+}
+
+// Samples many processes with a single system snapshot and writes a JSON array with one
+// object per requested PID, in order. PIDs that cannot be sampled appear as
+// {"pid":N,"error":"unavailable"}. Returns the number of PIDs sampled, or -1 if json_buf
+// is too small.
+__declspec(dllexport)
+int get_metrics_batch(const DWORD *pids, const int n, const DWORD metrics, char *json_buf, const size_t json_buflen) {
+    if (!pids || n <= 0 || !json_buf || json_buflen == 0) return 0;
+
+    MetricsSample *samples = (MetricsSample*)calloc((size_t)n, sizeof(MetricsSample));
+    int *valid = (int*)calloc((size_t)n, sizeof(int));
+    const int sampled = (samples && valid) ? sample_batch(pids, n, metrics, samples, valid) : -1;
+    if (sampled < 0) {
+        free(samples);
+        free(valid);
+        return 0;
+    }
+
+    // Each record is formatted on its own so an undersized buffer is detected, not overrun
+    char record[1024];
+    size_t used = 0;
+    int result = sampled;
+    for (int i = 0; i < n && result >= 0; i++) {
+        if (valid[i]) sample_to_json(record, sizeof(record), metrics, &samples[i]);
+        else snprintf(record, sizeof(record), "{\"pid\":%lu,\"error\":\"unavailable\"}", pids[i]);
+        const size_t len = strlen(record);
+        // '[' or ',' before the record, plus "]\0" after the last one
+        if (used + 1 + len + 2 > json_buflen) {
+            result = -1;
+            break;
+        }
+        json_buf[used++] = (i == 0) ? '[' : ',';
+        memcpy(json_buf + used, record, len);
+        used += len;
+    }
+    if (result >= 0) {
+        json_buf[used++] = ']';
+        json_buf[used] = '\0';
+    } else {
+        json_buf[0] = '\0';
+    }
+
+    free(samples);
+    free(valid);
+    return result;
+}
+
+// Binary variant of get_metrics_batch: fills out[0..n-1] in PID order, with status set to
+// METRICS_STATUS_UNAVAILABLE for PIDs that could not be sampled. Returns the number of
+// PIDs sampled.
+__declspec(dllexport)
+int get_metrics_batch_records(const DWORD *pids, const int n, const DWORD metrics, METRICS_RECORD *out) {
+    if (!pids || n <= 0 || !out) return 0;
+
+    MetricsSample *samples = (MetricsSample*)calloc((size_t)n, sizeof(MetricsSample));
+    int *valid = (int*)calloc((size_t)n, sizeof(int));
+    const int sampled = (samples && valid) ? sample_batch(pids, n, metrics, samples, valid) : -1;
+    if (sampled >= 0) {
+        for (int i = 0; i < n; i++) {
+            if (valid[i]) sample_to_record(&out[i], metrics, &samples[i]);
+            else unavailable_record(&out[i], pids[i]);
+        }
+    }
+
+    free(samples);
+    free(valid);
+    return sampled < 0 ? 0 : sampled;
+}
+
+// A single NtQuerySystemInformation(SystemProcessInformation) call returns memory, handle
+// and thread counts, CPU times and IO for every process, and the CPU times and state of each
+// of its threads, without opening any handles. Used by the system-wide scan and the
+// per-thread breakdowns.
+#define SCAN_SYSTEM_PROCESS_INFORMATION  5
+#define SCAN_STATUS_INFO_LENGTH_MISMATCH ((LONG)0xC0000004L)
+#define SCAN_INITIAL_BUFFER              (256 * 1024)
+
+typedef struct {
+    USHORT Length;
+    USHORT MaximumLength;
+    PWSTR Buffer;
+} SCAN_UNICODE_STRING;
+
+// Leading part of SYSTEM_PROCESS_INFORMATION (the winternl.h version hides most fields);
+// NumberOfThreads SYSTEM_THREAD_INFORMATION entries follow each one
+typedef struct {
+    ULONG NextEntryOffset;
+    ULONG NumberOfThreads;
+    LARGE_INTEGER WorkingSetPrivateSize;
+    ULONG HardFaultCount;
+    ULONG NumberOfThreadsHighWatermark;
+    ULONGLONG CycleTime;
+    LARGE_INTEGER CreateTime;
+    LARGE_INTEGER UserTime;
+    LARGE_INTEGER KernelTime;
+    SCAN_UNICODE_STRING ImageName;
+    LONG BasePriority;
+    HANDLE UniqueProcessId;
+    HANDLE InheritedFromUniqueProcessId;
+    ULONG HandleCount;
+    ULONG SessionId;
+    ULONG_PTR UniqueProcessKey;
+    SIZE_T PeakVirtualSize;
+    SIZE_T VirtualSize;
+    ULONG PageFaultCount;
+    SIZE_T PeakWorkingSetSize;
+    SIZE_T WorkingSetSize;
+    SIZE_T QuotaPeakPagedPoolUsage;
+    SIZE_T QuotaPagedPoolUsage;
+    SIZE_T QuotaPeakNonPagedPoolUsage;
+    SIZE_T QuotaNonPagedPoolUsage;
+    SIZE_T PagefileUsage;
+    SIZE_T PeakPagefileUsage;
+    SIZE_T PrivatePageCount;              // private bytes, despite the name
+    LARGE_INTEGER ReadOperationCount;
+    LARGE_INTEGER WriteOperationCount;
+    LARGE_INTEGER OtherOperationCount;
+    LARGE_INTEGER ReadTransferCount;
+    LARGE_INTEGER WriteTransferCount;
+    LARGE_INTEGER OtherTransferCount;
+} SCAN_PROCESS_INFO;
+
+// SYSTEM_THREAD_INFORMATION
+typedef struct {
+    LARGE_INTEGER KernelTime;
+    LARGE_INTEGER UserTime;
+    LARGE_INTEGER CreateTime;
+    ULONG WaitTime;
+    PVOID StartAddress;
+    struct {
+        HANDLE UniqueProcess;
+        HANDLE UniqueThread;
+    } ClientId;
+    LONG Priority;
+    LONG BasePriority;
+    ULONG ContextSwitches;
+    ULONG ThreadState;
+    ULONG WaitReason;
+} SCAN_THREAD_INFO;
+
+typedef LONG (WINAPI *NtQuerySystemInformationFn)(ULONG, PVOID, ULONG, PULONG);
+
+static SRWLOCK g_scanLock = SRWLOCK_INIT;
+static unsigned char *g_scanBuf = NULL;   // reused across scans, guarded by g_scanLock
+static ULONG g_scanBufSize = 0;
+
+static NtQuerySystemInformationFn scan_query_fn() {
+    static NtQuerySystemInformationFn fn = NULL;
+    if (!fn) {
+        // ReSharper disable once CppLocalVariableMayBeConst
+        HMODULE ntdll = GetModuleHandleW(L"ntdll.dll");
+        if (ntdll) fn = (NtQuerySystemInformationFn)(void*)GetProcAddress(ntdll, "NtQuerySystemInformation");
+    }
+    return fn;
+}
+
+// Fills g_scanBuf with the current process list (g_scanLock held)
+static int scan_fetch() {
+    const NtQuerySystemInformationFn query = scan_query_fn();
+    if (!query) return 0;
+    ULONG needed = SCAN_INITIAL_BUFFER;
+    for (int attempt = 0; attempt < 8; attempt++) {
+        if (g_scanBufSize < needed) {
+            // Processes can start between calls, so leave some headroom
+            const ULONG size = needed + needed / 4;
+            free(g_scanBuf);
+            g_scanBuf = malloc(size);
+            g_scanBufSize = g_scanBuf ? size : 0;
+            if (!g_scanBuf) return 0;
+        }
+        const LONG status = query(SCAN_SYSTEM_PROCESS_INFORMATION, g_scanBuf, g_scanBufSize, &needed);
+        if (status >= 0) return 1;
+        if (status != SCAN_STATUS_INFO_LENGTH_MISMATCH) return 0;
+        if (needed <= g_scanBufSize) needed = g_scanBufSize * 2;
+    }
+    return 0;
+}
+
+static int cmp_thread_cpu(const void *a, const void *b) {
+    const DWORD x = *(const DWORD*)a, y = *(const DWORD*)b;
+    return (x > y) - (x < y);
+}
+
+// Busiest first, then by thread id
+static int cmp_thread_record(const void *a, const void *b) {
+    const THREAD_RECORD *x = a, *y = b;
+    if (x->cpu != y->cpu) return x->cpu < y->cpu ? 1 : -1;
+    return (x->tid > y->tid) - (x->tid < y->tid);
+}
+
+// Per-thread breakdown of one process from a SystemProcessInformation buffer (g_scanLock
+// held). CPU is relative to `base`; threads it has not seen report their lifetime average.
+// Replaces `base` with this reading. Returns pi->NumberOfThreads malloc'd records, busiest
+// first, or NULL on allocation failure.
+static THREAD_RECORD *thread_breakdown(const SCAN_PROCESS_INFO *pi, const LONGLONG now, ThreadBaseline *base) {
+    const int n = (int)pi->NumberOfThreads;
+    THREAD_RECORD *records = malloc(sizeof(THREAD_RECORD) * (n ? n : 1));
+    ThreadCpu *cur = malloc(sizeof(ThreadCpu) * (n ? n : 1));
+    if (!records || !cur) {
+        free(records);
+        free(cur);
+        return NULL;
+    }
+
+    FILETIME nowFt;
+    GetSystemTimeAsFileTime(&nowFt);
+    const ULONGLONG nowInt = fileTimeToInt(nowFt);
+    const double wall = base->threads ? (double)(now - base->qpc) * 1e7 / (double)qpc_frequency() : 0.0;
+    const unsigned long long timestamp = qpc_to_us(now);
+    const DWORD pid = (DWORD)(ULONG_PTR)pi->UniqueProcessId;
+    const SCAN_THREAD_INFO *ti = (const SCAN_THREAD_INFO *)(pi + 1);
+    for (int i = 0; i < n; i++, ti++) {
+        ThreadCpu *c = &cur[i];
+        c->tid = (DWORD)(ULONG_PTR)ti->ClientId.UniqueThread;
+        c->createTime = (ULONGLONG)ti->CreateTime.QuadPart;
+        c->kernel = (ULONGLONG)ti->KernelTime.QuadPart;
+        c->user = (ULONGLONG)ti->UserTime.QuadPart;
+        c->switches = ti->ContextSwitches;
+
+        THREAD_RECORD *r = &records[i];
+        memset(r, 0, sizeof(*r));
+        r->version = THREAD_RECORD_VERSION;
+        r->size = (unsigned short)sizeof(THREAD_RECORD);
+        r->pid = pid;
+        r->tid = c->tid;
+        r->state = ti->ThreadState;
+        r->wait_reason = ti->WaitReason;
+        r->priority = ti->Priority;
+        r->cpu_time_us = (c->kernel + c->user) / 10;
+        r->timestamp_us = timestamp;
+
+        double total, user, kernel;
+        const ThreadCpu *prev = base->threads
+            ? bsearch(&c->tid, base->threads, base->count, sizeof(ThreadCpu), cmp_thread_cpu) : NULL;
+        if (prev && prev->createTime == c->createTime && wall > 0.0) {
+            cpu_percent(c->kernel >= prev->kernel ? c->kernel - prev->kernel : 0,
+                        c->user >= prev->user ? c->user - prev->user : 0, wall, &total, &user, &kernel);
+            r->context_switches = c->switches - prev->switches;
+        } else {
+            const double lifetime = nowInt > c->createTime ? (double)(nowInt - c->createTime) : 0.0;
+            cpu_percent(c->kernel, c->user, lifetime, &total, &user, &kernel);
+            r->context_switches = c->switches;
+        }
+        r->cpu = total;
+        r->cpu_user = user;
+        r->cpu_kernel = kernel;
+    }
+
+    qsort(cur, n, sizeof(ThreadCpu), cmp_thread_cpu);
+    free(base->threads);
+    base->threads = cur;
+    base->count = n;
+    base->qpc = now;
+    qsort(records, n, sizeof(THREAD_RECORD), cmp_thread_record);
+    return records;
+}
+
+// Refreshes the breakdown of every due monitor with METRIC_THREAD_CPU from a single
+// SystemProcessInformation pass (scheduler thread). A monitor whose process is not in the
+// list gets an empty breakdown.
+static void monitors_sample_threads(MonitoringContext *const *due, const int n) {
+    PidIndex sorted[MAX_MONITORS];
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        if (!(due[i]->metrics & METRIC_THREAD_CPU)) continue;
+        sorted[m].pid = due[i]->pid;
+        sorted[m].index = i;
+        m++;
+    }
+    if (m == 0) return;
+    qsort(sorted, (size_t)m, sizeof(PidIndex), cmp_pid_index);
+
+    int filled[MAX_MONITORS] = {0};
+    AcquireSRWLockExclusive(&g_scanLock);
+    const LONGLONG now = qpc_now();
+    for (const unsigned char *p = scan_fetch() ? g_scanBuf : NULL; p;) {
+        const SCAN_PROCESS_INFO *pi = (const SCAN_PROCESS_INFO *)p;
+        PidIndex key;
+        key.pid = (DWORD)(ULONG_PTR)pi->UniqueProcessId;
+        const PidIndex *hit = key.pid ? bsearch(&key, sorted, (size_t)m, sizeof(PidIndex), cmp_pid_index) : NULL;
+        if (hit) {
+            // Several monitors may watch the same PID, each with its own baseline
+            while (hit > sorted && (hit - 1)->pid == key.pid) hit--;
+            for (; hit < sorted + m && hit->pid == key.pid; hit++) {
+                MonitoringContext *mon = due[hit->index];
+                THREAD_RECORD *records = thread_breakdown(pi, now, &mon->threadBase);
+                if (!records) continue;
+                AcquireSRWLockExclusive(&mon->threadLock);
+                free(mon->threadRecords);
+                mon->threadRecords = records;
+                mon->threadCount = (int)pi->NumberOfThreads;
+                ReleaseSRWLockExclusive(&mon->threadLock);
+                filled[hit - sorted] = 1;
+            }
+        }
+        p = pi->NextEntryOffset ? p + pi->NextEntryOffset : NULL;
+    }
+    ReleaseSRWLockExclusive(&g_scanLock);
+
+    for (int i = 0; i < m; i++) {
+        if (filled[i]) continue;
+        MonitoringContext *mon = due[sorted[i].index];
+        AcquireSRWLockExclusive(&mon->threadLock);
+        mon->threadCount = 0;
+        ReleaseSRWLockExclusive(&mon->threadLock);
+    }
+}
+
+// Adds the busiest threads of the monitor's breakdown to an object written by sample_to_json
+static void append_threads_json(char *buf, const size_t buflen, const MonitoringContext *mon) {
+    size_t n = strlen(buf);
+    if (n == 0 || buf[n - 1] != '}') return;
+    n--;
+    n += snprintf(buf + n, buflen - n, ",\"thread_cpu\":[");
+    const int count = min(mon->threadCount, MONITOR_JSON_THREADS);
+    for (int i = 0; i < count && n < buflen; i++) {
+        const THREAD_RECORD *r = &mon->threadRecords[i];
+        n += snprintf(buf + n, buflen - n,
+                      "%s{\"tid\":%lu,\"cpu\":%.2f,\"cpu_user\":%.2f,\"cpu_kernel\":%.2f,\"state\":%lu,"
+                      "\"wait_reason\":%lu,\"context_switches\":%lu}",
+                      i ? "," : "", r->tid, r->cpu, r->cpu_user, r->cpu_kernel, r->state, r->wait_reason,
+                      r->context_switches);
+    }
+    if (n < buflen) snprintf(buf + n, buflen - n, "]}");
+}
+
+// Monitors are served by a single scheduler thread. It sleeps on a waitable timer until the
+// earliest deadline, then samples every due monitor in one pass (one Toolhelp walk for all
+// thread counts) and invokes the callbacks on its own thread. Deadlines are absolute QPC
+// times advanced by whole intervals, so collection time never accumulates as drift.
+static CRITICAL_SECTION g_schedLock;
+static CONDITION_VARIABLE g_schedIdle;    // signalled after each dispatch pass
+static INIT_ONCE g_schedInit = INIT_ONCE_STATIC_INIT;
+static HANDLE g_schedTimer = NULL;
+static HANDLE g_schedWake = NULL;         // auto-reset, set when the monitor table changes
+static HANDLE g_schedThread = NULL;
+static DWORD g_schedThreadId = 0;
+static int g_schedRunning = 0;
+static int g_nextMonitorId = 1;
+
+// ReSharper disable once CppParameterMayBeConst
+static BOOL CALLBACK sched_init_once(PINIT_ONCE once, PVOID param, PVOID *context) {
+    (void)once; (void)param; (void)context;
+    InitializeCriticalSection(&g_schedLock);
+    InitializeConditionVariable(&g_schedIdle);
+    // Sub-millisecond timer where available (Windows 10 1803+), otherwise the classic one
+    g_schedTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!g_schedTimer) g_schedTimer = CreateWaitableTimer(NULL, FALSE, NULL);
+    g_schedWake = CreateEvent(NULL, FALSE, FALSE, NULL);
+    return g_schedTimer && g_schedWake;
+}
+
+static MonitoringContext *find_monitor(const int id) {
+    if (id <= 0) return NULL;
+    for (int i = 0; i < MAX_MONITORS; i++) {
+        if (g_monitors[i].id == id) return &g_monitors[i];
+    }
+    return NULL;
+}
+
+static RecordRing *ring_create(DWORD capacity) {
+    if (capacity < 2) capacity = 2;
+    if (capacity > (1u << 20)) capacity = 1u << 20;
+    DWORD pow2 = 2;
+    while (pow2 < capacity) pow2 <<= 1;
+
+    RecordRing *ring = (RecordRing*)calloc(1, sizeof(RecordRing));
+    if (!ring) return NULL;
+    ring->slots = (METRICS_RECORD*)malloc((size_t)pow2 * sizeof(METRICS_RECORD));
+    ring->hEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (!ring->slots || !ring->hEvent) {
+        free(ring->slots);
+        if (ring->hEvent) CloseHandle(ring->hEvent);
+        free(ring);
+        return NULL;
+    }
+    ring->mask = pow2 - 1;
+    return ring;
+}
+
+static void ring_free(RecordRing *ring) {
+    if (!ring) return;
+    CloseHandle(ring->hEvent);
+    free(ring->slots);
+    free(ring);
+}
+
+// Producer side, scheduler thread only
+static void ring_push(RecordRing *ring, const METRICS_RECORD *record) {
+    const LONG64 head = ring->head;
+    if (head - ring->tail > (LONG64)ring->mask) {
+        ring->dropped = ring->dropped + 1;
+        return;
+    }
+    ring->slots[head & ring->mask] = *record;
+    MemoryBarrier();  // publish the slot before the new head
+    ring->head = head + 1;
+    // Re-read tail after publishing: if the reader has caught up to this sample it may be
+    // about to wait, so wake it (a spurious wake only costs an empty read)
+    MemoryBarrier();
+    if (ring->tail == head) SetEvent(ring->hEvent);
+}
+
+// Consumer side, one reader at a time
+static int ring_pop(RecordRing *ring, METRICS_RECORD *out, const int max) {
+    const LONG64 tail = ring->tail;
+    const LONG64 head = ring->head;
+    MemoryBarrier();  // read the slots only after observing head
+    int n = 0;
+    while (n < max && tail + n < head) {
+        out[n] = ring->slots[(tail + n) & ring->mask];
+        n++;
+    }
+    MemoryBarrier();  // finish copying before handing the slots back
+    ring->tail = tail + n;
+    return n;
+}
+
+// METRIC_* flag each recording column belongs to; 0 for the columns that are always stored
+static const DWORD g_recColumnMetric[REC_COL_COUNT] = {
+    0, 0, METRIC_WORKING_SET, METRIC_PRIVATE_BYTES, METRIC_PAGEFILE, METRIC_HANDLES, METRIC_THREADS,
+    METRIC_CPU_USAGE, METRIC_CPU_USAGE, METRIC_CPU_USAGE, METRIC_IO, METRIC_IO,
+    METRIC_NET, METRIC_NET, METRIC_NET, METRIC_NET
+};
+
+// Fills columns[] with the REC_COL_* ids stored for `metrics`, optionally including the
+// always-present timing columns; returns how many
+static DWORD metric_columns(const DWORD metrics, const int withTiming, unsigned char *columns) {
+    DWORD n = 0;
+    for (int c = 0; c < REC_COL_COUNT; c++) {
+        if (g_recColumnMetric[c] ? (metrics & g_recColumnMetric[c]) != 0 : withTiming) columns[n++] = (unsigned char)c;
+    }
+    return n;
+}
+
+static long long rec_column_value(const int column, const MetricsSample *s) {
+    switch (column) {
+        case REC_COL_TIMESTAMP_US:   return (long long)s->timestamp_us;
+        case REC_COL_MISSED:         return s->missed;
+        case REC_COL_WORKING_SET_KB: return (long long)s->ws;
+        case REC_COL_PRIVATE_KB:     return (long long)s->priv;
+        case REC_COL_PAGEFILE_KB:    return (long long)s->pf;
+        case REC_COL_HANDLES:        return s->handles;
+        case REC_COL_THREADS:        return s->threads;
+        case REC_COL_CPU:            return (long long)(s->cpu * 100.0 + 0.5);
+        case REC_COL_CPU_USER:       return (long long)(s->cpu_user * 100.0 + 0.5);
+        case REC_COL_CPU_KERNEL:     return (long long)(s->cpu_kernel * 100.0 + 0.5);
+        case REC_COL_IO_READ_KB:     return (long long)s->io_r;
+        case REC_COL_IO_WRITE_KB:    return (long long)s->io_w;
+        case REC_COL_TCP:            return s->tcp;
+        case REC_COL_UDP:            return s->udp;
+        case REC_COL_NET_RX:         return (long long)s->net_rx;
+        case REC_COL_NET_TX:         return (long long)s->net_tx;
+        default:                     return 0;
+    }
+}
+
+// Multiplier from rec_column_value to the units of the JSON keys
+static double rec_column_scale(const int column) {
+    return (column == REC_COL_CPU || column == REC_COL_CPU_USER || column == REC_COL_CPU_KERNEL) ? 0.01 : 1.0;
+}
+
+// (Re)maps the whole file at `size` bytes, growing it if needed
+static int recorder_map(Recorder *rec, const unsigned long long size) {
+    if (rec->view) UnmapViewOfFile(rec->view);
+    if (rec->hMapping) CloseHandle(rec->hMapping);
+    rec->view = NULL;
+    rec->hMapping = CreateFileMappingW(rec->hFile, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, NULL);
+    if (!rec->hMapping) return 0;
+    rec->view = MapViewOfFile(rec->hMapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)size);
+    if (!rec->view) {
+        CloseHandle(rec->hMapping);
+        rec->hMapping = NULL;
+        return 0;
+    }
+    rec->mapped = size;
+    return 1;
+}
+
+static Recorder *recorder_open(const wchar_t *path, const DWORD pid, const DWORD metrics, const DWORD intervalMs) {
+    if (!path) return NULL;
+    Recorder *rec = calloc(1, sizeof(Recorder));
+    if (!rec) return NULL;
+    rec->columnCount = metric_columns(metrics, 1, rec->columns);
+
+    // Readers may map the file while it is being written
+    rec->hFile = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                             CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (rec->hFile == INVALID_HANDLE_VALUE) {
+        free(rec);
+        return NULL;
+    }
+    if (!recorder_map(rec, sizeof(RECORDING_HEADER) + RECORDING_GROW_BYTES)) {
+        CloseHandle(rec->hFile);
+        free(rec);
+        return NULL;
+    }
+
+    RECORDING_HEADER *header = (RECORDING_HEADER *)rec->view;
+    memcpy(header->magic, RECORDING_MAGIC, sizeof(header->magic));
+    header->version = RECORDING_VERSION;
+    header->size = sizeof(RECORDING_HEADER);
+    header->pid = pid;
+    header->metrics = metrics;
+    header->intervalMs = intervalMs;
+    header->columnCount = rec->columnCount;
+    memcpy(header->columns, rec->columns, sizeof(header->columns));
+    return rec;
+}
+
+static unsigned char *put_varint(unsigned char *p, unsigned long long v) {
+    while (v >= 0x80) {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+// Encodes the buffered samples as one block and publishes it in the header
+static void recorder_flush(Recorder *rec) {
+    if (rec->pending == 0 || rec->failed) return;
+
+    // A varint never exceeds 10 bytes
+    const unsigned long long headerBytes = sizeof(DWORD) * (1 + rec->columnCount);
+    const unsigned long long worst = headerBytes + (unsigned long long)rec->columnCount * rec->pending * 10;
+    const unsigned long long offset = sizeof(RECORDING_HEADER) + rec->committed;
+    if (offset + worst > rec->mapped) {
+        const unsigned long long step = max(min(rec->mapped, 64 * RECORDING_GROW_BYTES), RECORDING_GROW_BYTES);
+        if (!recorder_map(rec, max(rec->mapped + step, offset + worst))) {
+            rec->failed = 1;
+            return;
+        }
+    }
+
+    unsigned char *block = rec->view + offset;
+    unsigned char *p = block + headerBytes;
+    for (DWORD c = 0; c < rec->columnCount; c++) {
+        const unsigned char *start = p;
+        long long prev = 0;
+        for (DWORD i = 0; i < rec->pending; i++) {
+            const long long delta = rec->values[c][i] - prev;
+            prev = rec->values[c][i];
+            p = put_varint(p, ((unsigned long long)delta << 1) ^ (unsigned long long)(delta >> 63));
+        }
+        const DWORD length = (DWORD)(p - start);
+        memcpy(block + sizeof(DWORD) * (1 + c), &length, sizeof(length));
+    }
+    memcpy(block, &rec->pending, sizeof(DWORD));
+
+    // A concurrent reader only trusts the header counts, so update them last
+    MemoryBarrier();
+    RECORDING_HEADER *header = (RECORDING_HEADER *)rec->view;
+    rec->committed += (unsigned long long)(p - block);
+    header->sampleCount += rec->pending;
+    header->dataBytes = rec->committed;
+    rec->pending = 0;
+}
+
+static void recorder_append(Recorder *rec, const MetricsSample *s) {
+    for (DWORD c = 0; c < rec->columnCount; c++) {
+        rec->values[c][rec->pending] = rec_column_value(rec->columns[c], s);
+    }
+    if (++rec->pending == RECORDING_BLOCK_SAMPLES) recorder_flush(rec);
+}
+
+// Writes the last partial block, trims the preallocated tail and closes the file
+static void recorder_close(Recorder *rec) {
+    if (!rec) return;
+    recorder_flush(rec);
+    if (rec->view) UnmapViewOfFile(rec->view);
+    if (rec->hMapping) CloseHandle(rec->hMapping);
+    // Fails harmlessly while a reader still has the file mapped
+    LARGE_INTEGER end;
+    end.QuadPart = (LONGLONG)(sizeof(RECORDING_HEADER) + rec->committed);
+    if (SetFilePointerEx(rec->hFile, end, NULL, FILE_BEGIN)) SetEndOfFile(rec->hFile);
+    CloseHandle(rec->hFile);
+    free(rec);
+}
+
+static int agg_bucket(const unsigned long long v) {
+    if (v < AGG_SUB_BUCKETS) return (int)v;
+    int e = 63;
+    while (!(v >> e)) e--;
+    return AGG_SUB_BUCKETS + (e - AGG_SUB_BITS) * AGG_SUB_BUCKETS + (int)((v >> (e - AGG_SUB_BITS)) & (AGG_SUB_BUCKETS - 1));
+}
+
+// Centre of a histogram bucket; the small buckets hold exactly one value
+static double agg_bucket_value(const int b) {
+    if (b < AGG_SUB_BUCKETS) return b;
+    const int shift = (b - AGG_SUB_BUCKETS) / AGG_SUB_BUCKETS;
+    const unsigned long long low = (unsigned long long)(AGG_SUB_BUCKETS + (b - AGG_SUB_BUCKETS) % AGG_SUB_BUCKETS) << shift;
+    return (double)low + (double)((1ull << shift) - 1) / 2.0;
+}
+
+static double agg_percentile(const AggColumn *a, const DWORD samples, const double q) {
+    DWORD rank = (DWORD)(q * samples);
+    if (rank < q * samples || rank == 0) rank++;
+    DWORD seen = 0;
+    for (int b = 0; b < AGG_BUCKETS; b++) {
+        seen += a->counts[b];
+        if (seen >= rank) {
+            const double v = agg_bucket_value(b);
+            return v < (double)a->min ? (double)a->min : v > (double)a->max ? (double)a->max : v;
+        }
+    }
+    return (double)a->max;
+}
+
+static Aggregator *aggregator_create(const DWORD metrics, const DWORD windowMs,
+                                     void (*callbackFn)(const METRICS_AGGREGATE*, void*)) {
+    if (!callbackFn) return NULL;
+    Aggregator *agg = calloc(1, sizeof(Aggregator));
+    if (!agg) return NULL;
+    agg->windowUs = (unsigned long long)(windowMs ? windowMs : 1) * 1000;
+    agg->columnCount = metric_columns(metrics, 0, agg->columns);
+    agg->callbackFn = callbackFn;
+    return agg;
+}
+
+// Summarises and resets the current window, then hands it to the callback
+static void aggregator_emit(Aggregator *agg, const DWORD pid, const DWORD metrics, void *userData) {
+    if (agg->samples == 0) return;
+    METRICS_AGGREGATE out;
+    memset(&out, 0, sizeof(out));
+    out.version = METRICS_AGGREGATE_VERSION;
+    out.size = sizeof(out);
+    out.pid = pid;
+    out.metrics = metrics;
+    out.samples = agg->samples;
+    out.missed = agg->missed;
+    out.start_us = agg->startUs;
+    out.end_us = agg->endUs;
+    if (metrics & METRIC_SELF_PROFILE) {
+        out.sampler_cpu_us = agg->cpuLastUs - agg->cpuMarkUs;
+        memcpy(out.phase_ns, agg->phaseNs, sizeof(out.phase_ns));
+        memset(agg->phaseNs, 0, sizeof(agg->phaseNs));
+        agg->cpuMarkUs = agg->cpuLastUs;
+    }
+    for (DWORD c = 0; c < agg->columnCount; c++) {
+        const int column = agg->columns[c];
+        AggColumn *a = &agg->stats[c];
+        // CPU columns are accumulated in hundredths of a percent, like in recordings
+        const double scale = rec_column_scale(column);
+        METRIC_STATS *st = &out.stats[column];
+        out.columns |= 1u << column;
+        st->min = (double)a->min * scale;
+        st->max = (double)a->max * scale;
+        st->mean = a->sum / agg->samples * scale;
+        st->p50 = agg_percentile(a, agg->samples, 0.50) * scale;
+        st->p95 = agg_percentile(a, agg->samples, 0.95) * scale;
+        st->p99 = agg_percentile(a, agg->samples, 0.99) * scale;
+        memset(a, 0, sizeof(*a));
+    }
+    agg->samples = 0;
+    agg->missed = 0;
+    agg->callbackFn(&out, userData);
+}
+
+// Adds a sample, first closing the window it falls outside of
+static void aggregator_add(Aggregator *agg, const DWORD pid, const DWORD metrics, void *userData,
+                           const MetricsSample *s) {
+    if (agg->windowEndUs == 0) {
+        agg->windowEndUs = s->timestamp_us + agg->windowUs;
+    } else if (s->timestamp_us >= agg->windowEndUs) {
+        aggregator_emit(agg, pid, metrics, userData);
+        // Windows that passed without samples (a stalled scheduler) are skipped
+        agg->windowEndUs += agg->windowUs * (1 + (s->timestamp_us - agg->windowEndUs) / agg->windowUs);
+    }
+
+    if (agg->samples == 0) agg->startUs = s->timestamp_us;
+    agg->endUs = s->timestamp_us;
+    agg->samples++;
+    agg->missed += s->missed;
+    if (metrics & METRIC_SELF_PROFILE) {
+        // The first sample only sets the CPU baseline
+        if (agg->cpuMarkUs == 0) agg->cpuMarkUs = s->sampler_cpu_us;
+        agg->cpuLastUs = s->sampler_cpu_us;
+        for (int p = 0; p < PROFILE_PHASES; p++) agg->phaseNs[p] += s->phase_ns[p];
+    }
+    for (DWORD c = 0; c < agg->columnCount; c++) {
+        long long v = rec_column_value(agg->columns[c], s);
+        if (v < 0) v = 0;
+        AggColumn *a = &agg->stats[c];
+        if (agg->samples == 1 || v < a->min) a->min = v;
+        if (agg->samples == 1 || v > a->max) a->max = v;
+        a->sum += (double)v;
+        a->counts[agg_bucket((unsigned long long)v)]++;
+    }
+}
+
+// Advances every rule of a monitor by one sample and reports the transitions (scheduler thread)
+static void rules_evaluate(const MonitoringContext *mon, const MetricsSample *s) {
+    for (int r = 0; r < mon->ruleCount; r++) {
+        ThresholdRule *rule = &mon->rules[r];
+        const double value = (double)rec_column_value((int)rule->column, s) * rec_column_scale((int)rule->column);
+        const int holds = rule->op == THRESHOLD_ABOVE ? value > rule->threshold : value < rule->threshold;
+        if (holds == rule->active) {
+            rule->run = 0;
+            continue;
+        }
+        if (++rule->run < rule->samples) continue;
+        rule->run = 0;
+        rule->active = holds;
+
+        METRICS_ALERT alert;
+        memset(&alert, 0, sizeof(alert));
+        alert.version = METRICS_ALERT_VERSION;
+        alert.size = sizeof(alert);
+        alert.monitor = mon->id;
+        alert.rule = r;
+        alert.pid = mon->pid;
+        alert.column = rule->column;
+        alert.active = holds;
+        alert.value = value;
+        alert.threshold = rule->threshold;
+        alert.timestamp_us = s->timestamp_us;
+        SetEvent(mon->hAlertEvent);
+        if (rule->alertFn) rule->alertFn(&alert, rule->userData);
+    }
+}
+
+// Releases the process entry once the monitor stops producing samples (lock held)
+static void finish_monitor(MonitoringContext *mon) {
+    mon->state = MONITOR_FINISHED;
+    proc_release(mon->entry);
+    mon->entry = NULL;
+    if (mon->ring) SetEvent(mon->ring->hEvent);  // let a waiting reader notice
+    recorder_close(mon->recorder);               // the recording is complete
+    mon->recorder = NULL;
+}
+
+// Frees everything owned by a slot and marks it free (lock held, not dispatching)
+static void free_monitor(MonitoringContext *mon) {
+    if (mon->entry) proc_release(mon->entry);
+    ring_free(mon->ring);
+    recorder_close(mon->recorder);
+    free(mon->aggregator);
+    free(mon->rules);
+    if (mon->hAlertEvent) CloseHandle(mon->hAlertEvent);
+    free(mon->threadBase.threads);
+    free(mon->threadRecords);
+    memset(mon, 0, sizeof(*mon));
+}
+
+// Thread function serving every monitor
+// ReSharper disable once CppParameterMayBeConst
+DWORD WINAPI MonitoringThreadProc(LPVOID lpParam) {
+    (void)lpParam;
+    MonitoringContext *due[MAX_MONITORS];
+    DWORD duePids[MAX_MONITORS];
+    DWORD dueThreads[MAX_MONITORS];
+    ProcEntry *dueEntries[MAX_MONITORS];
+    NetCounters dueNet[MAX_MONITORS];
+    char buffer[4096];  // Buffer for JSON metrics
+
+    for (;;) {
+        EnterCriticalSection(&g_schedLock);
+        const LONGLONG now = qpc_now();
+        int n = 0, active = 0;
+        LONGLONG nextDue = MAXLONGLONG;
+        for (int i = 0; i < MAX_MONITORS; i++) {
+            MonitoringContext *mon = &g_monitors[i];
+            if (mon->state != MONITOR_ACTIVE) continue;
+            active++;
+            if (mon->nextDueQpc > now) {
+                if (mon->nextDueQpc < nextDue) nextDue = mon->nextDueQpc;
+                continue;
+            }
+            mon->dispatching = 1;
+            due[n++] = mon;
+            // Keep the phase, but skip whole intervals rather than bursting after a stall
+            const LONGLONG late = now - mon->nextDueQpc;
+            const LONGLONG skipped = late / mon->intervalQpc;
+            mon->dueMissed = skipped > MAXDWORD ? MAXDWORD : (DWORD)skipped;
+            mon->dueLateUs = (DWORD)min(qpc_to_us(late - skipped * mon->intervalQpc), MAXDWORD);
+            mon->nextDueQpc += (skipped + 1) * mon->intervalQpc;
+            if (mon->nextDueQpc < nextDue) nextDue = mon->nextDueQpc;
+        }
+        if (active == 0) {
+            g_schedRunning = 0;
+            LeaveCriticalSection(&g_schedLock);
+            return 0;
+        }
+        LeaveCriticalSection(&g_schedLock);
+
+        if (n > 0) {
+            // One thread-count snapshot for every due monitor that wants it
+            int nThreadPids = 0;
+            for (int i = 0; i < n; i++) {
+                if (due[i]->metrics & METRIC_THREADS) duePids[nThreadPids++] = due[i]->pid;
+            }
+            LONGLONG passStart = qpc_now();
+            if (nThreadPids > 0) snapshot_thread_counts(duePids, nThreadPids, dueThreads);
+            const LONGLONG threadTicks = qpc_now() - passStart;
+
+            // Likewise one pass over the connection tables
+            int nNet = 0;
+            for (int i = 0; i < n; i++) {
+                if (due[i]->metrics & METRIC_NET) dueEntries[nNet++] = due[i]->entry;
+            }
+            passStart = qpc_now();
+            if (nNet > 0) snapshot_net_counters(dueEntries, nNet, dueNet);
+            const LONGLONG netTicks = qpc_now() - passStart;
+
+            // And one SystemProcessInformation pass for the per-thread breakdowns
+            passStart = qpc_now();
+            monitors_sample_threads(due, n);
+            const LONGLONG threadCpuTicks = qpc_now() - passStart;
+
+            int threadIdx = 0, netIdx = 0;
+            for (int i = 0; i < n; i++) {
+                MonitoringContext *mon = due[i];
+                // The held entry keeps the PID from being reused, so an exited process is
+                // detected reliably and finishes the monitor
+                MetricsSample sample;
+                const int profile = (mon->metrics & METRIC_SELF_PROFILE) != 0;
+                const LONGLONG openStart = profile ? qpc_now() : 0;
+                const int running = mon->state == MONITOR_ACTIVE;
+                const int alive = running && proc_is_alive(mon->entry);
+                mon->dueExited = running && !alive;
+                const LONGLONG openTicks = profile ? qpc_now() - openStart : 0;
+                const int ok = alive && collect_sample(mon->entry, mon->metrics, &sample, &mon->cpu);
+                if (mon->metrics & METRIC_THREADS) sample.threads = dueThreads[threadIdx++];
+                if (mon->metrics & METRIC_NET) {
+                    const NetCounters *net = &dueNet[netIdx++];
+                    sample.tcp = net->tcp;
+                    sample.udp = net->udp;
+                    sample.net_rx = net->rx;
+                    sample.net_tx = net->tx;
+                }
+                mon->dueExpired = mon->durationQpc > 0 && qpc_now() - mon->startQpc >= mon->durationQpc;
+                if (!ok) {
+                    // Deliver the last partial window once the monitor finishes; a failed sample
+                    // of a live process only leaves a gap in the current window
+                    if (mon->aggregator && (mon->dueExited || (running && mon->dueExpired)))
+                        aggregator_emit(mon->aggregator, mon->pid, mon->metrics, mon->userData);
+                    continue;
+                }
+                sample.missed = mon->dueMissed;
+                sample.late_us = mon->dueLateUs;
+                if (profile) {
+                    // The shared passes are charged in full to every sample that used them
+                    profile_add(&sample, PROFILE_OPEN, openTicks);
+                    if (mon->metrics & METRIC_THREADS) profile_add(&sample, PROFILE_THREADS, threadTicks);
+                    if (mon->metrics & METRIC_NET) profile_add(&sample, PROFILE_NET, netTicks);
+                    if (mon->metrics & METRIC_THREAD_CPU) profile_add(&sample, PROFILE_THREADS, threadCpuTicks);
+                    sample.phase_ns[PROFILE_FORMAT] = mon->prevFormatNs;
+                    sample.phase_ns[PROFILE_CALLBACK] = mon->prevCallbackNs;
+                }
+                // Recorders and aggregators (including their window callback) count as format
+                const LONGLONG deliverStart = profile ? qpc_now() : 0;
+                LONGLONG formatEnd = 0;
+                if (mon->aggregator) {
+                    aggregator_add(mon->aggregator, mon->pid, mon->metrics, mon->userData, &sample);
+                    if (mon->dueExpired) aggregator_emit(mon->aggregator, mon->pid, mon->metrics, mon->userData);
+                } else if (mon->recorder) {
+                    recorder_append(mon->recorder, &sample);
+                } else if (mon->ring) {
+                    METRICS_RECORD record;
+                    sample_to_record(&record, mon->metrics, &sample);
+                    if (profile) formatEnd = qpc_now();
+                    ring_push(mon->ring, &record);
+                } else if (mon->recordCallbackFn) {
+                    METRICS_RECORD record;
+                    sample_to_record(&record, mon->metrics, &sample);
+                    if (profile) formatEnd = qpc_now();
+                    mon->recordCallbackFn(&record, mon->userData);
+                } else if (mon->callbackFn) {
+                    sample_to_json(buffer, sizeof(buffer), mon->metrics, &sample);
+                    append_schedule_json(buffer, sizeof(buffer), &sample);
+                    if (mon->metrics & METRIC_THREAD_CPU) append_threads_json(buffer, sizeof(buffer), mon);
+                    if (profile) formatEnd = qpc_now();
+                    mon->callbackFn(buffer, mon->userData);
+                }
+                if (profile) {
+                    const LONGLONG deliverEnd = qpc_now();
+                    if (!formatEnd) formatEnd = deliverEnd;
+                    mon->prevFormatNs = qpc_to_ns(formatEnd - deliverStart);
+                    mon->prevCallbackNs = qpc_to_ns(deliverEnd - formatEnd);
+                }
+                if (mon->ruleCount > 0) rules_evaluate(mon, &sample);
+            }
+
+            EnterCriticalSection(&g_schedLock);
+            for (int i = 0; i < n; i++) {
+                MonitoringContext *mon = due[i];
+                mon->dispatching = 0;
+                if (mon->state == MONITOR_DESTROYED) {
+                    // monitor_destroy was called from one of the callbacks
+                    free_monitor(mon);
+                } else if (mon->state == MONITOR_ACTIVE && (mon->dueExpired || mon->dueExited)) {
+                    finish_monitor(mon);
+                }
+            }
+            WakeAllConditionVariable(&g_schedIdle);
+            LeaveCriticalSection(&g_schedLock);
+            continue;  // re-scan: the pass may have taken longer than the next interval
+        }
+
+        // Relative wait in 100 ns units; the deadline itself stays absolute in QPC time
+        LARGE_INTEGER dueTime;
+        const LONGLONG wait = nextDue - qpc_now();
+        dueTime.QuadPart = wait > 0 ? -(LONGLONG)((double)wait * 1e7 / (double)qpc_frequency()) : -1;
+        SetWaitableTimer(g_schedTimer, &dueTime, 0, NULL, NULL, FALSE);
+        const HANDLE waits[2] = { g_schedWake, g_schedTimer };
+        WaitForMultipleObjects(2, waits, FALSE, INFINITE);
+    }
+}
+
+// Takes ownership of ring, recorder and aggregator (each may be NULL); returns a monitor
+// id (> 0), or 0 on failure
+static int create_monitor(
+    const DWORD pid,
+    const DWORD metrics,
+    const DWORD intervalMs,
+    const int totalDurationMs,
+    void (*callbackFn)(const char*, void*),
+    void (*recordCallbackFn)(const METRICS_RECORD*, void*),
+    void* userData,
+    RecordRing *ring,
+    Recorder *recorder,
+    Aggregator *aggregator) {
+    if (!InitOnceExecuteOnce(&g_schedInit, sched_init_once, NULL, NULL)) {
+        ring_free(ring);
+        recorder_close(recorder);
+        free(aggregator);
+        return 0;
+    }
+
+    ProcEntry *entry = proc_acquire(pid);
+    if (!entry) {
+        ring_free(ring);
+        recorder_close(recorder);
+        free(aggregator);
+        return 0;
+    }
+
+    EnterCriticalSection(&g_schedLock);
+    MonitoringContext *mon = NULL;
+    for (int i = 0; i < MAX_MONITORS && !mon; i++) {
+        if (g_monitors[i].state == MONITOR_FREE) mon = &g_monitors[i];
+    }
+    if (!mon) {
+        LeaveCriticalSection(&g_schedLock);
+        proc_release(entry);
+        ring_free(ring);
+        recorder_close(recorder);
+        free(aggregator);
+        return 0;
+    }
+
+    memset(mon, 0, sizeof(*mon));
+    mon->id = g_nextMonitorId++;
+    if (g_nextMonitorId <= 0) g_nextMonitorId = 1;
+    mon->state = MONITOR_ACTIVE;
+    mon->pid = pid;
+    mon->metrics = metrics;
+    mon->intervalMs = intervalMs ? intervalMs : 1;
+    mon->totalDurationMs = totalDurationMs;
+    mon->startQpc = qpc_now();
+    mon->intervalQpc = max(qpc_frequency() * mon->intervalMs / 1000, 1);
+    mon->durationQpc = totalDurationMs > 0 ? qpc_frequency() * totalDurationMs / 1000 : 0;
+    mon->nextDueQpc = mon->startQpc;  // first sample right away
+    mon->callbackFn = callbackFn;
+    mon->recordCallbackFn = recordCallbackFn;
+    mon->userData = userData;
+    mon->entry = entry;
+    mon->ring = ring;
+    mon->recorder = recorder;
+    mon->aggregator = aggregator;
+    const int id = mon->id;
+
+    if (!g_schedRunning) {
+        if (g_schedThread) CloseHandle(g_schedThread);
+        g_schedThread = CreateThread(NULL, 0, MonitoringThreadProc, NULL, 0, &g_schedThreadId);
+        if (!g_schedThread) {
+            free_monitor(mon);
+            LeaveCriticalSection(&g_schedLock);
+            return 0;
+        }
+        g_schedRunning = 1;
+    } else {
+        SetEvent(g_schedWake);
+    }
+    LeaveCriticalSection(&g_schedLock);
+    return id;
+}
+
+// Creates a monitor sampling `pid` every intervalMs for totalDurationMs (-1 = until destroyed).
+// Exactly one of callbackFn / recordCallbackFn is normally set; both run on the shared
+// scheduler thread. Returns a monitor id (> 0), or 0 on failure.
+__declspec(dllexport)
+int monitor_create(
+    const DWORD pid,
+    const DWORD metrics,
+    const DWORD intervalMs,
+    const int totalDurationMs,
+    void (*callbackFn)(const char*, void*),
+    void (*recordCallbackFn)(const METRICS_RECORD*, void*),
+    void* userData) {
+    return create_monitor(pid, metrics, intervalMs, totalDurationMs, callbackFn, recordCallbackFn, userData, NULL, NULL, NULL);
+}
+
+// Creates a monitor that writes METRICS_RECORD samples into a ring of `capacity` entries
+// (rounded up to a power of two) instead of calling back; drain it with monitor_read().
+// When the ring is full new samples are dropped and counted (see monitor_dropped()).
+__declspec(dllexport)
+int monitor_create_ring(
+    const DWORD pid,
+    const DWORD metrics,
+    const DWORD intervalMs,
+    const int totalDurationMs,
+    const DWORD capacity) {
+    RecordRing *ring = ring_create(capacity);
+    if (!ring) return 0;
+    return create_monitor(pid, metrics, intervalMs, totalDurationMs, NULL, NULL, NULL, ring, NULL, NULL);
+}
+
+// Creates a monitor that appends every sample to a compact recording at `path` (replaced if
+// it exists) instead of calling back. Samples become visible in the file a block of
+// RECORDING_BLOCK_SAMPLES at a time; the last partial block is written when the monitor
+// finishes or is destroyed. Read it back with recording_decode_column().
+__declspec(dllexport)
+int monitor_create_recorder(
+    const DWORD pid,
+    const DWORD metrics,
+    const DWORD intervalMs,
+    const int totalDurationMs,
+    const wchar_t *path) {
+    Recorder *recorder = recorder_open(path, pid, metrics, intervalMs);
+    if (!recorder) return 0;
+    return create_monitor(pid, metrics, intervalMs, totalDurationMs, NULL, NULL, NULL, NULL, recorder, NULL);
+}
+
+// Creates a monitor that samples every intervalMs but calls back only once per windowMs,
+// with a METRICS_AGGREGATE holding min/max/mean/p50/p95/p99 of every requested metric over
+// the window. The final partial window is delivered when the duration ends or the process
+// exits; destroying the monitor discards it. The aggregate is only valid during the callback.
+__declspec(dllexport)
+int monitor_create_aggregate(
+    const DWORD pid,
+    const DWORD metrics,
+    const DWORD intervalMs,
+    const int totalDurationMs,
+    const DWORD windowMs,
+    void (*aggregateFn)(const METRICS_AGGREGATE*, void*),
+    void* userData) {
+    Aggregator *aggregator = aggregator_create(metrics, max(windowMs, intervalMs), aggregateFn);
+    if (!aggregator) return 0;
+    return create_monitor(pid, metrics, intervalMs, totalDurationMs, NULL, NULL, userData, NULL, NULL, aggregator);
+}
+
+// Decodes one REC_COL_* column of a recording held in data[0..len) (typically a mapped
+// view of the file) into out[0..capacity). Returns the number of values written, or -1 if
+// the data is not a valid recording or does not contain the column.
+__declspec(dllexport)
+long long recording_decode_column(
+    const unsigned char *data,
+    const unsigned long long len,
+    const DWORD column,
+    long long *out,
+    const long long capacity) {
+    RECORDING_HEADER header;
+    if (!data || !out || len < sizeof(header)) return -1;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, RECORDING_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != RECORDING_VERSION || header.size != sizeof(header) ||
+        header.columnCount > REC_COL_COUNT) return -1;
+
+    DWORD index = header.columnCount;
+    for (DWORD c = 0; c < header.columnCount; c++) {
+        if (header.columns[c] == column) index = c;
+    }
+    if (index == header.columnCount) return -1;
+
+    const unsigned long long headerBytes = sizeof(DWORD) * (1 + header.columnCount);
+    const unsigned long long end = min(len, sizeof(header) + header.dataBytes);
+    unsigned long long pos = sizeof(header);
+    long long n = 0;
+    while (pos + headerBytes <= end && n < capacity) {
+        DWORD samples, lengths[REC_COL_COUNT];
+        memcpy(&samples, data + pos, sizeof(samples));
+        memcpy(lengths, data + pos + sizeof(DWORD), sizeof(DWORD) * header.columnCount);
+        unsigned long long columnStart = pos + headerBytes, blockEnd = pos + headerBytes;
+        for (DWORD c = 0; c < header.columnCount; c++) {
+            if (c < index) columnStart += lengths[c];
+            blockEnd += lengths[c];
+        }
+        if (blockEnd > end) return -1;
+
+        const unsigned char *p = data + columnStart;
+        const unsigned char *columnEnd = p + lengths[index];
+        long long value = 0;
+        for (DWORD i = 0; i < samples && n < capacity; i++) {
+            unsigned long long v = 0;
+            int shift = 0;
+            do {
+                if (p >= columnEnd || shift > 63) return -1;
+                v |= (unsigned long long)(*p & 0x7f) << shift;
+                shift += 7;
+            } while (*p++ & 0x80);
+            value += (long long)(v >> 1) ^ -(long long)(v & 1);
+            out[n++] = value;
+        }
+        pos = blockEnd;
+    }
+    return n;
+}
+
+// Copies up to max queued samples into buf, oldest first. Returns the number copied, or -1
+// for an unknown id or a monitor without a ring. Only one thread may read a given monitor.
+__declspec(dllexport)
+int monitor_read(const int id, METRICS_RECORD *buf, const int max) {
+    if (!buf || max <= 0) return 0;
+    if (!InitOnceExecuteOnce(&g_schedInit, sched_init_once, NULL, NULL)) return -1;
+
+    // The lock only pins the monitor against monitor_destroy; the scheduler writes the
+    // ring without it
+    EnterCriticalSection(&g_schedLock);
+    MonitoringContext *mon = find_monitor(id);
+    const int n = (mon && mon->ring && mon->state != MONITOR_DESTROYED) ? ring_pop(mon->ring, buf, max) : -1;
+    LeaveCriticalSection(&g_schedLock);
+    return n;
+}
+
+// Copies the per-thread breakdown of the monitor's latest sample (METRIC_THREAD_CPU) into
+// out, busiest first. Returns the number of threads in that breakdown, which may exceed
+// capacity, or -1 for an unknown id or a monitor without METRIC_THREAD_CPU.
+__declspec(dllexport)
+int monitor_read_threads(const int id, THREAD_RECORD *out, const int capacity) {
+    if (!out || capacity <= 0) return 0;
+    if (!InitOnceExecuteOnce(&g_schedInit, sched_init_once, NULL, NULL)) return -1;
+
+    int count = -1;
+    EnterCriticalSection(&g_schedLock);
+    MonitoringContext *mon = find_monitor(id);
+    if (mon && (mon->metrics & METRIC_THREAD_CPU) && mon->state != MONITOR_DESTROYED) {
+        AcquireSRWLockShared(&mon->threadLock);
+        count = mon->threadCount;
+        memcpy(out, mon->threadRecords, sizeof(THREAD_RECORD) * (size_t)min(count, capacity));
+        ReleaseSRWLockShared(&mon->threadLock);
+    }
+    LeaveCriticalSection(&g_schedLock);
+    return count;
+}
+
+// Auto-reset event set when a sample arrives in an empty ring (and when the monitor
+// finishes). Drain with monitor_read() until it returns 0 before waiting again. The handle
+// belongs to the monitor and is closed by monitor_destroy().
+__declspec(dllexport)
+HANDLE monitor_get_event(const int id) {
+    if (!InitOnceExecuteOnce(&g_schedInit, sched_init_once, NULL, NULL)) return NULL;
+
+    EnterCriticalSection(&g_schedLock);
+    const MonitoringContext *mon = find_monitor(id);
+    // ReSharper disable once CppLocalVariableMayBeConst
+    HANDLE hEvent = (mon && mon->ring) ? mon->ring->hEvent : NULL;
+    LeaveCriticalSection(&g_schedLock);
+    return hEvent;
+}
+
+// Number of samples dropped because the ring was full, or -1 for an unknown id
+__declspec(dllexport)
+long long monitor_dropped(const int id) {
+    if (!InitOnceExecuteOnce(&g_schedInit, sched_init_once, NULL, NULL)) return -1;
+
+    EnterCriticalSection(&g_schedLock);
+    const MonitoringContext *mon = find_monitor(id);
+    const long long dropped = (mon && mon->ring) ? mon->ring->dropped : -1;
+    LeaveCriticalSection(&g_schedLock);
+    return dropped;
+}
+
+// Stops and frees a monitor. When called from another thread, waits for an in-flight
+// callback of this monitor to return; from inside a callback it takes effect after it.
+__declspec(dllexport)
+int monitor_destroy(const int id) {
+    if (!InitOnceExecuteOnce(&g_schedInit, sched_init_once, NULL, NULL)) return 0;
+
+    EnterCriticalSection(&g_schedLock);
+    MonitoringContext *mon = find_monitor(id);
+    if (!mon || mon->state == MONITOR_DESTROYED) {
+        LeaveCriticalSection(&g_schedLock);
+        return 0;
+    }
+    mon->state = MONITOR_DESTROYED;
+    if (mon->dispatching && GetCurrentThreadId() == g_schedThreadId) {
+        // The scheduler frees it once the callback returns
+        LeaveCriticalSection(&g_schedLock);
+        return 1;
+    }
+    while (mon->dispatching) SleepConditionVariableCS(&g_schedIdle, &g_schedLock, INFINITE);
+    if (mon->id != id) {
+        // The scheduler freed it after the callback, and the slot may already be reused
+        LeaveCriticalSection(&g_schedLock);
+        return 1;
+    }
+    free_monitor(mon);
+    SetEvent(g_schedWake);
+    LeaveCriticalSection(&g_schedLock);
+    return 1;
+}
+
+// Attaches a rule to a monitor of any kind: it holds while the REC_COL_* `column` is above
+// or below `threshold` (THRESHOLD_*, in the units of the JSON key), and changes state only
+// after `samples` consecutive samples agree. alertFn (may be NULL) runs on the scheduler
+// thread for each transition, and the monitor's alert event is set. Returns the rule index,
+// or -1 for an unknown monitor, a column outside its metrics, or a full rule table. Not
+// callable from the monitor's own callbacks.
+__declspec(dllexport)
+int monitor_add_threshold(
+    const int id,
+    const DWORD column,
+    const int op,
+    const double threshold,
+    const DWORD samples,
+    void (*alertFn)(const METRICS_ALERT*, void*),
+    void* userData) {
+    if (column >= REC_COL_COUNT || !g_recColumnMetric[column]) return -1;
+    if (op != THRESHOLD_ABOVE && op != THRESHOLD_BELOW) return -1;
+    if (!InitOnceExecuteOnce(&g_schedInit, sched_init_once, NULL, NULL)) return -1;
+
+    EnterCriticalSection(&g_schedLock);
+    MonitoringContext *mon = find_monitor(id);
+    if (!mon || mon->state == MONITOR_DESTROYED || !(mon->metrics & g_recColumnMetric[column]) ||
+        mon->ruleCount == MONITOR_MAX_RULES || (mon->dispatching && GetCurrentThreadId() == g_schedThreadId)) {
+        LeaveCriticalSection(&g_schedLock);
+        return -1;
+    }
+    // The scheduler reads the rules without the lock, so only touch them between passes
+    while (mon->dispatching) SleepConditionVariableCS(&g_schedIdle, &g_schedLock, INFINITE);
+    if (mon->id != id || mon->state == MONITOR_DESTROYED) {
+        LeaveCriticalSection(&g_schedLock);
+        return -1;
+    }
+    if (!mon->rules) {
+        mon->rules = calloc(MONITOR_MAX_RULES, sizeof(ThresholdRule));
+        mon->hAlertEvent = mon->rules ? CreateEvent(NULL, FALSE, FALSE, NULL) : NULL;
+        if (!mon->hAlertEvent) {
+            free(mon->rules);
+            mon->rules = NULL;
+            LeaveCriticalSection(&g_schedLock);
+            return -1;
+        }
+    }
+    const int index = mon->ruleCount;
+    ThresholdRule *rule = &mon->rules[index];
+    memset(rule, 0, sizeof(*rule));
+    rule->column = column;
+    rule->op = op;
+    rule->threshold = threshold;
+    rule->samples = samples ? samples : 1;
+    rule->alertFn = alertFn;
+    rule->userData = userData;
+    mon->ruleCount++;
+    LeaveCriticalSection(&g_schedLock);
+    return index;
+}
+
+// Current state of a rule: 1 while it holds, 0 while not, -1 for an unknown monitor or rule
+__declspec(dllexport)
+int monitor_threshold_state(const int id, const int rule) {
+    if (!InitOnceExecuteOnce(&g_schedInit, sched_init_once, NULL, NULL)) return -1;
+
+    EnterCriticalSection(&g_schedLock);
+    const MonitoringContext *mon = find_monitor(id);
+    const int state = (mon && rule >= 0 && rule < mon->ruleCount) ? mon->rules[rule].active : -1;
+    LeaveCriticalSection(&g_schedLock);
+    return state;
+}
+
+// Auto-reset event set whenever one of the monitor's rules changes state; check the rules
+// with monitor_threshold_state() after each wake. NULL until the first rule is added. The
+// handle belongs to the monitor and is closed by monitor_destroy().
+__declspec(dllexport)
+HANDLE monitor_get_alert_event(const int id) {
+    if (!InitOnceExecuteOnce(&g_schedInit, sched_init_once, NULL, NULL)) return NULL;
+
+    EnterCriticalSection(&g_schedLock);
+    const MonitoringContext *mon = find_monitor(id);
+    // ReSharper disable once CppLocalVariableMayBeConst
+    HANDLE hEvent = mon ? mon->hAlertEvent : NULL;
+    LeaveCriticalSection(&g_schedLock);
+    return hEvent;
+}
+
+// Returns 1 while the monitor is still sampling (not past its duration, its process has not
+// exited, and it was not destroyed)
+__declspec(dllexport)
+int monitor_is_active(const int id) {
+    if (!InitOnceExecuteOnce(&g_schedInit, sched_init_once, NULL, NULL)) return 0;
+
+    EnterCriticalSection(&g_schedLock);
+    const MonitoringContext *mon = find_monitor(id);
+    const int active = mon && mon->state == MONITOR_ACTIVE;
+    LeaveCriticalSection(&g_schedLock);
+    return active;
+}
+
+// The original single-session API is a monitor like any other
+static int g_legacyMonitorId = 0;
+
+static int start_legacy_monitor(
+    const DWORD pid,
+    const DWORD metrics,
+    const DWORD intervalMs,
+    const int totalDurationMs,
+    void (*callbackFn)(const char*, void*),
+    void (*recordCallbackFn)(const METRICS_RECORD*, void*),
+    void* userData) {
+
+    // Don't start if already running
+    if (monitor_is_active(g_legacyMonitorId)) {
+        return 0;
+    }
+    if (g_legacyMonitorId) monitor_destroy(g_legacyMonitorId);
+
+    g_legacyMonitorId = monitor_create(pid, metrics, intervalMs, totalDurationMs, callbackFn, recordCallbackFn, userData);
+    return g_legacyMonitorId != 0;
+}
+
+__declspec(dllexport)
+int start_metrics_monitoring(
+    const DWORD pid,
+    const DWORD metrics,
+    const DWORD intervalMs,
+    const int totalDurationMs,
+    void (*callbackFn)(const char*, void*),
+    void* userData) {
+    return start_legacy_monitor(pid, metrics, intervalMs, totalDurationMs, callbackFn, NULL, userData);
+}
+
+// Same as start_metrics_monitoring, but the callback receives a METRICS_RECORD instead of
+// a JSON string; the record is only valid for the duration of the callback
+__declspec(dllexport)
+int start_metrics_monitoring_records(
+    const DWORD pid,
+    const DWORD metrics,
+    const DWORD intervalMs,
+    const int totalDurationMs,
+    void (*callbackFn)(const METRICS_RECORD*, void*),
+    void* userData) {
+    return start_legacy_monitor(pid, metrics, intervalMs, totalDurationMs, NULL, callbackFn, userData);
+}
+
+__declspec(dllexport)
+int stop_metrics_monitoring() {
+    const int wasActive = monitor_is_active(g_legacyMonitorId);
+    if (g_legacyMonitorId) monitor_destroy(g_legacyMonitorId);
+    g_legacyMonitorId = 0;
+    return wasActive;
+}
+
+__declspec(dllexport)
+int is_metrics_monitoring_active() {
+    return monitor_is_active(g_legacyMonitorId);
+}
+
+// System-wide scan, ranked by one metric
+
+// CPU times of one process in the previous scan
+typedef struct {
+    DWORD pid;
+    ULONGLONG creationTime, kernel, user;
+} ScanCpu;
+
+typedef struct {
+    long long key;
+    int index;
+} ScanRank;
+
+static ScanCpu *g_scanPrev = NULL;        // previous scan sorted by pid, guarded by g_scanLock
+static int g_scanPrevCount = 0;
+static LONGLONG g_scanPrevQpc = 0;
+
+static int cmp_scan_cpu(const void *a, const void *b) {
+    const DWORD pa = *(const DWORD*)a, pb = *(const DWORD*)b;
+    return (pa > pb) - (pa < pb);
+}
+
+// Largest key first; equal keys keep the system order
+static int cmp_scan_rank(const void *a, const void *b) {
+    const ScanRank *ra = a, *rb = b;
+    if (ra->key != rb->key) return ra->key < rb->key ? 1 : -1;
+    return ra->index - rb->index;
+}
+
+// Samples every process from one SystemProcessInformation pass and writes the top_n by
+// sort_key (a REC_COL_* id whose metric is in `metrics`) into out, largest first. CPU usage
+// is relative to the previous scan; processes new since then report their lifetime average.
+// METRIC_NET and METRIC_SELF_PROFILE are not available here and are ignored. Returns the
+// number of records written, or -1 on failure or for an invalid sort_key.
+__declspec(dllexport)
+int scan_all_processes(const DWORD metrics, const DWORD sort_key, const int top_n, METRICS_RECORD *out) {
+    const DWORD scanMetrics = metrics & ~(METRIC_NET | METRIC_SELF_PROFILE);
+    if (!out || top_n <= 0 || sort_key >= REC_COL_COUNT) return -1;
+    if (!g_recColumnMetric[sort_key] || !(scanMetrics & g_recColumnMetric[sort_key])) return -1;
+
+    AcquireSRWLockExclusive(&g_scanLock);
+    if (!scan_fetch()) {
+        ReleaseSRWLockExclusive(&g_scanLock);
+        return -1;
+    }
+
+    int count = 1;
+    for (const SCAN_PROCESS_INFO *pi = (const SCAN_PROCESS_INFO *)g_scanBuf; pi->NextEntryOffset; count++) {
+        pi = (const SCAN_PROCESS_INFO *)((const unsigned char *)pi + pi->NextEntryOffset);
+    }
+    MetricsSample *samples = malloc(sizeof(MetricsSample) * count);
+    ScanCpu *cpu = malloc(sizeof(ScanCpu) * count);
+    ScanRank *rank = malloc(sizeof(ScanRank) * count);
+    if (!samples || !cpu || !rank) {
+        ReleaseSRWLockExclusive(&g_scanLock);
+        free(samples);
+        free(cpu);
+        free(rank);
+        return -1;
+    }
+
+    const LONGLONG now = qpc_now();
+    const unsigned long long timestamp = qpc_to_us(now);
+    const double wall = g_scanPrevCount ? (double)(now - g_scanPrevQpc) * 1e7 / (double)qpc_frequency() : 0.0;
+    FILETIME nowFt;
+    GetSystemTimeAsFileTime(&nowFt);
+    const ULONGLONG nowInt = fileTimeToInt(nowFt);
+
+    int n = 0;
+    for (const unsigned char *p = g_scanBuf;;) {
+        const SCAN_PROCESS_INFO *pi = (const SCAN_PROCESS_INFO *)p;
+        const DWORD pid = (DWORD)(ULONG_PTR)pi->UniqueProcessId;
+        if (pid != 0) {  // the idle "process" would top every CPU ranking
+            MetricsSample *sample = &samples[n];
+            memset(sample, 0, sizeof(*sample));
+            sample->pid = pid;
+            sample->timestamp_us = timestamp;
+            sample->ws = pi->WorkingSetSize / 1024;
+            sample->priv = pi->PrivatePageCount / 1024;
+            sample->pf = pi->PagefileUsage / 1024;
+            sample->handles = pi->HandleCount;
+            sample->threads = pi->NumberOfThreads;
+            sample->io_r = (unsigned long long)pi->ReadTransferCount.QuadPart / 1024;
+            sample->io_w = (unsigned long long)pi->WriteTransferCount.QuadPart / 1024;
+
+            ScanCpu *c = &cpu[n];
+            c->pid = pid;
+            c->creationTime = (ULONGLONG)pi->CreateTime.QuadPart;
+            c->kernel = (ULONGLONG)pi->KernelTime.QuadPart;
+            c->user = (ULONGLONG)pi->UserTime.QuadPart;
+            if (scanMetrics & METRIC_CPU_USAGE) {
+                const ScanCpu *prev = g_scanPrev ? bsearch(&pid, g_scanPrev, g_scanPrevCount, sizeof(ScanCpu), cmp_scan_cpu) : NULL;
+                if (prev && prev->creationTime == c->creationTime && wall > 0.0) {
+                    cpu_percent(c->kernel >= prev->kernel ? c->kernel - prev->kernel : 0,
+                                c->user >= prev->user ? c->user - prev->user : 0,
+                                wall, &sample->cpu, &sample->cpu_user, &sample->cpu_kernel);
+                } else {
+                    const double lifetime = nowInt > c->creationTime ? (double)(nowInt - c->creationTime) : 0.0;
+                    cpu_percent(c->kernel, c->user, lifetime, &sample->cpu, &sample->cpu_user, &sample->cpu_kernel);
+                }
+            }
+            rank[n].key = rec_column_value((int)sort_key, sample);
+            rank[n].index = n;
+            n++;
+        }
+        if (!pi->NextEntryOffset) break;
+        p += pi->NextEntryOffset;
+    }
+
+    // This scan is the CPU baseline for the next one
+    qsort(cpu, n, sizeof(ScanCpu), cmp_scan_cpu);
+    free(g_scanPrev);
+    g_scanPrev = cpu;
+    g_scanPrevCount = n;
+    g_scanPrevQpc = now;
+    ReleaseSRWLockExclusive(&g_scanLock);
+
+    qsort(rank, n, sizeof(ScanRank), cmp_scan_rank);
+    const int written = min(n, top_n);
+    for (int i = 0; i < written; i++) sample_to_record(&out[i], scanMetrics, &samples[rank[i].index]);
+    free(samples);
+    free(rank);
+    return written;
+}
+
+// Per-thread CPU usage of one process from a single SystemProcessInformation pass. Writes up
+// to capacity threads into out, busiest first. CPU is relative to the previous call for the
+// same process; threads seen for the first time report their average since they started.
+// Returns the number of threads the process has, which may exceed capacity, or -1 on failure.
+__declspec(dllexport)
+int get_thread_metrics(const DWORD pid, THREAD_RECORD *out, const int capacity) {
+    if (!out || capacity <= 0) return -1;
+    ProcEntry *entry = proc_acquire(pid);
+    if (!entry) return -1;
+
+    int count = -1;
+    AcquireSRWLockExclusive(&g_scanLock);
+    if (scan_fetch()) {
+        const LONGLONG now = qpc_now();
+        for (const unsigned char *p = g_scanBuf;;) {
+            const SCAN_PROCESS_INFO *pi = (const SCAN_PROCESS_INFO *)p;
+            if ((DWORD)(ULONG_PTR)pi->UniqueProcessId == pid) {
+                AcquireSRWLockExclusive(&entry->cpuLock);
+                THREAD_RECORD *records = thread_breakdown(pi, now, &entry->threads);
+                ReleaseSRWLockExclusive(&entry->cpuLock);
+                if (records) {
+                    count = (int)pi->NumberOfThreads;
+                    memcpy(out, records, sizeof(THREAD_RECORD) * (size_t)min(count, capacity));
+                    free(records);
+                }
+                break;
+            }
+            if (!pi->NextEntryOffset) break;
+            p += pi->NextEntryOffset;
+        }
+    }
+    ReleaseSRWLockExclusive(&g_scanLock);
+    proc_release(entry);
+    return count;
 }